@@ -9,10 +9,16 @@
  */
 
 #include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/crypto/ghash.h>
 #include <crypto/aes.h>
 #include <crypto/ablk_helper.h>
+#include <crypto/aead.h>
 #include <crypto/algapi.h>
+#include <crypto/cryptd.h>
+#include <crypto/scatterwalk.h>
 #include <linux/module.h>
+#include <linux/slab.h>
 
 #include "aes_glue.h"
 
@@ -54,6 +60,15 @@ struct aesbs_xts_ctx {
 	struct AES_KEY	twkey;
 };
 
+struct aesbs_gcm_ctx {
+	struct BS_KEY	enc;
+	u64		ghash_key[2];
+};
+
+struct aesbs_gcm_async_ctx {
+	struct cryptd_aead *cryptd_tfm;
+};
+
 static int aesbs_cbc_set_key(struct crypto_tfm *tfm, const u8 *in_key,
 			     unsigned int key_len)
 {
@@ -101,6 +116,42 @@ static int aesbs_xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
 	return 0;
 }
 
+static int aesbs_gcm_set_key(struct crypto_aead *tfm, const u8 *in_key,
+			     unsigned int key_len)
+{
+	struct aesbs_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+	u8 h[AES_BLOCK_SIZE] = { 0 };
+
+	if (private_AES_set_encrypt_key(in_key, key_len * 8, &ctx->enc.rk)) {
+		crypto_aead_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	ctx->enc.converted = 0;
+
+	AES_encrypt(h, h, &ctx->enc.rk);
+	ghash_neon_prepare_key(ctx->ghash_key, h);
+	memset(h, 0, sizeof(h));
+	return 0;
+}
+
+static int aesbs_gcm_set_authsize(struct crypto_aead *tfm,
+				  unsigned int authsize)
+{
+	switch (authsize) {
+	case 4:
+	case 8:
+	case 12:
+	case 13:
+	case 14:
+	case 15:
+	case 16:
+		break;
+	default:
+		return -EINVAL;
+	}
+	return 0;
+}
+
 static int aesbs_cbc_encrypt(struct blkcipher_desc *desc,
 			     struct scatterlist *dst,
 			     struct scatterlist *src, unsigned int nbytes)
@@ -297,6 +348,257 @@ static int aesbs_xts_decrypt(struct blkcipher_desc *desc,
 	return err;
 }
 
+/* GHASH of len bytes at src, zero padded to a whole number of blocks */
+static void aesbs_gcm_ghash(struct aesbs_gcm_ctx *ctx, u8 dg[],
+			    const u8 *src, unsigned int len)
+{
+	u8 buf[GHASH_BLOCK_SIZE];
+
+	if (len >= GHASH_BLOCK_SIZE) {
+		ghash_update_neon(len / GHASH_BLOCK_SIZE, dg, src,
+				  ctx->ghash_key);
+		src += len & ~(GHASH_BLOCK_SIZE - 1);
+		len %= GHASH_BLOCK_SIZE;
+	}
+	if (len) {
+		memcpy(buf, src, len);
+		memset(buf + len, 0, GHASH_BLOCK_SIZE - len);
+		ghash_update_neon(1, dg, buf, ctx->ghash_key);
+	}
+}
+
+/*
+ * Data is encrypted and hashed in chunks small enough to still be in the L1
+ * cache when the second pass runs over it, instead of a CTR pass over the
+ * whole request followed by a GHASH pass.
+ */
+#define AESBS_GCM_CHUNK		(32 * AES_BLOCK_SIZE)
+
+static void aesbs_gcm_do_crypt(struct aesbs_gcm_ctx *ctx, u8 *dst,
+			       const u8 *src, unsigned int len,
+			       const u8 *assoc, unsigned int assoclen,
+			       const u8 *iv, u8 tag[], bool enc)
+{
+	u8 ctr[AES_BLOCK_SIZE] __aligned(4);
+	u8 ks[AES_BLOCK_SIZE];
+	u8 dg[GHASH_BLOCK_SIZE] = { 0 };
+	__be64 lengths[2];
+
+	lengths[0] = cpu_to_be64((u64)assoclen * 8);
+	lengths[1] = cpu_to_be64((u64)len * 8);
+
+	/* J0 is iv || 1, the payload starts at counter 2 */
+	memcpy(ctr, iv, 12);
+	*(__be32 *)(ctr + 12) = cpu_to_be32(2);
+
+	kernel_neon_begin();
+	aesbs_gcm_ghash(ctx, dg, assoc, assoclen);
+
+	while (len >= AES_BLOCK_SIZE) {
+		u32 blocks = min_t(unsigned int, len, AESBS_GCM_CHUNK) /
+			     AES_BLOCK_SIZE;
+
+		if (!enc)
+			ghash_update_neon(blocks, dg, src, ctx->ghash_key);
+		/* the NEON code wraps the 32 bit counter, as GCM requires */
+		bsaes_ctr32_encrypt_blocks(src, dst, blocks, &ctx->enc, ctr);
+		if (enc)
+			ghash_update_neon(blocks, dg, dst, ctx->ghash_key);
+		be32_add_cpu((__be32 *)(ctr + 12), blocks);
+
+		src += blocks * AES_BLOCK_SIZE;
+		dst += blocks * AES_BLOCK_SIZE;
+		len -= blocks * AES_BLOCK_SIZE;
+	}
+	if (len) {
+		AES_encrypt(ctr, ks, &ctx->enc.rk);
+		if (!enc)
+			aesbs_gcm_ghash(ctx, dg, src, len);
+		if (dst != src)
+			memcpy(dst, src, len);
+		crypto_xor(dst, ks, len);
+		if (enc)
+			aesbs_gcm_ghash(ctx, dg, dst, len);
+	}
+
+	ghash_update_neon(1, dg, (u8 *)lengths, ctx->ghash_key);
+	kernel_neon_end();
+
+	*(__be32 *)(ctr + 12) = cpu_to_be32(1);
+	AES_encrypt(ctr, tag, &ctx->enc.rk);
+	crypto_xor(tag, dg, AES_BLOCK_SIZE);
+}
+
+/*
+ * Whether sg can be mapped as one buffer of len bytes.  IPsec ESP passes
+ * most packets like that, anything else goes through a bounce buffer.
+ */
+static bool aesbs_gcm_sg_mappable(struct scatterlist *sg, unsigned int len)
+{
+	return sg_is_last(sg) && sg->length >= len &&
+	       offset_in_page(sg->offset) + len <= PAGE_SIZE;
+}
+
+static int aesbs_gcm_crypt(struct aead_request *req, bool enc)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aesbs_gcm_ctx *ctx = crypto_aead_ctx(tfm);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int len = req->cryptlen;
+	unsigned int src_len, dst_len;
+	struct scatter_walk assoc_walk, src_walk, dst_walk;
+	u8 *assoc = NULL, *src, *dst, *buf = NULL;
+	u8 tag[AES_BLOCK_SIZE];
+	int err = 0;
+
+	if (!enc) {
+		if (len < authsize)
+			return -EINVAL;
+		len -= authsize;
+	}
+	src_len = enc ? len : len + authsize;
+	dst_len = enc ? len + authsize : len;
+
+	if ((!req->assoclen ||
+	     aesbs_gcm_sg_mappable(req->assoc, req->assoclen)) &&
+	    (req->src == req->dst ?
+	     aesbs_gcm_sg_mappable(req->src, max(src_len, dst_len)) :
+	     aesbs_gcm_sg_mappable(req->src, src_len) &&
+	     aesbs_gcm_sg_mappable(req->dst, dst_len))) {
+		if (req->assoclen) {
+			scatterwalk_start(&assoc_walk, req->assoc);
+			assoc = scatterwalk_map(&assoc_walk, 0);
+		}
+		scatterwalk_start(&src_walk, req->src);
+		src = dst = scatterwalk_map(&src_walk, 0);
+		if (req->src != req->dst) {
+			scatterwalk_start(&dst_walk, req->dst);
+			dst = scatterwalk_map(&dst_walk, 1);
+		}
+	} else {
+		buf = kmalloc(req->assoclen + max(src_len, dst_len),
+			      GFP_ATOMIC);
+		if (!buf)
+			return -ENOMEM;
+		assoc = buf;
+		src = dst = buf + req->assoclen;
+		scatterwalk_map_and_copy(assoc, req->assoc, 0, req->assoclen, 0);
+		scatterwalk_map_and_copy(src, req->src, 0, src_len, 0);
+	}
+
+	aesbs_gcm_do_crypt(ctx, dst, src, len, assoc, req->assoclen,
+			   req->iv, tag, enc);
+
+	if (enc)
+		memcpy(dst + len, tag, authsize);
+	else if (memcmp(tag, src + len, authsize))
+		err = -EBADMSG;
+
+	if (!buf) {
+		if (req->src != req->dst) {
+			scatterwalk_unmap(dst, 1);
+			scatterwalk_done(&dst_walk, 1, 0);
+		}
+		scatterwalk_unmap(src, 0);
+		scatterwalk_done(&src_walk, 0, 0);
+		if (req->assoclen) {
+			scatterwalk_unmap(assoc, 0);
+			scatterwalk_done(&assoc_walk, 0, 0);
+		}
+	} else {
+		if (!err)
+			scatterwalk_map_and_copy(dst, req->dst, 0, dst_len, 1);
+		kfree(buf);
+	}
+	return err;
+}
+
+static int aesbs_gcm_encrypt(struct aead_request *req)
+{
+	return aesbs_gcm_crypt(req, true);
+}
+
+static int aesbs_gcm_decrypt(struct aead_request *req)
+{
+	return aesbs_gcm_crypt(req, false);
+}
+
+/*
+ * The bit sliced GCM above may only run where NEON is usable.  Softirq
+ * callers, which includes IPsec receive, are queued to cryptd instead.
+ */
+static int aesbs_gcm_async_init(struct crypto_tfm *tfm)
+{
+	struct aesbs_gcm_async_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct cryptd_aead *cryptd_tfm;
+
+	cryptd_tfm = cryptd_alloc_aead("__driver-gcm-aes-neonbs", 0, 0);
+	if (IS_ERR(cryptd_tfm))
+		return PTR_ERR(cryptd_tfm);
+
+	ctx->cryptd_tfm = cryptd_tfm;
+	tfm->crt_aead.reqsize = sizeof(struct aead_request) +
+		crypto_aead_reqsize(&cryptd_tfm->base);
+	return 0;
+}
+
+static void aesbs_gcm_async_exit(struct crypto_tfm *tfm)
+{
+	struct aesbs_gcm_async_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	cryptd_free_aead(ctx->cryptd_tfm);
+}
+
+static int aesbs_gcm_async_set_key(struct crypto_aead *tfm, const u8 *key,
+				   unsigned int key_len)
+{
+	struct aesbs_gcm_async_ctx *ctx = crypto_aead_ctx(tfm);
+	struct crypto_aead *child = cryptd_aead_child(ctx->cryptd_tfm);
+	int err;
+
+	crypto_aead_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(child, crypto_aead_get_flags(tfm) &
+				     CRYPTO_TFM_REQ_MASK);
+	err = crypto_aead_setkey(child, key, key_len);
+	crypto_aead_set_flags(tfm, crypto_aead_get_flags(child) &
+				   CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static int aesbs_gcm_async_set_authsize(struct crypto_aead *tfm,
+					unsigned int authsize)
+{
+	struct aesbs_gcm_async_ctx *ctx = crypto_aead_ctx(tfm);
+
+	return crypto_aead_setauthsize(cryptd_aead_child(ctx->cryptd_tfm),
+				       authsize);
+}
+
+static struct aead_request *aesbs_gcm_async_subreq(struct aead_request *req)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct aesbs_gcm_async_ctx *ctx = crypto_aead_ctx(tfm);
+	struct aead_request *subreq = aead_request_ctx(req);
+
+	memcpy(subreq, req, sizeof(*req));
+	if (may_use_simd())
+		aead_request_set_tfm(subreq,
+				     cryptd_aead_child(ctx->cryptd_tfm));
+	else
+		aead_request_set_tfm(subreq, &ctx->cryptd_tfm->base);
+	return subreq;
+}
+
+static int aesbs_gcm_async_encrypt(struct aead_request *req)
+{
+	return crypto_aead_encrypt(aesbs_gcm_async_subreq(req));
+}
+
+static int aesbs_gcm_async_decrypt(struct aead_request *req)
+{
+	return crypto_aead_decrypt(aesbs_gcm_async_subreq(req));
+}
+
 static struct crypto_alg aesbs_algs[] = { {
 	.cra_name		= "__cbc-aes-neonbs",
 	.cra_driver_name	= "__driver-cbc-aes-neonbs",
@@ -351,6 +653,24 @@ static struct crypto_alg aesbs_algs[] = { {
 		.encrypt	= aesbs_xts_encrypt,
 		.decrypt	= aesbs_xts_decrypt,
 	},
+}, {
+	.cra_name		= "__gcm-aes-neonbs",
+	.cra_driver_name	= "__driver-gcm-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_AEAD,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_gcm_ctx),
+	.cra_alignmask		= 7,
+	.cra_type		= &crypto_aead_type,
+	.cra_module		= THIS_MODULE,
+	.cra_aead = {
+		.ivsize		= AES_BLOCK_SIZE,
+		.maxauthsize	= AES_BLOCK_SIZE,
+		.setkey		= aesbs_gcm_set_key,
+		.setauthsize	= aesbs_gcm_set_authsize,
+		.encrypt	= aesbs_gcm_encrypt,
+		.decrypt	= aesbs_gcm_decrypt,
+	},
 }, {
 	.cra_name		= "cbc(aes)",
 	.cra_driver_name	= "cbc-aes-neonbs",
@@ -411,6 +731,26 @@ static struct crypto_alg aesbs_algs[] = { {
 		.encrypt	= ablk_encrypt,
 		.decrypt	= ablk_decrypt,
 	}
+}, {
+	.cra_name		= "gcm(aes)",
+	.cra_driver_name	= "gcm-aes-neonbs",
+	.cra_priority		= 300,
+	.cra_flags		= CRYPTO_ALG_TYPE_AEAD|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_gcm_async_ctx),
+	.cra_alignmask		= 7,
+	.cra_type		= &crypto_aead_type,
+	.cra_module		= THIS_MODULE,
+	.cra_init		= aesbs_gcm_async_init,
+	.cra_exit		= aesbs_gcm_async_exit,
+	.cra_aead = {
+		.ivsize		= AES_BLOCK_SIZE,
+		.maxauthsize	= AES_BLOCK_SIZE,
+		.setkey		= aesbs_gcm_async_set_key,
+		.setauthsize	= aesbs_gcm_async_set_authsize,
+		.encrypt	= aesbs_gcm_async_encrypt,
+		.decrypt	= aesbs_gcm_async_decrypt,
+	}
 } };
 
 static int __init aesbs_mod_init(void)
@@ -429,6 +769,6 @@ static void __exit aesbs_mod_exit(void)
 module_init(aesbs_mod_init);
 module_exit(aesbs_mod_exit);
 
-MODULE_DESCRIPTION("Bit sliced AES in CBC/CTR/XTS modes using NEON");
+MODULE_DESCRIPTION("Bit sliced AES in CBC/CTR/XTS/GCM modes using NEON");
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
 MODULE_LICENSE("GPL");
@@ -0,0 +1,194 @@
+/*
+ * GHASH: digest algorithm for GCM (Galois/Counter Mode), using the ARM NEON
+ * polynomial multiply.
+ *
+ * Based on ghash-generic.c.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/gf128mul.h>
+#include <crypto/internal/hash.h>
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/crypto/ghash.h>
+
+EXPORT_SYMBOL_GPL(ghash_update_neon);
+
+struct ghash_neon_ctx {
+	u64 k[2];
+	/* for callers in interrupt context, which may not use NEON */
+	struct gf128mul_4k *gf128;
+};
+
+struct ghash_neon_desc_ctx {
+	u8 digest[GHASH_DIGEST_SIZE];
+	u8 buf[GHASH_BLOCK_SIZE];
+	u32 count;
+};
+
+static int ghash_neon_init(struct shash_desc *desc)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	memset(dctx, 0, sizeof(*dctx));
+
+	return 0;
+}
+
+static int ghash_neon_setkey(struct crypto_shash *tfm,
+			     const u8 *key, unsigned int keylen)
+{
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+
+	if (ctx->gf128)
+		gf128mul_free_4k(ctx->gf128);
+	ctx->gf128 = gf128mul_init_4k_lle((be128 *)key);
+	if (!ctx->gf128)
+		return -ENOMEM;
+
+	ghash_neon_prepare_key(ctx->k, key);
+
+	return 0;
+}
+
+/* Hash an optional buffered block at head, then blocks from src. */
+static void ghash_do_update(struct ghash_neon_ctx *ctx, u8 dg[],
+			    const u8 *head, const u8 *src, int blocks)
+{
+	if (may_use_simd()) {
+		kernel_neon_begin();
+		if (head)
+			ghash_update_neon(1, dg, head, ctx->k);
+		if (blocks)
+			ghash_update_neon(blocks, dg, src, ctx->k);
+		kernel_neon_end();
+		return;
+	}
+
+	if (head) {
+		crypto_xor(dg, head, GHASH_BLOCK_SIZE);
+		gf128mul_4k_lle((be128 *)dg, ctx->gf128);
+	}
+	while (blocks--) {
+		crypto_xor(dg, src, GHASH_BLOCK_SIZE);
+		gf128mul_4k_lle((be128 *)dg, ctx->gf128);
+		src += GHASH_BLOCK_SIZE;
+	}
+}
+
+static int ghash_neon_update(struct shash_desc *desc,
+			     const u8 *src, unsigned int srclen)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(desc->tfm);
+	unsigned int partial = dctx->count % GHASH_BLOCK_SIZE;
+
+	if (!ctx->gf128)
+		return -ENOKEY;
+
+	dctx->count += srclen;
+
+	if (partial + srclen >= GHASH_BLOCK_SIZE) {
+		const u8 *head = NULL;
+		int blocks;
+
+		if (partial) {
+			int p = GHASH_BLOCK_SIZE - partial;
+
+			memcpy(dctx->buf + partial, src, p);
+			head = dctx->buf;
+			src += p;
+			srclen -= p;
+		}
+
+		blocks = srclen / GHASH_BLOCK_SIZE;
+		ghash_do_update(ctx, dctx->digest, head, src, blocks);
+		src += blocks * GHASH_BLOCK_SIZE;
+		srclen %= GHASH_BLOCK_SIZE;
+		partial = 0;
+	}
+	if (srclen)
+		memcpy(dctx->buf + partial, src, srclen);
+
+	return 0;
+}
+
+static int ghash_neon_final(struct shash_desc *desc, u8 *dst)
+{
+	struct ghash_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	struct ghash_neon_ctx *ctx = crypto_shash_ctx(desc->tfm);
+	unsigned int partial = dctx->count % GHASH_BLOCK_SIZE;
+
+	if (!ctx->gf128)
+		return -ENOKEY;
+
+	if (partial) {
+		memset(dctx->buf + partial, 0, GHASH_BLOCK_SIZE - partial);
+		ghash_do_update(ctx, dctx->digest, dctx->buf, NULL, 0);
+	}
+	memcpy(dst, dctx->digest, GHASH_DIGEST_SIZE);
+	memset(dctx, 0, sizeof(*dctx));
+
+	return 0;
+}
+
+static void ghash_neon_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct ghash_neon_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	if (ctx->gf128)
+		gf128mul_free_4k(ctx->gf128);
+}
+
+static struct shash_alg ghash_alg = {
+	.digestsize	= GHASH_DIGEST_SIZE,
+	.init		= ghash_neon_init,
+	.update		= ghash_neon_update,
+	.final		= ghash_neon_final,
+	.setkey		= ghash_neon_setkey,
+	.descsize	= sizeof(struct ghash_neon_desc_ctx),
+	.base		= {
+		.cra_name		= "ghash",
+		.cra_driver_name	= "ghash-neon",
+		.cra_priority		= 250,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= GHASH_BLOCK_SIZE,
+		.cra_ctxsize		= sizeof(struct ghash_neon_ctx),
+		.cra_module		= THIS_MODULE,
+		.cra_list		= LIST_HEAD_INIT(ghash_alg.base.cra_list),
+		.cra_exit		= ghash_neon_exit_tfm,
+	},
+};
+
+static int __init ghash_neon_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_shash(&ghash_alg);
+}
+
+static void __exit ghash_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&ghash_alg);
+}
+
+module_init(ghash_neon_mod_init);
+module_exit(ghash_neon_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("GHASH Message Digest Algorithm, NEON accelerated");
+MODULE_ALIAS("ghash");
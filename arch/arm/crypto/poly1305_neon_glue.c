@@ -0,0 +1,170 @@
+/*
+ * Poly1305 authenticator algorithm, RFC7539, ARM NEON functions
+ *
+ * Based on poly1305_generic.c, which handles the key, partial blocks and
+ * the finalization; only the bulk of the blocks goes through NEON.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <crypto/algapi.h>
+#include <crypto/internal/hash.h>
+#include <crypto/poly1305.h>
+#include <linux/crypto.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/* four blocks and up, in steps of two; at most a page per NEON section */
+#define POLY1305_NEON_MIN	(4 * POLY1305_BLOCK_SIZE)
+#define POLY1305_NEON_MAX	PAGE_SIZE
+
+asmlinkage void poly1305_blocks_neon(u32 *h, const u8 *src,
+				     unsigned int blocks, const u32 *r,
+				     const u32 *u);
+
+struct poly1305_neon_desc_ctx {
+	struct poly1305_desc_ctx base;
+	/* r^2, in radix 2^26 as r */
+	u32 u[5];
+	/* u has been derived from r */
+	bool uset;
+};
+
+/* u = r^2, partially reduced like the accumulator in poly1305_generic.c */
+static void poly1305_neon_square(u32 *u, const u32 *r)
+{
+	u32 s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+	u64 d0, d1, d2, d3, d4;
+
+	d0 = (u64)r[0] * r[0] + (u64)r[1] * s4 + (u64)r[2] * s3 +
+	     (u64)r[3] * s2 + (u64)r[4] * s1;
+	d1 = (u64)r[0] * r[1] + (u64)r[1] * r[0] + (u64)r[2] * s4 +
+	     (u64)r[3] * s3 + (u64)r[4] * s2;
+	d2 = (u64)r[0] * r[2] + (u64)r[1] * r[1] + (u64)r[2] * r[0] +
+	     (u64)r[3] * s4 + (u64)r[4] * s3;
+	d3 = (u64)r[0] * r[3] + (u64)r[1] * r[2] + (u64)r[2] * r[1] +
+	     (u64)r[3] * r[0] + (u64)r[4] * s4;
+	d4 = (u64)r[0] * r[4] + (u64)r[1] * r[3] + (u64)r[2] * r[2] +
+	     (u64)r[3] * r[1] + (u64)r[4] * r[0];
+
+	d1 += d0 >> 26;       u[0] = d0 & 0x3ffffff;
+	d2 += d1 >> 26;       u[1] = d1 & 0x3ffffff;
+	d3 += d2 >> 26;       u[2] = d2 & 0x3ffffff;
+	d4 += d3 >> 26;       u[3] = d3 & 0x3ffffff;
+	u[0] += (d4 >> 26) * 5; u[4] = d4 & 0x3ffffff;
+	u[1] += u[0] >> 26;   u[0] &= 0x3ffffff;
+}
+
+/*
+ * The two lanes are added up without a carry, leaving limbs of up to 27
+ * bits.  crypto_poly1305_final() and poly1305_blocks() expect h0 below
+ * 2^26, as the generic code leaves it: carry the whole chain once.
+ */
+static void poly1305_neon_carry(u32 *h)
+{
+	h[1] += h[0] >> 26;     h[0] &= 0x3ffffff;
+	h[2] += h[1] >> 26;     h[1] &= 0x3ffffff;
+	h[3] += h[2] >> 26;     h[2] &= 0x3ffffff;
+	h[4] += h[3] >> 26;     h[3] &= 0x3ffffff;
+	h[0] += (h[4] >> 26) * 5; h[4] &= 0x3ffffff;
+	h[1] += h[0] >> 26;     h[0] &= 0x3ffffff;
+}
+
+static int poly1305_neon_init(struct shash_desc *desc)
+{
+	struct poly1305_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+
+	dctx->uset = false;
+
+	return crypto_poly1305_init(desc);
+}
+
+static int poly1305_neon_update(struct shash_desc *desc,
+				const u8 *src, unsigned int srclen)
+{
+	struct poly1305_neon_desc_ctx *dctx = shash_desc_ctx(desc);
+	unsigned int bytes;
+
+	if (srclen < POLY1305_NEON_MIN || !may_use_simd())
+		return crypto_poly1305_update(desc, src, srclen);
+
+	/* complete a buffered block, or the key, in the generic code */
+	if (unlikely(dctx->base.buflen)) {
+		bytes = min(srclen, POLY1305_BLOCK_SIZE - dctx->base.buflen);
+		crypto_poly1305_update(desc, src, bytes);
+		src += bytes;
+		srclen -= bytes;
+	}
+	if (unlikely(!dctx->base.sset)) {
+		bytes = crypto_poly1305_setdesckey(&dctx->base, src, srclen);
+		src += srclen - bytes;
+		srclen = bytes;
+		if (!dctx->base.sset)
+			return crypto_poly1305_update(desc, src, srclen);
+	}
+	if (unlikely(!dctx->uset)) {
+		poly1305_neon_square(dctx->u, dctx->base.r);
+		dctx->uset = true;
+	}
+
+	while (srclen >= 2 * POLY1305_BLOCK_SIZE) {
+		bytes = min_t(unsigned int, srclen, POLY1305_NEON_MAX);
+		bytes = round_down(bytes, 2 * POLY1305_BLOCK_SIZE);
+
+		kernel_neon_begin();
+		poly1305_blocks_neon(dctx->base.h, src,
+				     bytes / POLY1305_BLOCK_SIZE,
+				     dctx->base.r, dctx->u);
+		kernel_neon_end();
+		poly1305_neon_carry(dctx->base.h);
+
+		src += bytes;
+		srclen -= bytes;
+	}
+
+	if (srclen)
+		return crypto_poly1305_update(desc, src, srclen);
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.digestsize	= POLY1305_DIGEST_SIZE,
+	.init		= poly1305_neon_init,
+	.update		= poly1305_neon_update,
+	.final		= crypto_poly1305_final,
+	.descsize	= sizeof(struct poly1305_neon_desc_ctx),
+	.base		= {
+		.cra_name		= "poly1305",
+		.cra_driver_name	= "poly1305-neon",
+		.cra_priority		= 300,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= POLY1305_BLOCK_SIZE,
+		.cra_module		= THIS_MODULE,
+	},
+};
+
+static int __init poly1305_neon_mod_init(void)
+{
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit poly1305_neon_mod_exit(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(poly1305_neon_mod_init);
+module_exit(poly1305_neon_mod_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Poly1305 authenticator, NEON accelerated");
+MODULE_ALIAS("poly1305");
@@ -0,0 +1,328 @@
+/*
+ * Glue code for the SHA-224/SHA-256 Secure Hash Algorithm assembler
+ * implementation using ARM NEON instructions.
+ *
+ * This file is based on sha1_neon_glue.c and sha512_neon_glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ */
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/cryptohash.h>
+#include <linux/types.h>
+#include <linux/string.h>
+#include <crypto/sha.h>
+#include <asm/byteorder.h>
+#include <asm/unaligned.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/crypto/sha256.h>
+
+
+asmlinkage void sha256_transform_neon(u32 *digest, const void *data,
+				      unsigned int num_blks);
+
+#define SHA256_NEON_WAYS	4
+/* blocks per message hashed in one NEON section */
+#define SHA256_NEON_MB_MAX	(PAGE_SIZE / SHA256_BLOCK_SIZE)
+
+asmlinkage void sha256_4way_neon(u32 state[8][SHA256_NEON_WAYS],
+				 const u8 *const data[SHA256_NEON_WAYS],
+				 unsigned int num_blks);
+
+
+static int sha224_neon_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA224_H0, SHA224_H1, SHA224_H2, SHA224_H3,
+			   SHA224_H4, SHA224_H5, SHA224_H6, SHA224_H7 },
+	};
+
+	return 0;
+}
+
+static int sha256_neon_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+			   SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7 },
+	};
+
+	return 0;
+}
+
+static int __sha256_neon_update(struct shash_desc *desc, const u8 *data,
+				unsigned int len, unsigned int partial)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int done = 0;
+
+	sctx->count += len;
+
+	if (partial) {
+		done = SHA256_BLOCK_SIZE - partial;
+		memcpy(sctx->buf + partial, data, done);
+		sha256_transform_neon(sctx->state, sctx->buf, 1);
+	}
+
+	if (len - done >= SHA256_BLOCK_SIZE) {
+		const unsigned int rounds = (len - done) / SHA256_BLOCK_SIZE;
+
+		sha256_transform_neon(sctx->state, data + done, rounds);
+		done += rounds * SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(sctx->buf, data + done, len - done);
+
+	return 0;
+}
+
+static int sha256_neon_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int len)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA256_BLOCK_SIZE;
+	int res;
+
+	/* Handle the fast case right here */
+	if (partial + len < SHA256_BLOCK_SIZE) {
+		sctx->count += len;
+		memcpy(sctx->buf + partial, data, len);
+
+		return 0;
+	}
+
+	if (!may_use_simd()) {
+		res = sha256_update_arm(desc, data, len);
+	} else {
+		kernel_neon_begin();
+		res = __sha256_neon_update(desc, data, len, partial);
+		kernel_neon_end();
+	}
+
+	return res;
+}
+
+
+/* Add padding and return the message digest. */
+static int sha256_neon_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int i, index, padlen;
+	__be32 *dst = (__be32 *)out;
+	__be64 bits;
+	static const u8 padding[SHA256_BLOCK_SIZE] = { 0x80, };
+
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64 and append length */
+	index = sctx->count % SHA256_BLOCK_SIZE;
+	padlen = (index < 56) ? (56 - index) : ((SHA256_BLOCK_SIZE+56) - index);
+	if (!may_use_simd()) {
+		sha256_update_arm(desc, padding, padlen);
+		sha256_update_arm(desc, (const u8 *)&bits, sizeof(bits));
+	} else {
+		kernel_neon_begin();
+		/* We need to fill a whole block for __sha256_neon_update() */
+		if (padlen <= 56) {
+			sctx->count += padlen;
+			memcpy(sctx->buf + index, padding, padlen);
+		} else {
+			__sha256_neon_update(desc, padding, padlen, index);
+		}
+		__sha256_neon_update(desc, (const u8 *)&bits, sizeof(bits), 56);
+		kernel_neon_end();
+	}
+
+	/* Store state in digest */
+	for (i = 0; i < 8; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Wipe context */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+/*
+ * Up to four messages, one per NEON lane.  Unused lanes hash the last
+ * message again.  Only done from a block boundary, which is where the
+ * callers (e.g. hashing pages after a salt of one block) start from.
+ */
+static int sha256_neon_finup_mb(struct shash_desc *desc,
+				const u8 * const data[], unsigned int len,
+				u8 * const outs[], unsigned int num_msgs)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int digestsize = crypto_shash_digestsize(desc->tfm);
+	unsigned int blocks = len / SHA256_BLOCK_SIZE;
+	unsigned int tail = len % SHA256_BLOCK_SIZE;
+	unsigned int padblocks = tail < 56 ? 1 : 2;
+	u8 pad[SHA256_NEON_WAYS][2 * SHA256_BLOCK_SIZE];
+	u32 state[8][SHA256_NEON_WAYS];
+	const u8 *src[SHA256_NEON_WAYS];
+	unsigned int i, j, n;
+
+	if (sctx->count % SHA256_BLOCK_SIZE || !may_use_simd())
+		return -EOPNOTSUPP;
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < SHA256_NEON_WAYS; j++)
+			state[i][j] = sctx->state[i];
+
+	for (j = 0; j < SHA256_NEON_WAYS; j++) {
+		const u8 *msg = data[min(j, num_msgs - 1)];
+
+		src[j] = msg;
+
+		memcpy(pad[j], msg + len - tail, tail);
+		memset(pad[j] + tail, 0, padblocks * SHA256_BLOCK_SIZE - tail);
+		pad[j][tail] = 0x80;
+		put_unaligned_be64((sctx->count + len) << 3,
+				   pad[j] + padblocks * SHA256_BLOCK_SIZE - 8);
+	}
+
+	while (blocks) {
+		n = min_t(unsigned int, blocks, SHA256_NEON_MB_MAX);
+
+		kernel_neon_begin();
+		sha256_4way_neon(state, src, n);
+		kernel_neon_end();
+
+		for (j = 0; j < SHA256_NEON_WAYS; j++)
+			src[j] += n * SHA256_BLOCK_SIZE;
+		blocks -= n;
+	}
+
+	for (j = 0; j < SHA256_NEON_WAYS; j++)
+		src[j] = pad[j];
+
+	kernel_neon_begin();
+	sha256_4way_neon(state, src, padblocks);
+	kernel_neon_end();
+
+	for (j = 0; j < num_msgs; j++)
+		for (i = 0; i < digestsize / 4; i++)
+			put_unaligned_be32(state[i][j], outs[j] + 4 * i);
+
+	memset(pad, 0, sizeof(pad));
+	memset(state, 0, sizeof(state));
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha224_neon_final(struct shash_desc *desc, u8 *out)
+{
+	u8 D[SHA256_DIGEST_SIZE];
+
+	sha256_neon_final(desc, D);
+
+	memcpy(out, D, SHA224_DIGEST_SIZE);
+	memset(D, 0, SHA256_DIGEST_SIZE);
+
+	return 0;
+}
+
+static int sha256_neon_export(struct shash_desc *desc, void *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha256_neon_import(struct shash_desc *desc, const void *in)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+
+	return 0;
+}
+
+static struct shash_alg sha256_alg = {
+	.digestsize	=	SHA256_DIGEST_SIZE,
+	.init		=	sha256_neon_init,
+	.update		=	sha256_neon_update,
+	.final		=	sha256_neon_final,
+	.finup_mb	=	sha256_neon_finup_mb,
+	.export		=	sha256_neon_export,
+	.import		=	sha256_neon_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_WAYS,
+	.base		=	{
+		.cra_name		= "sha256",
+		.cra_driver_name	= "sha256-neon",
+		.cra_priority		= 250,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= SHA256_BLOCK_SIZE,
+		.cra_module		= THIS_MODULE,
+	}
+};
+
+static struct shash_alg sha224_alg = {
+	.digestsize	=	SHA224_DIGEST_SIZE,
+	.init		=	sha224_neon_init,
+	.update		=	sha256_neon_update,
+	.final		=	sha224_neon_final,
+	.finup_mb	=	sha256_neon_finup_mb,
+	.export		=	sha256_neon_export,
+	.import		=	sha256_neon_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_WAYS,
+	.base		=	{
+		.cra_name		= "sha224",
+		.cra_driver_name	= "sha224-neon",
+		.cra_priority		= 250,
+		.cra_flags		= CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize		= SHA224_BLOCK_SIZE,
+		.cra_module		= THIS_MODULE,
+	}
+};
+
+static int __init sha256_neon_mod_init(void)
+{
+	int ret;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	ret = crypto_register_shash(&sha224_alg);
+	if (ret < 0)
+		return ret;
+
+	ret = crypto_register_shash(&sha256_alg);
+	if (ret < 0)
+		crypto_unregister_shash(&sha224_alg);
+
+	return ret;
+}
+
+static void __exit sha256_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&sha224_alg);
+	crypto_unregister_shash(&sha256_alg);
+}
+
+module_init(sha256_neon_mod_init);
+module_exit(sha256_neon_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA-224/SHA-256 Secure Hash Algorithm, NEON accelerated");
+MODULE_ALIAS("sha224");
+MODULE_ALIAS("sha256");
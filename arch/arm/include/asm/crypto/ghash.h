@@ -0,0 +1,33 @@
+#ifndef ASM_ARM_CRYPTO_GHASH_H
+#define ASM_ARM_CRYPTO_GHASH_H
+
+#include <linux/types.h>
+#include <asm/unaligned.h>
+
+#define GHASH_BLOCK_SIZE	16
+#define GHASH_DIGEST_SIZE	16
+
+/*
+ * dg = (dg ^ src[0]) * H, and so on for each of the blocks.  Must be called
+ * between kernel_neon_begin() and kernel_neon_end(), with blocks > 0.
+ */
+asmlinkage void ghash_update_neon(int blocks, u8 dg[], const u8 *src,
+				  const u64 key[2]);
+
+/*
+ * Convert the hash key H, as produced by the block cipher, to the form
+ * ghash_update_neon() takes: H * x as two 64 bit halves, high half first.
+ */
+static inline void ghash_neon_prepare_key(u64 key[2],
+					  const u8 h[GHASH_BLOCK_SIZE])
+{
+	u64 a = get_unaligned_be64(h);
+	u64 b = get_unaligned_be64(h + 8);
+
+	key[0] = (a << 1) | (b >> 63);
+	key[1] = (b << 1) | (a >> 63);
+	if (a >> 63)
+		key[0] ^= 0xc200000000000000ULL;
+}
+
+#endif
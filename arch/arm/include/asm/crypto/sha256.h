@@ -0,0 +1,10 @@
+#ifndef ASM_ARM_CRYPTO_SHA256_H
+#define ASM_ARM_CRYPTO_SHA256_H
+
+#include <linux/crypto.h>
+#include <crypto/sha.h>
+
+extern int sha256_update_arm(struct shash_desc *desc, const u8 *data,
+			     unsigned int len);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code must live in its own compilation unit (normally an assembler
+ * file) and be called from inside a kernel_neon_begin()/kernel_neon_end()
+ * pair in another one, so the compiler cannot move NEON instructions out
+ * of the section where the unit is owned by the kernel.  Preemption is
+ * disabled in between, and neither may be called from interrupt context.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+#endif /* __ASM_ARM_NEON_H */
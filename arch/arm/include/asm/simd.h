@@ -0,0 +1,31 @@
+#ifndef __ASM_ARM_SIMD_H
+#define __ASM_ARM_SIMD_H
+
+#include <linux/hardirq.h>
+#include <linux/percpu.h>
+
+#ifdef CONFIG_KERNEL_MODE_NEON
+DECLARE_PER_CPU(bool, kernel_neon_busy);
+#endif
+
+/*
+ * may_use_simd - whether it is allowable at this time to issue SIMD
+ *                instructions or access the SIMD register file
+ *
+ * kernel_neon_begin() may not be called from interrupt context, callers
+ * fall back to their scalar code there.  Neither may it be nested, which
+ * matters for memcpy() and copy_page(): they can be reached from inside
+ * another kernel_neon_begin()/kernel_neon_end() pair.  The flag is only
+ * set with preemption disabled, so reading it while preemptible can at
+ * worst see another task's section and take the scalar path needlessly.
+ */
+static inline bool may_use_simd(void)
+{
+#ifdef CONFIG_KERNEL_MODE_NEON
+	if (__this_cpu_read(kernel_neon_busy))
+		return false;
+#endif
+	return !in_interrupt();
+}
+
+#endif /* __ASM_ARM_SIMD_H */
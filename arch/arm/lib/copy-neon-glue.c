@@ -0,0 +1,93 @@
+/*
+ * copy_page, clear_page and memcpy using the NEON routines in
+ * copy-armv7-neon.S when the NEON unit may be claimed, falling back to
+ * the integer ones in copy_page.S and memcpy.S otherwise.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <asm/page.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/*
+ * Below this claiming the NEON unit, and restoring the task's VFP state
+ * on its next use of it, costs more than the faster loop saves.
+ */
+#define MEMCPY_NEON_MIN_LEN	1024
+
+/* Bytes copied per kernel_neon_begin(), to bound the preemption latency */
+#define MEMCPY_NEON_CHUNK	(16 * PAGE_SIZE)
+
+asmlinkage void __copy_page_neon(void *to, const void *from);
+asmlinkage void __clear_page_neon(void *page);
+asmlinkage void *__memcpy_neon(void *dest, const void *src, size_t n);
+
+asmlinkage void __copy_page_arm(void *to, const void *from);
+asmlinkage void *__memcpy_arm(void *dest, const void *src, size_t n);
+
+/* for the benchmark module */
+EXPORT_SYMBOL_GPL(__copy_page_arm);
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+
+void copy_page(void *to, const void *from)
+{
+	if (cpu_has_neon() && may_use_simd()) {
+		kernel_neon_begin();
+		__copy_page_neon(to, from);
+		kernel_neon_end();
+	} else {
+		__copy_page_arm(to, from);
+	}
+}
+
+void clear_page(void *page)
+{
+	if (cpu_has_neon() && may_use_simd()) {
+		kernel_neon_begin();
+		__clear_page_neon(page);
+		kernel_neon_end();
+	} else {
+		memset(page, 0, PAGE_SIZE);
+	}
+}
+EXPORT_SYMBOL(clear_page);
+
+void *memcpy(void *dest, const void *src, size_t n)
+{
+	u8 *d = dest;
+	const u8 *s = src;
+
+	if (n < MEMCPY_NEON_MIN_LEN || !cpu_has_neon() || !may_use_simd())
+		return __memcpy_arm(dest, src, n);
+
+	/*
+	 * __memcpy_neon() rereads bytes it may already have stored, so
+	 * keep the integer copy for callers that overlap the buffers.
+	 */
+	if (d < s + n && s < d + n)
+		return __memcpy_arm(dest, src, n);
+
+	do {
+		size_t chunk = min_t(size_t, n, MEMCPY_NEON_CHUNK);
+
+		/* leave no tail shorter than __memcpy_neon() accepts */
+		if (n - chunk < 64)
+			chunk = n;
+
+		kernel_neon_begin();
+		__memcpy_neon(d, s, chunk);
+		kernel_neon_end();
+
+		d += chunk;
+		s += chunk;
+		n -= chunk;
+	} while (n);
+
+	return dest;
+}
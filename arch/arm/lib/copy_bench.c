@@ -0,0 +1,214 @@
+/*
+ * Checks memcpy and memmove, overlapping copies included, then times the
+ * NEON and the integer copy_page, clear_page and memcpy when loaded.
+ * Bytes per cycle are derived from the cpufreq frequency of the CPU the
+ * benchmark ran on, so pin the frequency for stable numbers.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/cpufreq.h>
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/string.h>
+#include <asm/page.h>
+
+#define BENCH_ORDER	4
+#define BENCH_BYTES	(PAGE_SIZE << BENCH_ORDER)
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Calls timed per routine and size");
+
+asmlinkage void __copy_page_arm(void *to, const void *from);
+asmlinkage void *__memcpy_arm(void *dest, const void *src, size_t n);
+
+static void bench_copy_page(void *dst, void *src, size_t n)
+{
+	copy_page(dst, src);
+}
+
+static void bench_copy_page_arm(void *dst, void *src, size_t n)
+{
+	__copy_page_arm(dst, src);
+}
+
+static void bench_clear_page(void *dst, void *src, size_t n)
+{
+	clear_page(dst);
+}
+
+static void bench_memset(void *dst, void *src, size_t n)
+{
+	memset(dst, 0, n);
+}
+
+static void bench_memcpy(void *dst, void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+static void bench_memcpy_arm(void *dst, void *src, size_t n)
+{
+	__memcpy_arm(dst, src, n);
+}
+
+static const struct {
+	const char *name;
+	void (*fn)(void *dst, void *src, size_t n);
+	bool per_page;
+} bench_fns[] = {
+	{ "copy_page",		bench_copy_page,	true },
+	{ "copy_page (arm)",	bench_copy_page_arm,	true },
+	{ "clear_page",		bench_clear_page,	true },
+	{ "memset",		bench_memset,		true },
+	{ "memcpy",		bench_memcpy,		false },
+	{ "memcpy (arm)",	bench_memcpy_arm,	false },
+};
+
+static const size_t bench_sizes[] = { 256, 1024, 4096, 16384, BENCH_BYTES };
+
+static void bench_one(const char *name, void (*fn)(void *, void *, size_t),
+		      void *dst, void *src, size_t n)
+{
+	unsigned int khz = cpufreq_quick_get(raw_smp_processor_id());
+	unsigned long long bytes = (unsigned long long)n * iterations;
+	unsigned long long mbps, bpc;
+	ktime_t start;
+	s64 ns;
+	unsigned int i;
+
+	fn(dst, src, n);		/* warm the caches and the TLB */
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		fn(dst, src, n);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start)) ? : 1;
+
+	/* bytes / (ns * 1e-9 * 2^20) */
+	mbps = div64_u64(bytes * 1000000000ULL, (u64)ns << 20);
+	if (!khz) {
+		pr_info("copy_bench: %-16s %6zu bytes: %llu MB/s\n",
+			name, n, mbps);
+		return;
+	}
+
+	/* 100 * bytes / (ns * khz * 1e-6 cycles) */
+	bpc = div64_u64(bytes * 100000000ULL, (u64)ns * khz);
+	pr_info("copy_bench: %-16s %6zu bytes: %llu MB/s, %llu.%02llu bytes/cycle\n",
+		name, n, mbps, bpc / 100, bpc % 100);
+}
+
+static const size_t check_sizes[] = { 64, 1000, 1024, 2048, 4100, 60000 };
+static const int check_shifts[] = { -64, -8, -1, 1, 3, 8, 64 };
+
+static void check_fill(u8 *buf, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		buf[i] = i * 7 + (i >> 8);
+}
+
+/*
+ * Copy between buffers at every offset in check_shifts[], and within
+ * one buffer with dest that far from src, against a bytewise copy.
+ */
+static int __init copy_bench_check(u8 *a, u8 *b, u8 *ref, size_t len)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(check_sizes); i++) {
+		size_t n = check_sizes[i];
+
+		if (n + 64 > len)
+			break;
+
+		for (j = 0; j < ARRAY_SIZE(check_shifts); j++) {
+			int shift = check_shifts[j];
+			unsigned int src = shift < 0 ? abs(shift) : 0;
+			unsigned int dst = shift < 0 ? 0 : shift;
+			size_t k;
+
+			check_fill(a, n + 64);
+			memset(b, 0, n + 64);
+			memcpy(b + dst, a + src, n);
+			if (memcmp(b + dst, a + src, n)) {
+				pr_err("copy_bench: memcpy(%zu, %d) is wrong\n",
+				       n, shift);
+				return -EIO;
+			}
+
+			check_fill(a, n + 64);
+			check_fill(ref, n + 64);
+			if (dst < src)
+				for (k = 0; k < n; k++)
+					ref[dst + k] = ref[src + k];
+			else
+				for (k = n; k-- > 0; )
+					ref[dst + k] = ref[src + k];
+			memmove(a + dst, a + src, n);
+			if (memcmp(a, ref, n + 64)) {
+				pr_err("copy_bench: memmove(%zu, %d) is wrong\n",
+				       n, shift);
+				return -EIO;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int __init copy_bench_init(void)
+{
+	void *src, *dst, *ref;
+	int i, j, ret;
+
+	src = (void *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = (void *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	ref = (void *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst || !ref) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = copy_bench_check(src, dst, ref, BENCH_BYTES);
+	if (ret)
+		goto out;
+
+	memset(src, 0x5a, BENCH_BYTES);
+
+	for (i = 0; i < ARRAY_SIZE(bench_fns); i++) {
+		if (bench_fns[i].per_page) {
+			bench_one(bench_fns[i].name, bench_fns[i].fn,
+				  dst, src, PAGE_SIZE);
+			continue;
+		}
+		for (j = 0; j < ARRAY_SIZE(bench_sizes); j++)
+			bench_one(bench_fns[i].name, bench_fns[i].fn,
+				  dst, src, bench_sizes[j]);
+	}
+
+out:
+	free_pages((unsigned long)src, BENCH_ORDER);
+	free_pages((unsigned long)dst, BENCH_ORDER);
+	free_pages((unsigned long)ref, BENCH_ORDER);
+
+	return ret;
+}
+
+static void __exit copy_bench_exit(void)
+{
+}
+
+module_init(copy_bench_init);
+module_exit(copy_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("copy_page, clear_page and memcpy benchmark");
@@ -0,0 +1,71 @@
+/*
+ * crc32_le and __crc32c_le using the NEON folding code in
+ * crc32-armv7-neon.S.  These replace the weak versions in lib/crc32.c.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/crc32.h>
+#include <linux/kernel.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/*
+ * Below this the table code is as fast, once the NEON unit has to be
+ * claimed and the residue reduced.
+ */
+#define CRC32_NEON_MIN_LEN	256
+
+/* Bytes folded per kernel_neon_begin(), to bound the preemption latency */
+#define CRC32_NEON_CHUNK	4096
+
+asmlinkage void crc32_neon_fold(u32 crc, const u8 *p, unsigned int len,
+				const u64 k[4], u8 residue[16]);
+
+/* x^544, x^480, x^160 and x^96 modulo P, bit reflected and times x */
+static const u64 crc32_fold_k[4] = {
+	0x154442bd4ULL, 0x1c6e41596ULL, 0x1751997d0ULL, 0x0ccaa009eULL,
+};
+
+static const u64 crc32c_fold_k[4] = {
+	0x0740eef02ULL, 0x09e4addf8ULL, 0x0f20c0dfeULL, 0x14cd00bd6ULL,
+};
+
+static u32 crc32_neon(u32 crc, unsigned char const *p, size_t len,
+		      const u64 k[4],
+		      u32 (*base)(u32, unsigned char const *, size_t))
+{
+	u8 residue[16];
+
+	do {
+		unsigned int n = round_down(min_t(size_t, len,
+						  CRC32_NEON_CHUNK), 64);
+
+		kernel_neon_begin();
+		crc32_neon_fold(crc, p, n, k, residue);
+		kernel_neon_end();
+
+		crc = base(0, residue, sizeof(residue));
+		p += n;
+		len -= n;
+	} while (len >= CRC32_NEON_MIN_LEN);
+
+	return base(crc, p, len);
+}
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (len >= CRC32_NEON_MIN_LEN && cpu_has_neon() && may_use_simd())
+		return crc32_neon(crc, p, len, crc32_fold_k, crc32_le_base);
+	return crc32_le_base(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (len >= CRC32_NEON_MIN_LEN && cpu_has_neon() && may_use_simd())
+		return crc32_neon(crc, p, len, crc32c_fold_k,
+				  __crc32c_le_base);
+	return __crc32c_le_base(crc, p, len);
+}
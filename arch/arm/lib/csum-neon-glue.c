@@ -0,0 +1,124 @@
+/*
+ * csum_partial and the csum_partial_copy variants using the NEON loops in
+ * csum-armv7-neon.S when the NEON unit may be claimed, falling back to
+ * the integer ones in csumpartial*.S otherwise.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/* Below this the integer loop is as fast, once the NEON unit is claimed */
+#define CSUM_NEON_MIN_LEN	256
+
+/* Bytes summed per kernel_neon_begin(), to bound the preemption latency */
+#define CSUM_NEON_CHUNK		8192
+
+asmlinkage u64 csum_partial_neon(const void *buff, int len);
+asmlinkage u64 csum_partial_copy_neon(const void *src, void *dst, int len);
+
+asmlinkage __wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+asmlinkage __wsum __csum_partial_copy_nocheck_arm(const void *src, void *dst,
+						  int len, __wsum sum);
+asmlinkage __wsum __csum_partial_copy_from_user_arm(const void __user *src,
+						    void *dst, int len,
+						    __wsum sum, int *err_ptr);
+
+/* for the test module */
+EXPORT_SYMBOL_GPL(__csum_partial_arm);
+
+static inline bool csum_use_neon(int len)
+{
+	return len >= CSUM_NEON_MIN_LEN && cpu_has_neon() && may_use_simd();
+}
+
+/*
+ * Add the 64 bit sum of 16 bit words returned by the NEON code to sum.
+ * 2^32 is 1 modulo 0xffff, so folding the upper half in twice keeps the
+ * value of the one's complement sum.
+ */
+static inline __wsum csum_add_neon(__wsum sum, u64 s)
+{
+	s = (s & 0xffffffff) + (s >> 32);
+	s = (s & 0xffffffff) + (s >> 32);
+	return csum_add(sum, (__force __wsum)(u32)s);
+}
+
+/*
+ * The NEON loops only ever cover multiples of 64 bytes from the start of
+ * the buffer, so the words they sum are aligned like the ones of the
+ * integer code on the odd length tail.
+ */
+__wsum csum_partial(const void *buff, int len, __wsum sum)
+{
+	if (!csum_use_neon(len))
+		return __csum_partial_arm(buff, len, sum);
+
+	do {
+		int n = round_down(min(len, CSUM_NEON_CHUNK), 64);
+		u64 s;
+
+		kernel_neon_begin();
+		s = csum_partial_neon(buff, n);
+		kernel_neon_end();
+
+		sum = csum_add_neon(sum, s);
+		buff += n;
+		len -= n;
+	} while (len >= CSUM_NEON_MIN_LEN);
+
+	return __csum_partial_arm(buff, len, sum);
+}
+
+__wsum csum_partial_copy_nocheck(const void *src, void *dst, int len,
+				 __wsum sum)
+{
+	if (!csum_use_neon(len))
+		return __csum_partial_copy_nocheck_arm(src, dst, len, sum);
+
+	do {
+		int n = round_down(min(len, CSUM_NEON_CHUNK), 64);
+		u64 s;
+
+		kernel_neon_begin();
+		s = csum_partial_copy_neon(src, dst, n);
+		kernel_neon_end();
+
+		sum = csum_add_neon(sum, s);
+		src += n;
+		dst += n;
+		len -= n;
+	} while (len >= CSUM_NEON_MIN_LEN);
+
+	return __csum_partial_copy_nocheck_arm(src, dst, len, sum);
+}
+
+/*
+ * A user access may fault and sleep, which it must not do between
+ * kernel_neon_begin() and kernel_neon_end().  Copy first and checksum
+ * the destination while it is still in the cache instead.  On a fault
+ * the destination is zeroed like the integer version does.
+ */
+__wsum csum_partial_copy_from_user(const void __user *src, void *dst,
+				   int len, __wsum sum, int *err_ptr)
+{
+	if (!csum_use_neon(len))
+		return __csum_partial_copy_from_user_arm(src, dst, len, sum,
+							 err_ptr);
+
+	if (__copy_from_user(dst, src, len)) {
+		memset(dst, 0, len);
+		*err_ptr = -EFAULT;
+		return sum;
+	}
+
+	return csum_partial(dst, len, sum);
+}
@@ -0,0 +1,160 @@
+/*
+ * Checks csum_partial, csum_partial_copy_nocheck and
+ * csum_partial_copy_from_user against a byte by byte reference when
+ * loaded, then times the NEON and the integer csum_partial.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published
+ * by the Free Software Foundation.
+ */
+
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <net/checksum.h>
+
+#define CSUM_TEST_MAX_LEN	(3 * 4096)
+#define CSUM_TEST_BUF_LEN	(CSUM_TEST_MAX_LEN + 64)
+
+asmlinkage __wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+
+/* One's complement sum of the little endian 16 bit words in p, plus sum */
+static u16 csum_ref(const u8 *p, int len, u32 sum)
+{
+	u64 s = sum;
+	int i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		s += p[i] | p[i + 1] << 8;
+	if (len & 1)
+		s += p[len - 1];
+	while (s >> 16)
+		s = (s & 0xffff) + (s >> 16);
+
+	return s;
+}
+
+/* 0 and 0xffff are both zero in one's complement */
+static bool csum_match(__wsum csum, u16 ref)
+{
+	return (u16)~csum_fold(csum) % 0xffff == ref % 0xffff;
+}
+
+static int __init csum_test_lengths(u8 *src, u8 *dst, int off, int len)
+{
+	u32 sum = random32();
+	u16 ref = csum_ref(src + off, len, sum);
+	mm_segment_t fs;
+	__wsum csum;
+	int err = 0;
+
+	csum = csum_partial(src + off, len, (__force __wsum)sum);
+	if (!csum_match(csum, ref)) {
+		pr_err("csum_test: csum_partial(off %d, len %d) failed\n",
+		       off, len);
+		return -EINVAL;
+	}
+
+	memset(dst, 0, CSUM_TEST_BUF_LEN);
+	csum = csum_partial_copy_nocheck(src + off, dst + 63 - off, len,
+					 (__force __wsum)sum);
+	if (!csum_match(csum, ref) || memcmp(dst + 63 - off, src + off, len)) {
+		pr_err("csum_test: csum_partial_copy_nocheck(off %d, len %d) failed\n",
+		       off, len);
+		return -EINVAL;
+	}
+
+	memset(dst, 0, CSUM_TEST_BUF_LEN);
+	fs = get_fs();
+	set_fs(KERNEL_DS);
+	csum = csum_partial_copy_from_user((const void __user *)(src + off),
+					   dst + off, len,
+					   (__force __wsum)sum, &err);
+	set_fs(fs);
+	if (err || !csum_match(csum, ref) ||
+	    memcmp(dst + off, src + off, len)) {
+		pr_err("csum_test: csum_partial_copy_from_user(off %d, len %d) failed\n",
+		       off, len);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void __init csum_test_speed(const char *name,
+				   __wsum (*fn)(const void *, int, __wsum),
+				   const u8 *buf, int len)
+{
+	unsigned int i, iterations = (1 << 24) / len;
+	u64 bytes = (u64)len * iterations;
+	ktime_t start;
+	s64 ns;
+
+	fn(buf, len, 0);		/* warm the cache */
+
+	start = ktime_get();
+	for (i = 0; i < iterations; i++)
+		fn(buf, len, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start)) ? : 1;
+
+	pr_info("csum_test: %-20s %5d bytes: %llu MB/s\n", name, len,
+		div64_u64(bytes * 1000000000ULL, (u64)ns << 20));
+}
+
+static int __init csum_test_init(void)
+{
+	static const int speed_lens[] = { 64, 576, 1500, 4096, 9000 };
+	u8 *src, *dst;
+	int off, len, i, ret = 0;
+
+	src = kmalloc(CSUM_TEST_BUF_LEN, GFP_KERNEL);
+	dst = kmalloc(CSUM_TEST_BUF_LEN, GFP_KERNEL);
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	get_random_bytes(src, CSUM_TEST_BUF_LEN);
+
+	/* every length up to 1K, then odd and even steps to the maximum */
+	for (off = 0; off < 8 && !ret; off++) {
+		for (len = 0; len <= 1024 && !ret; len++)
+			ret = csum_test_lengths(src, dst, off, len);
+		for (; len <= CSUM_TEST_MAX_LEN && !ret; len += 251)
+			ret = csum_test_lengths(src, dst, off, len);
+	}
+
+	/* all ones words make every carry count */
+	memset(src, 0xff, CSUM_TEST_BUF_LEN);
+	for (off = 0; off < 2 && !ret; off++)
+		ret = csum_test_lengths(src, dst, off, CSUM_TEST_MAX_LEN - off);
+	if (ret)
+		goto out;
+	pr_info("csum_test: all tests passed\n");
+
+	for (i = 0; i < ARRAY_SIZE(speed_lens); i++) {
+		csum_test_speed("csum_partial", csum_partial,
+				src, speed_lens[i]);
+		csum_test_speed("csum_partial (arm)", __csum_partial_arm,
+				src, speed_lens[i]);
+	}
+
+out:
+	kfree(src);
+	kfree(dst);
+	return ret;
+}
+
+static void __exit csum_test_exit(void)
+{
+}
+
+module_init(csum_test_init);
+module_exit(csum_test_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("csum_partial and csum_partial_copy tests");
@@ -0,0 +1,36 @@
+/*
+ * linux/arch/arm/lib/xor-neon-glue.c
+ *
+ * The NEON routines of xor-armv7-neon.S, for the xor_blocks() templates
+ * in asm/xor.h.  Callers must wrap them in kernel_neon_begin() and
+ * kernel_neon_end().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/raid/xor.h>
+
+MODULE_LICENSE("GPL");
+
+asmlinkage void __xor_neon_2(unsigned long bytes, unsigned long *p1,
+			     unsigned long *p2);
+asmlinkage void __xor_neon_3(unsigned long bytes, unsigned long *p1,
+			     unsigned long *p2, unsigned long *p3);
+asmlinkage void __xor_neon_4(unsigned long bytes, unsigned long *p1,
+			     unsigned long *p2, unsigned long *p3,
+			     unsigned long *p4);
+asmlinkage void __xor_neon_5(unsigned long bytes, unsigned long *p1,
+			     unsigned long *p2, unsigned long *p3,
+			     unsigned long *p4, unsigned long *p5);
+
+struct xor_block_template const xor_block_neon_inner = {
+	.name	= "__inner_neon__",
+	.do_2	= __xor_neon_2,
+	.do_3	= __xor_neon_3,
+	.do_4	= __xor_neon_4,
+	.do_5	= __xor_neon_5,
+};
+EXPORT_SYMBOL(xor_block_neon_inner);
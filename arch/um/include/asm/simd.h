@@ -0,0 +1,6 @@
+#ifndef __UM_SIMD_H
+#define __UM_SIMD_H
+
+#include <asm-generic/simd.h>
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * Per-disk request latency histograms.
+ *
+ * Every completed file system request is sorted into a log2 bucket of
+ * microseconds twice: once for the time it spent in the block layer
+ * between allocation and dispatch to the driver (queue time), and once
+ * for the time the driver took from dispatch to completion (service
+ * time).  Requests are further split into reads, async writes, sync
+ * writes, cache flushes and discards, so that e.g. an eMMC stalling on
+ * flushes stands out from one that is merely slow on large writes.
+ *
+ * Counters are per cpu and only summed when read, so leaving this on
+ * costs two sched_clock() reads and two increments per request.  The
+ * histograms are exported as /sys/block/<disk>/latency_hist; writing
+ * anything to that file resets them.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/math64.h>
+#include <linux/time.h>
+
+#include "blk.h"
+
+/* bucket 0 is < 1us, bucket n is [2^(n-1), 2^n) us, the last is open */
+#define BLK_LAT_BUCKETS		24
+
+enum {
+	BLK_LAT_READ,
+	BLK_LAT_WRITE,
+	BLK_LAT_SYNC,
+	BLK_LAT_FLUSH,
+	BLK_LAT_DISCARD,
+	BLK_LAT_NR_OPS,
+};
+
+static const char *blk_lat_op_names[BLK_LAT_NR_OPS] = {
+	[BLK_LAT_READ]		= "read",
+	[BLK_LAT_WRITE]		= "write",
+	[BLK_LAT_SYNC]		= "sync",
+	[BLK_LAT_FLUSH]		= "flush",
+	[BLK_LAT_DISCARD]	= "discard",
+};
+
+struct disk_latency_hist {
+	unsigned long queue[BLK_LAT_NR_OPS][BLK_LAT_BUCKETS];
+	unsigned long service[BLK_LAT_NR_OPS][BLK_LAT_BUCKETS];
+};
+
+int disk_alloc_latency_hist(struct gendisk *disk)
+{
+	disk->lat_hist = alloc_percpu(struct disk_latency_hist);
+	return disk->lat_hist ? 0 : -ENOMEM;
+}
+
+void disk_free_latency_hist(struct gendisk *disk)
+{
+	free_percpu(disk->lat_hist);
+}
+
+static int blk_lat_op(struct request *rq)
+{
+	if (rq->cmd_flags & REQ_DISCARD)
+		return BLK_LAT_DISCARD;
+	if (rq->cmd_flags & (REQ_FLUSH | REQ_FLUSH_SEQ))
+		return BLK_LAT_FLUSH;
+	if (!rq_data_dir(rq))
+		return BLK_LAT_READ;
+	if (rq->cmd_flags & REQ_SYNC)
+		return BLK_LAT_SYNC;
+	return BLK_LAT_WRITE;
+}
+
+static int blk_lat_bucket(u64 start, u64 end)
+{
+	u64 usecs;
+
+	/* sched_clock() of two different cpus may be a little apart */
+	if (end <= start)
+		return 0;
+
+	usecs = div_u64(end - start, NSEC_PER_USEC);
+	return min_t(int, fls64(usecs), BLK_LAT_BUCKETS - 1);
+}
+
+/**
+ * blk_account_io_latency - add a completed request to its disk's histograms
+ * @rq: the request being completed
+ *
+ * Called from the completion paths, possibly from interrupt context.
+ * Only requests that were dispatched to a driver are accounted.
+ */
+void blk_account_io_latency(struct request *rq)
+{
+	struct gendisk *disk = rq->rq_disk;
+	u64 start, issue, now;
+	int op;
+
+	if (!disk || !disk->lat_hist || rq->cmd_type != REQ_TYPE_FS)
+		return;
+
+	/*
+	 * The data part of a FLUSH/FUA sequence completes once on its own
+	 * and again when the whole sequence is done; only count the
+	 * latter.  The flush requests proper are q->flush_rq.
+	 */
+	if ((rq->cmd_flags & REQ_FLUSH_SEQ) && rq != &rq->q->flush_rq)
+		return;
+
+	issue = rq_io_start_time_ns(rq);
+	if (!issue)
+		return;
+	start = rq_start_time_ns(rq);
+	now = sched_clock();
+	op = blk_lat_op(rq);
+
+	irqsafe_cpu_inc(disk->lat_hist->queue[op][blk_lat_bucket(start, issue)]);
+	irqsafe_cpu_inc(disk->lat_hist->service[op][blk_lat_bucket(issue, now)]);
+}
+
+static unsigned long disk_latency_hist_sum(struct gendisk *disk,
+					   bool service, int op, int b)
+{
+	unsigned long sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct disk_latency_hist *h = per_cpu_ptr(disk->lat_hist, cpu);
+
+		sum += service ? h->service[op][b] : h->queue[op][b];
+	}
+	return sum;
+}
+
+static int disk_latency_hist_print(char *buf, int len,
+				   struct gendisk *disk, bool service)
+{
+	int op, b;
+
+	len += scnprintf(buf + len, PAGE_SIZE - len, "%-13s",
+			 service ? "service_usecs" : "queue_usecs");
+	for (op = 0; op < BLK_LAT_NR_OPS; op++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %10s",
+				 blk_lat_op_names[op]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	for (b = 0; b < BLK_LAT_BUCKETS; b++) {
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%-13lu",
+				 b ? 1UL << (b - 1) : 0UL);
+		for (op = 0; op < BLK_LAT_NR_OPS; op++)
+			len += scnprintf(buf + len, PAGE_SIZE - len, " %10lu",
+					 disk_latency_hist_sum(disk, service,
+							       op, b));
+		len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+	}
+	return len;
+}
+
+ssize_t disk_latency_hist_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct gendisk *disk = dev_to_disk(dev);
+	int len;
+
+	len = disk_latency_hist_print(buf, 0, disk, false);
+	return disk_latency_hist_print(buf, len, disk, true);
+}
+
+/*
+ * Resetting races with concurrent completions, which may land in the
+ * old counters; that is fine for a diagnostic histogram.
+ */
+ssize_t disk_latency_hist_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct gendisk *disk = dev_to_disk(dev);
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(disk->lat_hist, cpu), 0,
+		       sizeof(struct disk_latency_hist));
+	return count;
+}
@@ -0,0 +1,128 @@
+/*
+ * Tag allocation for the multiqueue block layer
+ *
+ * Each hardware queue owns a bitmap with one bit per request it can have
+ * in flight; the tag doubles as the index of the preallocated request.
+ * Every cpu starts searching where it last found a free tag, so that
+ * cpus mapped to the same queue mostly stay off each other's cachelines.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/bitops.h>
+#include <linux/percpu.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include <linux/blkdev.h>
+
+#include "blk-mq.h"
+
+struct blk_mq_tags {
+	unsigned int		nr_tags;
+	unsigned int __percpu	*hint;		/* last tag found, per cpu */
+	wait_queue_head_t	wait;		/* waiting for a free tag */
+	unsigned long		map[];
+};
+
+static int __blk_mq_get_tag(struct blk_mq_tags *tags)
+{
+	unsigned int *hint, start, tag;
+
+	hint = per_cpu_ptr(tags->hint, raw_smp_processor_id());
+	start = ACCESS_ONCE(*hint);
+	if (start >= tags->nr_tags)
+		start = 0;
+
+	tag = start;
+	do {
+		tag = find_next_zero_bit(tags->map, tags->nr_tags, tag);
+		if (tag >= tags->nr_tags) {
+			if (!start)
+				return -1;
+			/* wrap once and search up to the hint */
+			tag = 0;
+			start = 0;
+			continue;
+		}
+		if (!test_and_set_bit_lock(tag, tags->map)) {
+			*hint = tag + 1;
+			return tag;
+		}
+	} while (1);
+}
+
+/*
+ * Returns a free tag, or -1 if there is none and @gfp does not allow
+ * waiting for one.
+ */
+int blk_mq_get_tag(struct blk_mq_tags *tags, gfp_t gfp)
+{
+	DEFINE_WAIT(wait);
+	int tag;
+
+	tag = __blk_mq_get_tag(tags);
+	if (tag >= 0 || !(gfp & __GFP_WAIT))
+		return tag;
+
+	do {
+		prepare_to_wait(&tags->wait, &wait, TASK_UNINTERRUPTIBLE);
+		tag = __blk_mq_get_tag(tags);
+		if (tag >= 0)
+			break;
+		/* schedule() submits our plugged requests, freeing tags */
+		io_schedule();
+	} while (1);
+	finish_wait(&tags->wait, &wait);
+
+	return tag;
+}
+
+void blk_mq_put_tag(struct blk_mq_tags *tags, unsigned int tag)
+{
+	BUG_ON(tag >= tags->nr_tags);
+
+	clear_bit_unlock(tag, tags->map);
+	smp_mb__after_clear_bit();
+	if (waitqueue_active(&tags->wait))
+		wake_up(&tags->wait);
+}
+
+/*
+ * Call @fn for every tag in use.  The request behind a tag may complete
+ * concurrently; @fn has to cope with that.
+ */
+void blk_mq_tag_busy_iter(struct blk_mq_tags *tags,
+			  void (*fn)(void *data, unsigned int tag), void *data)
+{
+	unsigned int tag;
+
+	for_each_set_bit(tag, tags->map, tags->nr_tags)
+		fn(data, tag);
+}
+
+struct blk_mq_tags *blk_mq_init_tags(unsigned int nr_tags, int node)
+{
+	struct blk_mq_tags *tags;
+
+	tags = kzalloc_node(sizeof(*tags) +
+			    BITS_TO_LONGS(nr_tags) * sizeof(unsigned long),
+			    GFP_KERNEL, node);
+	if (!tags)
+		return NULL;
+
+	tags->hint = alloc_percpu(unsigned int);
+	if (!tags->hint) {
+		kfree(tags);
+		return NULL;
+	}
+
+	tags->nr_tags = nr_tags;
+	init_waitqueue_head(&tags->wait);
+	return tags;
+}
+
+void blk_mq_free_tags(struct blk_mq_tags *tags)
+{
+	free_percpu(tags->hint);
+	kfree(tags);
+}
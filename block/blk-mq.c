@@ -0,0 +1,949 @@
+/*
+ * Multiqueue block layer
+ *
+ * Queues registered through blk_mq_init_queue() bypass the elevator and
+ * q->queue_lock altogether.  A bio is turned into a request taken from a
+ * preallocated, tag indexed pool of the hardware queue the submitting cpu
+ * maps to, staged on that cpu's software queue (struct blk_mq_ctx) and
+ * handed straight to the driver's ->queue_rq() hook when the hardware
+ * queue is run.  The only shared state on the submission path is the tag
+ * bitmap and the software queue lock, which is per cpu.
+ *
+ * This suits devices with no seek penalty, where merging and sorting buy
+ * little and the single queue lock is the bottleneck: ramdisks, zram,
+ * flash and the null_blk benchmark driver.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/mm.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/smp.h>
+#include <linux/list_sort.h>
+#include <linux/cpu.h>
+#include <linux/cache.h>
+#include <linux/sched.h>
+#include <linux/delay.h>
+
+#include <trace/events/block.h>
+
+#include "blk.h"
+#include "blk-mq.h"
+
+/* msecs before a hardware queue the driver was busy on is run again */
+#define BLK_MQ_BUSY_DELAY	3
+
+static DEFINE_MUTEX(all_q_mutex);
+static LIST_HEAD(all_q_list);
+
+static struct blk_mq_ctx *__blk_mq_get_ctx(struct request_queue *q,
+					   unsigned int cpu)
+{
+	return per_cpu_ptr(q->queue_ctx, cpu);
+}
+
+/*
+ * This assumes per-cpu software queueing queues. They could be per-node
+ * as well, for instance. For now this is hardcoded as-is.
+ */
+static struct blk_mq_ctx *blk_mq_get_ctx(struct request_queue *q)
+{
+	return __blk_mq_get_ctx(q, raw_smp_processor_id());
+}
+
+/**
+ * blk_mq_map_queue - default cpu to hardware queue mapping
+ * @q:		the request queue
+ * @cpu:	the submitting cpu
+ */
+struct blk_mq_hw_ctx *blk_mq_map_queue(struct request_queue *q, const int cpu)
+{
+	return q->queue_hw_ctx[q->mq_map[cpu]];
+}
+EXPORT_SYMBOL(blk_mq_map_queue);
+
+static struct blk_mq_hw_ctx *blk_mq_rq_hctx(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	return q->mq_ops->map_queue(q, rq->mq_ctx->cpu);
+}
+
+/*
+ * Mark this ctx as having pending work in this hardware queue
+ */
+static void blk_mq_hctx_mark_pending(struct blk_mq_hw_ctx *hctx,
+				     struct blk_mq_ctx *ctx)
+{
+	if (!test_bit(ctx->index_hw, hctx->ctx_map))
+		set_bit(ctx->index_hw, hctx->ctx_map);
+}
+
+static struct request *__blk_mq_alloc_request(struct request_queue *q,
+					      struct blk_mq_ctx *ctx,
+					      int rw, gfp_t gfp)
+{
+	struct blk_mq_hw_ctx *hctx = q->mq_ops->map_queue(q, ctx->cpu);
+	struct request *rq;
+	int tag;
+
+	tag = blk_mq_get_tag(hctx->tags, gfp);
+	if (tag < 0)
+		return NULL;
+
+	rq = hctx->rqs[tag];
+	blk_rq_init(q, rq);
+	rq->tag = tag;
+	rq->mq_ctx = ctx;
+	rq->cpu = ctx->cpu;
+	rq->cmd_flags = rw;
+	return rq;
+}
+
+/**
+ * blk_mq_alloc_request - allocate a request on a multiqueue queue
+ * @q:		the request queue
+ * @rw:		READ or WRITE, plus request flags
+ * @gfp:	allocation mode; with __GFP_WAIT, waits for a free tag
+ *
+ * The request comes from the software queue of the current cpu.  Free it
+ * with blk_mq_free_request(), or blk_put_request().
+ */
+struct request *blk_mq_alloc_request(struct request_queue *q, int rw,
+				     gfp_t gfp)
+{
+	if (unlikely(test_bit(QUEUE_FLAG_DEAD, &q->queue_flags)))
+		return NULL;
+
+	return __blk_mq_alloc_request(q, blk_mq_get_ctx(q), rw, gfp);
+}
+EXPORT_SYMBOL(blk_mq_alloc_request);
+
+/**
+ * blk_mq_free_request - return a request and its tag to the hardware queue
+ * @rq:		the request
+ */
+void blk_mq_free_request(struct request *rq)
+{
+	struct blk_mq_hw_ctx *hctx = blk_mq_rq_hctx(rq);
+	unsigned int tag = rq->tag;
+
+	/* this is a bio leak */
+	WARN_ON(rq->bio != NULL);
+
+	rq->mq_ctx->rq_completed[rq_is_sync(rq)]++;
+	rq->cmd_flags = 0;
+	rq->atomic_flags = 0;
+	blk_mq_put_tag(hctx->tags, tag);
+}
+EXPORT_SYMBOL(blk_mq_free_request);
+
+/**
+ * blk_mq_end_io - complete all of a request
+ * @rq:		the request
+ * @error:	0 for success, < 0 for error
+ *
+ * Ends the bios of @rq and frees it, or calls its ->end_io() callback.
+ * May be called from interrupt context.
+ */
+void blk_mq_end_io(struct request *rq, int error)
+{
+	if (blk_update_request(rq, error, blk_rq_bytes(rq)))
+		BUG();
+
+	blk_account_io_done(rq);
+	blk_account_io_latency(rq);
+
+	if (rq->end_io)
+		rq->end_io(rq, error);
+	else
+		blk_mq_free_request(rq);
+}
+EXPORT_SYMBOL(blk_mq_end_io);
+
+/**
+ * blk_mq_complete_request - end a request, unless it has timed out
+ * @rq:		the request
+ * @error:	0 for success, < 0 for error
+ *
+ * Drivers which set a softirq_done_fn get it called from BLOCK_SOFTIRQ
+ * on the submitting cpu, with rq->errors set to @error; the handler then
+ * ends the request with blk_mq_end_io().  Otherwise the request is ended
+ * right away.
+ */
+void blk_mq_complete_request(struct request *rq, int error)
+{
+	struct request_queue *q = rq->q;
+
+	if (unlikely(blk_should_fake_timeout(q)))
+		return;
+	if (blk_mark_rq_complete(rq))
+		return;
+
+	rq->errors = error;
+	if (q->softirq_done_fn)
+		__blk_complete_request(rq);
+	else
+		blk_mq_end_io(rq, error);
+}
+EXPORT_SYMBOL(blk_mq_complete_request);
+
+static void blk_mq_start_request(struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	trace_block_rq_issue(q, rq);
+
+	set_io_start_time_ns(rq);
+	rq->deadline = jiffies + q->rq_timeout;
+	set_bit(REQ_ATOM_STARTED, &rq->atomic_flags);
+	if (!timer_pending(&q->timeout))
+		mod_timer(&q->timeout, round_jiffies_up(rq->deadline));
+}
+
+static void blk_mq_requeue_request(struct request *rq)
+{
+	trace_block_rq_requeue(rq->q, rq);
+	clear_bit(REQ_ATOM_STARTED, &rq->atomic_flags);
+}
+
+struct blk_mq_timeout_data {
+	struct blk_mq_hw_ctx *hctx;
+	unsigned long next;
+	unsigned int next_set;
+};
+
+static void blk_mq_check_expired(void *data, unsigned int tag)
+{
+	struct blk_mq_timeout_data *td = data;
+	struct request *rq = td->hctx->rqs[tag];
+	struct request_queue *q = rq->q;
+	enum blk_eh_timer_return ret = BLK_EH_RESET_TIMER;
+
+	if (!test_bit(REQ_ATOM_STARTED, &rq->atomic_flags))
+		return;
+
+	if (time_before(jiffies, rq->deadline)) {
+		if (!td->next_set || time_after(td->next, rq->deadline)) {
+			td->next = rq->deadline;
+			td->next_set = 1;
+		}
+		return;
+	}
+
+	/* The driver completed it meanwhile, or someone else timed it out */
+	if (blk_mark_rq_complete(rq))
+		return;
+
+	if (q->mq_ops->timeout)
+		ret = q->mq_ops->timeout(rq);
+
+	switch (ret) {
+	case BLK_EH_HANDLED:
+		blk_mq_end_io(rq, rq->errors ? rq->errors : -EIO);
+		break;
+	case BLK_EH_RESET_TIMER:
+		rq->deadline = jiffies + q->rq_timeout;
+		blk_clear_rq_complete(rq);
+		if (!td->next_set || time_after(td->next, rq->deadline)) {
+			td->next = rq->deadline;
+			td->next_set = 1;
+		}
+		break;
+	case BLK_EH_NOT_HANDLED:
+		/* the driver owns the request now and will end it */
+		break;
+	default:
+		printk(KERN_ERR "block: bad eh return: %d\n", ret);
+		break;
+	}
+}
+
+static void blk_mq_rq_timer(unsigned long data)
+{
+	struct request_queue *q = (struct request_queue *) data;
+	struct blk_mq_timeout_data td = { .next_set = 0 };
+	int i;
+
+	queue_for_each_hw_ctx(q, td.hctx, i)
+		blk_mq_tag_busy_iter(td.hctx->tags, blk_mq_check_expired, &td);
+
+	if (td.next_set)
+		mod_timer(&q->timeout, round_jiffies_up(td.next));
+}
+
+/*
+ * Pull queued requests off the software queues of this hardware queue
+ * and hand them to the driver, until it is out of resources.
+ */
+static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	struct request_queue *q = hctx->queue;
+	struct blk_mq_ctx *ctx;
+	struct request *rq;
+	LIST_HEAD(rq_list);
+	int bit, queued;
+
+	if (unlikely(test_bit(BLK_MQ_S_STOPPED, &hctx->state)))
+		return;
+
+	hctx->run++;
+
+	/*
+	 * Touch any software queue that has pending entries.
+	 */
+	for_each_set_bit(bit, hctx->ctx_map, hctx->nr_ctx) {
+		clear_bit(bit, hctx->ctx_map);
+		ctx = hctx->ctxs[bit];
+
+		spin_lock(&ctx->lock);
+		list_splice_tail_init(&ctx->rq_list, &rq_list);
+		spin_unlock(&ctx->lock);
+	}
+
+	/*
+	 * If we have previous entries on our dispatch list, grab them
+	 * and stuff them at the front for more fair dispatch.
+	 */
+	if (!list_empty_careful(&hctx->dispatch)) {
+		spin_lock(&hctx->lock);
+		if (!list_empty(&hctx->dispatch))
+			list_splice_init(&hctx->dispatch, &rq_list);
+		spin_unlock(&hctx->lock);
+	}
+
+	/*
+	 * Now process all the entries, sending them to the driver.
+	 */
+	queued = 0;
+	while (!list_empty(&rq_list)) {
+		int ret;
+
+		rq = list_first_entry(&rq_list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		blk_mq_start_request(rq);
+
+		ret = q->mq_ops->queue_rq(hctx, rq);
+		switch (ret) {
+		case BLK_MQ_RQ_QUEUE_OK:
+			queued++;
+			continue;
+		case BLK_MQ_RQ_QUEUE_BUSY:
+			/*
+			 * Park it and the rest on hctx->dispatch, they are
+			 * retried first on the next run, see below.
+			 */
+			list_add(&rq->queuelist, &rq_list);
+			blk_mq_requeue_request(rq);
+			break;
+		default:
+			printk(KERN_ERR "blk-mq: bad return on queue: %d\n",
+			       ret);
+		case BLK_MQ_RQ_QUEUE_ERROR:
+			blk_mq_end_io(rq, -EIO);
+			continue;
+		}
+
+		/*
+		 * Last request was busy, bail out.
+		 */
+		break;
+	}
+
+	hctx->queued += queued;
+
+	/*
+	 * Any items that need requeuing? Stuff them into hctx->dispatch,
+	 * that is where we will continue on next queue run.
+	 */
+	if (!list_empty(&rq_list)) {
+		spin_lock(&hctx->lock);
+		list_splice(&rq_list, &hctx->dispatch);
+		spin_unlock(&hctx->lock);
+
+		/*
+		 * The driver was busy.  If it stopped the queue, it restarts
+		 * it with blk_mq_start_stopped_hw_queues() once it has the
+		 * resources again.  Otherwise nothing may run the queue before
+		 * the next submission, so retry from kblockd after a short
+		 * delay instead of spinning on ->queue_rq().
+		 */
+		if (!test_bit(BLK_MQ_S_STOPPED, &hctx->state))
+			kblockd_schedule_delayed_work(q, &hctx->delayed_work,
+					msecs_to_jiffies(BLK_MQ_BUSY_DELAY));
+	}
+}
+
+/**
+ * blk_mq_run_hw_queue - dispatch the requests pending on a hardware queue
+ * @hctx:	the hardware queue
+ * @async:	punt the work to kblockd instead of running it here
+ */
+void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx, bool async)
+{
+	if (unlikely(test_bit(BLK_MQ_S_STOPPED, &hctx->state)))
+		return;
+
+	if (!async && cpumask_test_cpu(raw_smp_processor_id(), hctx->cpumask))
+		__blk_mq_run_hw_queue(hctx);
+	else
+		kblockd_schedule_delayed_work(hctx->queue,
+					      &hctx->delayed_work, 0);
+}
+EXPORT_SYMBOL(blk_mq_run_hw_queue);
+
+void blk_mq_run_queues(struct request_queue *q, bool async)
+{
+	struct blk_mq_hw_ctx *hctx;
+	int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (bitmap_empty(hctx->ctx_map, hctx->nr_ctx) &&
+		    list_empty_careful(&hctx->dispatch))
+			continue;
+		blk_mq_run_hw_queue(hctx, async);
+	}
+}
+EXPORT_SYMBOL(blk_mq_run_queues);
+
+/**
+ * blk_mq_stop_hw_queue - stop dispatching to a hardware queue
+ * @hctx:	the hardware queue
+ *
+ * For drivers out of resources; restart with blk_mq_start_stopped_hw_queues.
+ */
+void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	cancel_delayed_work(&hctx->delayed_work);
+	set_bit(BLK_MQ_S_STOPPED, &hctx->state);
+}
+EXPORT_SYMBOL(blk_mq_stop_hw_queue);
+
+/*
+ * Callable from any context: the queues are run from kblockd.
+ */
+void blk_mq_start_stopped_hw_queues(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	int i;
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (!test_bit(BLK_MQ_S_STOPPED, &hctx->state))
+			continue;
+
+		clear_bit(BLK_MQ_S_STOPPED, &hctx->state);
+		blk_mq_run_hw_queue(hctx, true);
+	}
+}
+EXPORT_SYMBOL(blk_mq_start_stopped_hw_queues);
+
+static void blk_mq_work_fn(struct work_struct *work)
+{
+	struct blk_mq_hw_ctx *hctx;
+
+	hctx = container_of(work, struct blk_mq_hw_ctx, delayed_work.work);
+	__blk_mq_run_hw_queue(hctx);
+}
+
+static void __blk_mq_insert_request(struct blk_mq_hw_ctx *hctx,
+				    struct request *rq, bool at_head)
+{
+	struct blk_mq_ctx *ctx = rq->mq_ctx;
+
+	trace_block_rq_insert(hctx->queue, rq);
+
+	if (at_head)
+		list_add(&rq->queuelist, &ctx->rq_list);
+	else
+		list_add_tail(&rq->queuelist, &ctx->rq_list);
+	blk_mq_hctx_mark_pending(hctx, ctx);
+}
+
+/**
+ * blk_mq_insert_request - queue a prepared request for dispatch
+ * @rq:		request from blk_mq_alloc_request()
+ * @at_head:	queue ahead of the other requests of its software queue
+ * @run_queue:	run the hardware queue after inserting
+ * @async:	run it from kblockd
+ */
+void blk_mq_insert_request(struct request *rq, bool at_head, bool run_queue,
+			   bool async)
+{
+	struct blk_mq_hw_ctx *hctx = blk_mq_rq_hctx(rq);
+	struct blk_mq_ctx *ctx = rq->mq_ctx;
+
+	spin_lock(&ctx->lock);
+	__blk_mq_insert_request(hctx, rq, at_head);
+	spin_unlock(&ctx->lock);
+
+	if (run_queue)
+		blk_mq_run_hw_queue(hctx, async);
+}
+EXPORT_SYMBOL(blk_mq_insert_request);
+
+static void blk_mq_insert_requests(struct request_queue *q,
+				   struct blk_mq_ctx *ctx,
+				   struct list_head *list, int depth,
+				   bool from_schedule)
+{
+	struct blk_mq_hw_ctx *hctx = q->mq_ops->map_queue(q, ctx->cpu);
+
+	trace_block_unplug(q, depth, !from_schedule);
+
+	spin_lock(&ctx->lock);
+	while (!list_empty(list)) {
+		struct request *rq;
+
+		rq = list_first_entry(list, struct request, queuelist);
+		list_del_init(&rq->queuelist);
+		__blk_mq_insert_request(hctx, rq, false);
+	}
+	spin_unlock(&ctx->lock);
+
+	blk_mq_run_hw_queue(hctx, from_schedule);
+}
+
+static int plug_ctx_cmp(void *priv, struct list_head *a, struct list_head *b)
+{
+	struct request *rqa = container_of(a, struct request, queuelist);
+	struct request *rqb = container_of(b, struct request, queuelist);
+
+	return !(rqa->mq_ctx < rqb->mq_ctx ||
+		 (rqa->mq_ctx == rqb->mq_ctx &&
+		  blk_rq_pos(rqa) < blk_rq_pos(rqb)));
+}
+
+/*
+ * Called from blk_flush_plug_list(): move the plugged requests to their
+ * software queues, one lock round trip per queue, and run the hardware
+ * queues.
+ */
+void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule)
+{
+	struct blk_mq_ctx *this_ctx;
+	struct request_queue *this_q;
+	struct request *rq;
+	LIST_HEAD(list);
+	LIST_HEAD(ctx_list);
+	unsigned int depth;
+
+	list_splice_init(&plug->mq_list, &list);
+
+	list_sort(NULL, &list, plug_ctx_cmp);
+
+	this_q = NULL;
+	this_ctx = NULL;
+	depth = 0;
+
+	while (!list_empty(&list)) {
+		rq = list_entry_rq(list.next);
+		list_del_init(&rq->queuelist);
+		BUG_ON(!rq->q);
+		if (rq->mq_ctx != this_ctx) {
+			if (this_ctx) {
+				blk_mq_insert_requests(this_q, this_ctx,
+						       &ctx_list, depth,
+						       from_schedule);
+			}
+
+			this_ctx = rq->mq_ctx;
+			this_q = rq->q;
+			depth = 0;
+		}
+
+		depth++;
+		list_add_tail(&rq->queuelist, &ctx_list);
+	}
+
+	/*
+	 * If 'this_ctx' is set, we know we have entries to complete
+	 * on 'ctx_list'. Do those.
+	 */
+	if (this_ctx) {
+		blk_mq_insert_requests(this_q, this_ctx, &ctx_list, depth,
+				       from_schedule);
+	}
+}
+
+/*
+ * Try a back merge with the last request queued for the same device,
+ * either in the plug or on the software queue.
+ */
+static bool blk_mq_attempt_merge(struct request_queue *q, struct request *rq,
+				 struct bio *bio)
+{
+	if (!rq_mergeable(rq) || bio_data_dir(bio) != rq_data_dir(rq))
+		return false;
+	if (rq->q != q || rq->rq_disk != bio->bi_bdev->bd_disk)
+		return false;
+	if (bio_integrity(bio) != blk_integrity_rq(rq))
+		return false;
+	if (blk_rq_pos(rq) + blk_rq_sectors(rq) != bio->bi_sector)
+		return false;
+
+	return bio_attempt_back_merge(q, rq, bio);
+}
+
+static bool blk_mq_merge_queue_io(struct request_queue *q,
+				  struct blk_mq_ctx *ctx, struct bio *bio)
+{
+	struct blk_plug *plug = current->plug;
+	bool merged = false;
+
+	if (plug && !list_empty(&plug->mq_list) &&
+	    blk_mq_attempt_merge(q, list_entry_rq(plug->mq_list.prev), bio))
+		return true;
+
+	spin_lock(&ctx->lock);
+	if (!list_empty(&ctx->rq_list)) {
+		merged = blk_mq_attempt_merge(q,
+				list_entry_rq(ctx->rq_list.prev), bio);
+		if (merged)
+			ctx->rq_merged++;
+	}
+	spin_unlock(&ctx->lock);
+
+	return merged;
+}
+
+static int blk_mq_make_request(struct request_queue *q, struct bio *bio)
+{
+	const int is_sync = rw_is_sync(bio->bi_rw);
+	const int is_flush_fua = bio->bi_rw & (REQ_FLUSH | REQ_FUA);
+	struct blk_mq_hw_ctx *hctx;
+	struct blk_mq_ctx *ctx;
+	struct blk_plug *plug;
+	struct request *rq;
+	int rw = bio_data_dir(bio);
+
+	blk_queue_bounce(q, &bio);
+
+	ctx = blk_mq_get_ctx(q);
+	hctx = q->mq_ops->map_queue(q, ctx->cpu);
+
+	if (!is_flush_fua && (hctx->flags & BLK_MQ_F_SHOULD_MERGE) &&
+	    !blk_queue_nomerges(q) && blk_mq_merge_queue_io(q, ctx, bio))
+		return 0;
+
+	if (is_sync)
+		rw |= REQ_SYNC;
+
+	trace_block_getrq(q, bio, rw);
+	/* Grab a free tag.  This may sleep, but cannot fail. */
+	rq = __blk_mq_alloc_request(q, ctx, rw, GFP_NOIO);
+	ctx->rq_dispatched[is_sync]++;
+
+	init_request_from_bio(rq, bio);
+	rq->cpu = ctx->cpu;
+	drive_stat_acct(rq, 1);
+
+	/*
+	 * Flush and FUA requests are passed on as they are, in order; a
+	 * driver that registered flush support has to honour them.  They
+	 * are not held in the plug either, so that they cannot be
+	 * reordered against other requests from this task.
+	 */
+	plug = current->plug;
+	if (plug && !is_flush_fua) {
+		if (list_empty(&plug->mq_list))
+			trace_block_plug(q);
+		list_add_tail(&rq->queuelist, &plug->mq_list);
+		return 0;
+	}
+
+	/*
+	 * Without a plug, issue right away: for a synchronous request
+	 * on this cpu that is a direct call into ->queue_rq().
+	 */
+	blk_mq_insert_request(rq, false, true, !is_sync);
+	return 0;
+}
+
+/*
+ * Called from blk_sync_queue(): make sure no queue runs are pending.
+ */
+void blk_mq_sync_queue(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	int i;
+
+	queue_for_each_hw_ctx(q, hctx, i)
+		cancel_delayed_work_sync(&hctx->delayed_work);
+}
+
+static void blk_mq_free_rqs(struct blk_mq_hw_ctx *hctx, unsigned int depth)
+{
+	unsigned int i;
+
+	if (!hctx->rqs)
+		return;
+
+	for (i = 0; i < depth; i++)
+		kfree(hctx->rqs[i]);
+	kfree(hctx->rqs);
+	hctx->rqs = NULL;
+}
+
+static int blk_mq_init_rqs(struct blk_mq_hw_ctx *hctx, struct blk_mq_reg *reg)
+{
+	unsigned int i;
+
+	hctx->rqs = kzalloc_node(reg->queue_depth * sizeof(struct request *),
+				 GFP_KERNEL, hctx->numa_node);
+	if (!hctx->rqs)
+		return -ENOMEM;
+
+	for (i = 0; i < reg->queue_depth; i++) {
+		hctx->rqs[i] = kzalloc_node(sizeof(struct request) +
+					    reg->cmd_size, GFP_KERNEL,
+					    hctx->numa_node);
+		if (!hctx->rqs[i])
+			goto fail;
+		INIT_LIST_HEAD(&hctx->rqs[i]->queuelist);
+	}
+
+	hctx->queue_depth = reg->queue_depth;
+	hctx->tags = blk_mq_init_tags(reg->queue_depth, hctx->numa_node);
+	if (!hctx->tags)
+		goto fail;
+	return 0;
+
+fail:
+	blk_mq_free_rqs(hctx, reg->queue_depth);
+	return -ENOMEM;
+}
+
+/*
+ * Spread the possible cpus over the hardware queues in contiguous groups,
+ * so that cpus sharing a queue are likely to share a cache as well.
+ */
+static void blk_mq_map_swqueue(struct request_queue *q)
+{
+	unsigned int i, nr_cpus = num_possible_cpus();
+	unsigned int n = 0;
+	struct blk_mq_hw_ctx *hctx;
+	struct blk_mq_ctx *ctx;
+
+	for_each_possible_cpu(i) {
+		q->mq_map[i] = n * q->nr_hw_queues / nr_cpus;
+		n++;
+	}
+
+	for_each_possible_cpu(i) {
+		ctx = __blk_mq_get_ctx(q, i);
+		hctx = q->queue_hw_ctx[q->mq_map[i]];
+		cpumask_set_cpu(i, hctx->cpumask);
+		ctx->index_hw = hctx->nr_ctx;
+		hctx->ctxs[hctx->nr_ctx++] = ctx;
+	}
+}
+
+static void blk_mq_free_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	if (hctx->tags)
+		blk_mq_free_tags(hctx->tags);
+	blk_mq_free_rqs(hctx, hctx->queue_depth);
+	free_cpumask_var(hctx->cpumask);
+	kfree(hctx->ctx_map);
+	kfree(hctx->ctxs);
+	kfree(hctx);
+}
+
+/**
+ * blk_mq_init_queue - set up a multiqueue request queue
+ * @reg:		number and depth of the hardware queues, driver hooks
+ * @driver_data:	stored in q->queuedata, and passed to ->init_hctx
+ *
+ * Returns the queue, or an ERR_PTR.  The queue is torn down with
+ * blk_cleanup_queue() like any other.
+ */
+struct request_queue *blk_mq_init_queue(struct blk_mq_reg *reg,
+					void *driver_data)
+{
+	struct blk_mq_hw_ctx *hctx;
+	struct request_queue *q;
+	unsigned int i, j;
+	int ret = -ENOMEM;
+
+	if (!reg->nr_hw_queues || !reg->ops->queue_rq ||
+	    !reg->ops->map_queue || !reg->queue_depth)
+		return ERR_PTR(-EINVAL);
+
+	if (reg->queue_depth > BLK_MQ_MAX_DEPTH) {
+		printk(KERN_WARNING "blk-mq: queue depth %u too large, "
+		       "using %u\n", reg->queue_depth, BLK_MQ_MAX_DEPTH);
+		reg->queue_depth = BLK_MQ_MAX_DEPTH;
+	}
+	if (reg->nr_hw_queues > nr_cpu_ids)
+		reg->nr_hw_queues = nr_cpu_ids;
+
+	q = blk_alloc_queue_node(GFP_KERNEL, reg->numa_node);
+	if (!q)
+		return ERR_PTR(-ENOMEM);
+
+	q->mq_ops = reg->ops;
+	q->queuedata = driver_data;
+	q->nr_hw_queues = reg->nr_hw_queues;
+
+	q->queue_ctx = alloc_percpu(struct blk_mq_ctx);
+	q->mq_map = kzalloc_node(nr_cpu_ids * sizeof(unsigned int),
+				 GFP_KERNEL, reg->numa_node);
+	q->queue_hw_ctx = kzalloc_node(reg->nr_hw_queues * sizeof(hctx),
+				       GFP_KERNEL, reg->numa_node);
+	if (!q->queue_ctx || !q->mq_map || !q->queue_hw_ctx)
+		goto err_queue;
+
+	for_each_possible_cpu(i) {
+		struct blk_mq_ctx *ctx = __blk_mq_get_ctx(q, i);
+
+		memset(ctx, 0, sizeof(*ctx));
+		spin_lock_init(&ctx->lock);
+		INIT_LIST_HEAD(&ctx->rq_list);
+		ctx->cpu = i;
+		ctx->queue = q;
+	}
+
+	for (i = 0; i < reg->nr_hw_queues; i++) {
+		int node = reg->numa_node;
+
+		hctx = kzalloc_node(sizeof(*hctx), GFP_KERNEL, node);
+		if (!hctx)
+			goto err_hctxs;
+		q->queue_hw_ctx[i] = hctx;
+
+		spin_lock_init(&hctx->lock);
+		INIT_LIST_HEAD(&hctx->dispatch);
+		INIT_DELAYED_WORK(&hctx->delayed_work, blk_mq_work_fn);
+		hctx->queue = q;
+		hctx->queue_num = i;
+		hctx->flags = reg->flags;
+		hctx->numa_node = node;
+
+		if (!zalloc_cpumask_var_node(&hctx->cpumask, GFP_KERNEL, node))
+			goto err_hctxs;
+		hctx->ctxs = kzalloc_node(nr_cpu_ids * sizeof(void *),
+					  GFP_KERNEL, node);
+		hctx->ctx_map = kzalloc_node(BITS_TO_LONGS(nr_cpu_ids) *
+					     sizeof(unsigned long),
+					     GFP_KERNEL, node);
+		if (!hctx->ctxs || !hctx->ctx_map)
+			goto err_hctxs;
+		if (blk_mq_init_rqs(hctx, reg))
+			goto err_hctxs;
+	}
+
+	for (j = 0; j < reg->nr_hw_queues; j++) {
+		hctx = q->queue_hw_ctx[j];
+		if (reg->ops->init_hctx &&
+		    reg->ops->init_hctx(hctx, driver_data, j)) {
+			ret = -EIO;
+			goto err_init;
+		}
+	}
+
+	blk_queue_make_request(q, blk_mq_make_request);
+	blk_queue_rq_timeout(q, reg->timeout ? reg->timeout : 30 * HZ);
+	setup_timer(&q->timeout, blk_mq_rq_timer, (unsigned long) q);
+	q->nr_requests = reg->queue_depth;
+
+	blk_mq_map_swqueue(q);
+
+	mutex_lock(&all_q_mutex);
+	list_add_tail(&q->all_q_node, &all_q_list);
+	mutex_unlock(&all_q_mutex);
+
+	return q;
+
+err_init:
+	while (j--) {
+		if (reg->ops->exit_hctx)
+			reg->ops->exit_hctx(q->queue_hw_ctx[j], j);
+	}
+	/* don't call ->exit_hctx again below */
+	q->mq_ops = NULL;
+err_hctxs:
+	for (i = 0; i < reg->nr_hw_queues; i++) {
+		if (q->queue_hw_ctx[i])
+			blk_mq_free_hctx(q->queue_hw_ctx[i]);
+	}
+err_queue:
+	kfree(q->queue_hw_ctx);
+	kfree(q->mq_map);
+	free_percpu(q->queue_ctx);
+	q->queue_hw_ctx = NULL;
+	q->mq_map = NULL;
+	q->queue_ctx = NULL;
+	q->nr_hw_queues = 0;
+	q->mq_ops = NULL;
+	blk_cleanup_queue(q);
+	return ERR_PTR(ret);
+}
+EXPORT_SYMBOL(blk_mq_init_queue);
+
+/*
+ * Called when the last reference to the queue is dropped.
+ */
+void blk_mq_free_queue(struct request_queue *q)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	mutex_lock(&all_q_mutex);
+	list_del_init(&q->all_q_node);
+	mutex_unlock(&all_q_mutex);
+
+	queue_for_each_hw_ctx(q, hctx, i) {
+		if (q->mq_ops->exit_hctx)
+			q->mq_ops->exit_hctx(hctx, i);
+		blk_mq_free_hctx(hctx);
+	}
+
+	kfree(q->queue_hw_ctx);
+	kfree(q->mq_map);
+	free_percpu(q->queue_ctx);
+	q->queue_hw_ctx = NULL;
+	q->mq_map = NULL;
+	q->queue_ctx = NULL;
+}
+
+/*
+ * A cpu went away.  Whatever it left on its software queue stays there,
+ * tag and all, but the hardware queue may have no online cpu left to run
+ * it synchronously: kick it from kblockd.
+ */
+static void blk_mq_hctx_notify_dead(struct request_queue *q, unsigned int cpu)
+{
+	struct blk_mq_ctx *ctx = __blk_mq_get_ctx(q, cpu);
+	struct blk_mq_hw_ctx *hctx = q->mq_ops->map_queue(q, cpu);
+
+	if (!list_empty_careful(&ctx->rq_list))
+		blk_mq_run_hw_queue(hctx, true);
+}
+
+static int __cpuinit blk_mq_queue_reinit_notify(struct notifier_block *nb,
+						unsigned long action,
+						void *hcpu)
+{
+	struct request_queue *q;
+
+	if (action != CPU_DEAD && action != CPU_DEAD_FROZEN)
+		return NOTIFY_OK;
+
+	mutex_lock(&all_q_mutex);
+	list_for_each_entry(q, &all_q_list, all_q_node)
+		blk_mq_hctx_notify_dead(q, (long) hcpu);
+	mutex_unlock(&all_q_mutex);
+
+	return NOTIFY_OK;
+}
+
+static int __init blk_mq_init(void)
+{
+	hotcpu_notifier(blk_mq_queue_reinit_notify, 0);
+	return 0;
+}
+subsys_initcall(blk_mq_init);
@@ -0,0 +1,20 @@
+#ifndef INT_BLK_MQ_H
+#define INT_BLK_MQ_H
+
+struct blk_mq_tags;
+
+void blk_mq_flush_plug_list(struct blk_plug *plug, bool from_schedule);
+void blk_mq_sync_queue(struct request_queue *q);
+void blk_mq_free_queue(struct request_queue *q);
+
+/*
+ * Tag allocation, blk-mq-tag.c
+ */
+struct blk_mq_tags *blk_mq_init_tags(unsigned int nr_tags, int node);
+void blk_mq_free_tags(struct blk_mq_tags *tags);
+int blk_mq_get_tag(struct blk_mq_tags *tags, gfp_t gfp);
+void blk_mq_put_tag(struct blk_mq_tags *tags, unsigned int tag);
+void blk_mq_tag_busy_iter(struct blk_mq_tags *tags,
+			  void (*fn)(void *data, unsigned int tag), void *data);
+
+#endif
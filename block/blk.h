@@ -23,11 +23,17 @@ void blk_delete_timer(struct request *);
 void blk_add_timer(struct request *);
 void __generic_unplug_device(struct request_queue *);
 
+void drive_stat_acct(struct request *rq, int new_io);
+void blk_account_io_done(struct request *req);
+bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
+			    struct bio *bio);
+
 /*
  * Internal atomic flags for request handling
  */
 enum rq_atomic_flags {
 	REQ_ATOM_COMPLETE = 0,
+	REQ_ATOM_STARTED,	/* blk-mq: handed to the driver */
 };
 
 /*
@@ -116,6 +122,23 @@ static inline int blk_should_fake_timeout(struct request_queue *q)
 }
 #endif
 
+#ifdef CONFIG_BLK_LATENCY_HIST
+int disk_alloc_latency_hist(struct gendisk *disk);
+void disk_free_latency_hist(struct gendisk *disk);
+void blk_account_io_latency(struct request *rq);
+ssize_t disk_latency_hist_show(struct device *, struct device_attribute *,
+			       char *);
+ssize_t disk_latency_hist_store(struct device *, struct device_attribute *,
+				const char *, size_t);
+#else
+static inline int disk_alloc_latency_hist(struct gendisk *disk)
+{
+	return 0;
+}
+static inline void disk_free_latency_hist(struct gendisk *disk) {}
+static inline void blk_account_io_latency(struct request *rq) {}
+#endif
+
 struct io_context *current_io_context(gfp_t gfp_flags, int node);
 
 int ll_back_merge_fn(struct request_queue *q, struct request *req,
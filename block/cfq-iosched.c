@@ -44,6 +44,14 @@ static const int cfq_hist_divisor = 4;
  */
 #define CFQ_MIN_TT		(2)
 
+/*
+ * group latency mode: queue depth limit of groups that hold back another
+ * group's latency target, and how long a target stays in force after the
+ * last completion of its group
+ */
+#define CFQ_LATENCY_DEPTH_MAX	(32)
+#define CFQ_LATENCY_IDLE	(HZ / 5)
+
 #define CFQ_SLICE_SCALE		(5)
 #define CFQ_HW_QUEUE_MIN	(5)
 #define CFQ_SERVICE_SHIFT       12
@@ -212,6 +220,13 @@ struct cfq_group {
 #endif
 	/* number of requests that are on the dispatch list or inside driver */
 	int dispatched;
+
+	/* group latency mode: target and average of sync requests, in usecs */
+	unsigned int latency_target;
+	unsigned int latency_avg;
+	/* set from blkio.latency_target, applied under the queue lock */
+	unsigned int new_latency_target;
+	bool latency_needs_update;
 };
 
 /*
@@ -287,6 +302,18 @@ struct cfq_data {
 	unsigned int cfq_slice_idle;
 	unsigned int cfq_group_idle;
 	unsigned int cfq_latency;
+	unsigned int cfq_group_latency;
+
+	/*
+	 * group latency mode: the tightest latency target that is being
+	 * missed, and the number of requests groups with a looser or no
+	 * target may have in flight while it is.  latency_last is the last
+	 * completion of a group with that target or a tighter one.
+	 */
+	unsigned int latency_missed;
+	unsigned int latency_depth;
+	unsigned long latency_next_cut;
+	unsigned long latency_last;
 
 	unsigned int cic_index;
 	struct list_head cic_list;
@@ -648,6 +675,101 @@ static inline bool cfq_slice_used(struct cfq_queue *cfqq)
 	return true;
 }
 
+/*
+ * Group latency mode.  Instead of idling to protect a group, groups may
+ * be given a completion latency target (blkio.latency_target).  While a
+ * group misses its target, groups with a looser or no target get their
+ * queue depth halved, at most once per target period, and it grows back
+ * by one request per completion that meets the target again.
+ */
+static inline bool cfq_latency_limited(struct cfq_data *cfqd,
+				       struct cfq_group *cfqg)
+{
+	if (!cfqd->cfq_group_latency || !cfqd->latency_missed)
+		return false;
+
+	/* gone quiet, cfq_update_group_latency() lifts the limit */
+	if (time_after(jiffies, cfqd->latency_last + CFQ_LATENCY_IDLE))
+		return false;
+
+	return !cfqg->latency_target ||
+		cfqg->latency_target > cfqd->latency_missed;
+}
+
+static inline bool cfq_latency_at_limit(struct cfq_data *cfqd,
+					struct cfq_group *cfqg)
+{
+	return cfq_latency_limited(cfqd, cfqg) &&
+		cfqg->dispatched >= cfqd->latency_depth;
+}
+
+static void cfq_update_group_latency_target(struct cfq_group *cfqg)
+{
+	if (cfqg->latency_needs_update) {
+		cfqg->latency_needs_update = false;
+		smp_rmb();
+		cfqg->latency_target = cfqg->new_latency_target;
+		cfqg->latency_avg = 0;
+	}
+}
+
+static void cfq_update_group_latency(struct cfq_data *cfqd,
+				     struct cfq_group *cfqg, struct request *rq)
+{
+#ifdef CONFIG_CFQ_GROUP_IOSCHED
+	u64 lat;
+
+	cfq_update_group_latency_target(cfqg);
+
+	if (!cfqd->cfq_group_latency)
+		return;
+
+	if (cfqd->latency_missed &&
+	    time_after(jiffies, cfqd->latency_last + CFQ_LATENCY_IDLE)) {
+		/* the groups that missed their target went quiet */
+		cfqd->latency_missed = 0;
+		cfqd->latency_depth = CFQ_LATENCY_DEPTH_MAX;
+	}
+
+	if (!cfqg->latency_target || !rq_is_sync(rq))
+		return;
+
+	lat = sched_clock() - rq_start_time_ns(rq);
+	if ((s64)lat < 0)
+		lat = 0;
+	do_div(lat, NSEC_PER_USEC);
+	lat = min_t(u64, lat, UINT_MAX / 8);
+
+	/* running average over roughly the last 8 requests */
+	cfqg->latency_avg = (7 * cfqg->latency_avg + (unsigned int)lat) / 8;
+
+	if (cfqg->latency_avg > cfqg->latency_target) {
+		if (!cfqd->latency_missed ||
+		    cfqg->latency_target < cfqd->latency_missed)
+			cfqd->latency_missed = cfqg->latency_target;
+		if (time_after_eq(jiffies, cfqd->latency_next_cut)) {
+			cfqd->latency_depth = max(cfqd->latency_depth / 2, 1U);
+			cfqd->latency_next_cut = jiffies +
+				max(usecs_to_jiffies(cfqg->latency_target), 1UL);
+			cfq_log(cfqd, "latency: depth %u, avg %u target %u",
+				cfqd->latency_depth, cfqg->latency_avg,
+				cfqg->latency_target);
+		}
+	} else if (cfqd->latency_missed &&
+		   cfqg->latency_target <= cfqd->latency_missed) {
+		if (++cfqd->latency_depth >= CFQ_LATENCY_DEPTH_MAX) {
+			cfqd->latency_depth = CFQ_LATENCY_DEPTH_MAX;
+			cfqd->latency_missed = 0;
+		}
+	}
+
+	/* only the groups the limit protects keep it in force */
+	if (cfqd->latency_missed &&
+	    cfqg->latency_target <= cfqd->latency_missed)
+		cfqd->latency_last = jiffies;
+#endif
+}
+
 /*
  * Lifted from AS - choose which of rq1 and rq2 that is best served now.
  * We choose the request that is closest to the head right now. Distance
@@ -868,6 +990,7 @@ cfq_group_service_tree_add(struct cfq_rb_root *st, struct cfq_group *cfqg)
 	BUG_ON(!RB_EMPTY_NODE(&cfqg->rb_node));
 
 	cfq_update_group_weight(cfqg);
+	cfq_update_group_latency_target(cfqg);
 	__cfq_group_service_tree_add(st, cfqg);
 	st->total_weight += cfqg->weight;
 }
@@ -1013,6 +1136,20 @@ void cfq_update_blkio_group_weight(void *key, struct blkio_group *blkg,
 	cfqg->needs_update = true;
 }
 
+void cfq_update_blkio_group_latency_target(void *key, struct blkio_group *blkg,
+					   unsigned int latency_target)
+{
+	struct cfq_group *cfqg = cfqg_of_blkg(blkg);
+
+	/*
+	 * Called under blkcg->lock, which nests inside the queue lock:
+	 * picked up when the group is next queued or completes a request.
+	 */
+	cfqg->new_latency_target = latency_target;
+	smp_wmb();
+	cfqg->latency_needs_update = true;
+}
+
 static void cfq_init_add_cfqg_lists(struct cfq_data *cfqd,
 			struct cfq_group *cfqg, struct blkio_cgroup *blkcg)
 {
@@ -1035,6 +1172,7 @@ static void cfq_init_add_cfqg_lists(struct cfq_data *cfqd,
 
 	cfqd->nr_blkcg_linked_grps++;
 	cfqg->weight = blkcg_get_weight(blkcg, cfqg->blkg.dev);
+	cfqg->latency_target = blkcg_get_latency_target(blkcg);
 
 	/* Add group on cfqd list */
 	hlist_add_head(&cfqg->cfqd_node, &cfqd->cfqg_list);
@@ -1953,7 +2091,7 @@ static bool cfq_should_idle(struct cfq_data *cfqd, struct cfq_queue *cfqq)
 	BUG_ON(!service_tree);
 	BUG_ON(!service_tree->count);
 
-	if (!cfqd->cfq_slice_idle)
+	if (!cfqd->cfq_slice_idle || cfqd->cfq_group_latency)
 		return false;
 
 	/* We never do for idle class queues. */
@@ -1990,6 +2128,10 @@ static void cfq_arm_slice_timer(struct cfq_data *cfqd)
 	if (blk_queue_nonrot(cfqd->queue) && cfqd->hw_tag)
 		return;
 
+	/* group latency mode protects groups without idling */
+	if (cfqd->cfq_group_latency)
+		return;
+
 	WARN_ON(!RB_EMPTY_ROOT(&cfqq->sort_list));
 	WARN_ON(cfq_cfqq_slice_new(cfqq));
 
@@ -2267,6 +2409,21 @@ static struct cfq_group *cfq_get_next_cfqg(struct cfq_data *cfqd)
 	if (RB_EMPTY_ROOT(&st->rb))
 		return NULL;
 	cfqg = cfq_rb_first_group(st);
+
+	/*
+	 * In group latency mode, pass over groups that are at their depth
+	 * limit in favour of the next one that may dispatch.
+	 */
+	if (cfq_latency_at_limit(cfqd, cfqg)) {
+		struct rb_node *n = rb_next(&cfqg->rb_node);
+
+		for (; n; n = rb_next(n)) {
+			if (!cfq_latency_at_limit(cfqd, rb_entry_cfqg(n))) {
+				cfqg = rb_entry_cfqg(n);
+				break;
+			}
+		}
+	}
 	update_min_vdisktime(st);
 	return cfqg;
 }
@@ -2303,6 +2460,14 @@ static struct cfq_queue *cfq_select_queue(struct cfq_data *cfqd)
 	if (!cfqd->rq_queued)
 		return NULL;
 
+	/*
+	 * Don't let a group at its latency depth limit hold on to the
+	 * device while other groups have requests
+	 */
+	if (cfq_latency_at_limit(cfqd, cfqq->cfqg) &&
+	    cfqd->grp_service_tree.count > 1)
+		goto expire;
+
 	/*
 	 * We were waiting for group to get backlogged. Expire the queue
 	 */
@@ -2381,7 +2546,8 @@ static struct cfq_queue *cfq_select_queue(struct cfq_data *cfqd)
 	 * this group, wait for requests to complete.
 	 */
 check_group_idle:
-	if (cfqd->cfq_group_idle && cfqq->cfqg->nr_cfqq == 1
+	if (cfqd->cfq_group_idle && !cfqd->cfq_group_latency &&
+	    cfqq->cfqg->nr_cfqq == 1
 	    && cfqq->cfqg->dispatched) {
 		cfqq = NULL;
 		goto keep_queue;
@@ -2469,6 +2635,12 @@ static bool cfq_may_dispatch(struct cfq_data *cfqd, struct cfq_queue *cfqq)
 	if (cfqd->rq_in_flight[BLK_RW_SYNC] && !cfq_cfqq_sync(cfqq))
 		return false;
 
+	/*
+	 * The group is holding back another group's latency target
+	 */
+	if (cfq_latency_at_limit(cfqd, cfqq->cfqg))
+		return false;
+
 	max_dispatch = max_t(unsigned int, cfqd->cfq_quantum / 2, 1);
 	if (cfq_class_idle(cfqq))
 		max_dispatch = 1;
@@ -3519,6 +3691,9 @@ static bool cfq_should_wait_busy(struct cfq_data *cfqd, struct cfq_queue *cfqq)
 {
 	struct cfq_io_context *cic = cfqd->active_cic;
 
+	if (cfqd->cfq_group_latency)
+		return false;
+
 	/* If the queue already has requests, don't wait */
 	if (!RB_EMPTY_ROOT(&cfqq->sort_list))
 		return false;
@@ -3569,6 +3744,7 @@ static void cfq_completed_request(struct request_queue *q, struct request *rq)
 	cfq_blkiocg_update_completion_stats(&cfqq->cfqg->blkg,
 			rq_start_time_ns(rq), rq_io_start_time_ns(rq),
 			rq_data_dir(rq), rq_is_sync(rq));
+	cfq_update_group_latency(cfqd, RQ_CFQG(rq), rq);
 
 	cfqd->rq_in_flight[cfq_cfqq_sync(cfqq)]--;
 
@@ -3619,7 +3795,7 @@ static void cfq_completed_request(struct request_queue *q, struct request *rq)
 		}
 	}
 
-	if (!cfqd->rq_in_driver)
+	if (!cfqd->rq_in_driver || cfqd->latency_missed)
 		cfq_schedule_dispatch(cfqd);
 }
 
@@ -4035,6 +4211,7 @@ static void *cfq_init_queue(struct request_queue *q)
 
 	cfq_blkiocg_add_blkio_group(&blkio_root_cgroup, &cfqg->blkg,
 					(void *)cfqd, 0);
+	cfqg->latency_target = blkcg_get_latency_target(&blkio_root_cgroup);
 	rcu_read_unlock();
 	cfqd->nr_blkcg_linked_grps++;
 
@@ -4079,6 +4256,7 @@ static void *cfq_init_queue(struct request_queue *q)
 	cfqd->cfq_slice_idle = cfq_slice_idle;
 	cfqd->cfq_group_idle = cfq_group_idle;
 	cfqd->cfq_latency = 1;
+	cfqd->latency_depth = CFQ_LATENCY_DEPTH_MAX;
 	cfqd->hw_tag = -1;
 	/*
 	 * we optimistically start assuming sync ops weren't delayed in last
@@ -4154,6 +4332,9 @@ SHOW_FUNCTION(cfq_slice_sync_show, cfqd->cfq_slice[1], 1);
 SHOW_FUNCTION(cfq_slice_async_show, cfqd->cfq_slice[0], 1);
 SHOW_FUNCTION(cfq_slice_async_rq_show, cfqd->cfq_slice_async_rq, 0);
 SHOW_FUNCTION(cfq_low_latency_show, cfqd->cfq_latency, 0);
+#ifdef CONFIG_CFQ_GROUP_IOSCHED
+SHOW_FUNCTION(cfq_group_latency_show, cfqd->cfq_group_latency, 0);
+#endif
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -4187,6 +4368,9 @@ STORE_FUNCTION(cfq_slice_async_store, &cfqd->cfq_slice[0], 1, UINT_MAX, 1);
 STORE_FUNCTION(cfq_slice_async_rq_store, &cfqd->cfq_slice_async_rq, 1,
 		UINT_MAX, 0);
 STORE_FUNCTION(cfq_low_latency_store, &cfqd->cfq_latency, 0, 1, 0);
+#ifdef CONFIG_CFQ_GROUP_IOSCHED
+STORE_FUNCTION(cfq_group_latency_store, &cfqd->cfq_group_latency, 0, 1, 0);
+#endif
 #undef STORE_FUNCTION
 
 #define CFQ_ATTR(name) \
@@ -4204,6 +4388,10 @@ static struct elv_fs_entry cfq_attrs[] = {
 	CFQ_ATTR(slice_idle),
 	CFQ_ATTR(group_idle),
 	CFQ_ATTR(low_latency),
+#ifdef CONFIG_CFQ_GROUP_IOSCHED
+	/* latency targets are per group */
+	CFQ_ATTR(group_latency),
+#endif
 	__ATTR_NULL
 };
 
@@ -4238,6 +4426,8 @@ static struct blkio_policy_type blkio_policy_cfq = {
 	.ops = {
 		.blkio_unlink_group_fn =	cfq_unlink_blkio_group,
 		.blkio_update_group_weight_fn =	cfq_update_blkio_group_weight,
+		.blkio_update_group_latency_target_fn =
+					cfq_update_blkio_group_latency_target,
 	},
 	.plid = BLKIO_POLICY_PROP,
 };
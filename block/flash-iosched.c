@@ -0,0 +1,606 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  A deadline derivative for solid state storage such as eMMC and SD
+ *  cards.  There is no head position to optimise for, so requests are
+ *  not sorted for dispatch; what matters is which requests wait.
+ *
+ *  Requests are kept in three fifos: synchronous reads, synchronous
+ *  writes and asynchronous (writeback) requests, served in that order of
+ *  preference.  Starvation of the lower classes is bounded by a count of
+ *  batches they may be passed over for, and by per class expiry times.
+ *  There is no idling.
+ *
+ *  Bulk writeback is additionally held back while reads are in flight
+ *  at the device, since a flash device that is busy programming pages
+ *  can keep a read waiting far longer than the read itself takes.  It
+ *  is released when the reads drain or the oldest async request expires.
+ *
+ *  See Documentation/block/flash-iosched.txt
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/ktime.h>
+
+static const int read_expire = HZ / 4;		/* max time before a read is submitted */
+static const int sync_write_expire = HZ;	/* ditto for sync writes */
+static const int async_expire = 5 * HZ;		/* and for writeback, these are SOFT! */
+static const int writes_starved = 4;		/* max read batches sync writes wait for */
+static const int async_starved = 8;		/* max sync batches async requests wait for */
+static const int fifo_batch = 16;		/* # of requests dispatched as one batch */
+
+enum {
+	FLASH_SYNC_READ,
+	FLASH_SYNC_WRITE,
+	FLASH_ASYNC,
+	FLASH_NR_QUEUES,
+};
+
+static const char * const flash_queue_names[FLASH_NR_QUEUES] = {
+	"sync_read", "sync_write", "async",
+};
+
+/*
+ * Latency of completed requests, in microseconds: from insertion to
+ * dispatch, and from insertion to completion.
+ */
+struct flash_lat_stats {
+	unsigned long nr;
+	u64 wait_total;
+	u64 total;
+	unsigned long wait_max;
+	unsigned long max;
+};
+
+struct flash_data {
+	/*
+	 * run time data
+	 */
+
+	/*
+	 * requests are on a fifo by class and, for front merging, on a
+	 * sector sorted tree by data direction
+	 */
+	struct list_head fifo_list[FLASH_NR_QUEUES];
+	struct rb_root sort_list[2];
+
+	int batch_queue;		/* class of the current batch */
+	unsigned int batching;		/* number of requests in this batch */
+	int batch_starved;		/* the batch is owed to starvation */
+	unsigned int starved[FLASH_NR_QUEUES];	/* batches a class waited */
+	unsigned int reads_in_flight;	/* dispatched, not yet completed */
+	int async_held;			/* async work held back for reads */
+
+	struct flash_lat_stats stats[FLASH_NR_QUEUES];
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[FLASH_NR_QUEUES];
+	int fifo_batch;
+	int writes_starved;
+	int async_starved;
+	int hold_async;
+	int front_merges;
+};
+
+/*
+ * elevator_private[] slots: the class of the request, and timestamps of
+ * insertion and dispatch in microseconds.  The timestamps are truncated
+ * to unsigned long; only differences are used.
+ */
+#define RQ_CLASS(rq)		((long) (rq)->elevator_private[0])
+#define RQ_SET_CLASS(rq, c)	((rq)->elevator_private[0] = (void *) (long) (c))
+#define RQ_ADD_TIME(rq)		((unsigned long) (rq)->elevator_private[1])
+#define RQ_DISPATCH_TIME(rq)	((unsigned long) (rq)->elevator_private[2])
+
+static inline unsigned long flash_now_us(void)
+{
+	return (unsigned long) ktime_to_us(ktime_get());
+}
+
+static inline int flash_rq_class(struct request *rq)
+{
+	if (!rq_is_sync(rq))
+		return FLASH_ASYNC;
+	return rq_data_dir(rq) == READ ? FLASH_SYNC_READ : FLASH_SYNC_WRITE;
+}
+
+static inline struct rb_root *
+flash_rb_root(struct flash_data *fd, struct request *rq)
+{
+	return &fd->sort_list[rq_data_dir(rq)];
+}
+
+static void flash_move_to_dispatch(struct flash_data *, struct request *);
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = flash_rb_root(fd, rq);
+	struct request *__alias;
+
+	while (unlikely(__alias = elv_rb_add(root, rq)))
+		flash_move_to_dispatch(fd, __alias);
+}
+
+/*
+ * add rq to rbtree and the fifo of its class
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int class = flash_rq_class(rq);
+
+	RQ_SET_CLASS(rq, class);
+	rq->elevator_private[1] = (void *) flash_now_us();
+
+	flash_add_rq_rb(fd, rq);
+
+	rq_set_fifo_time(rq, jiffies + fd->fifo_expire[class]);
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	elv_rb_del(flash_rb_root(fd, rq), rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[bio_data_dir(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != blk_rq_pos(__rq));
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+/*
+ * Don't let a synchronous bio hide in an async request, or the other
+ * way around: the request would be served in the wrong class.
+ */
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	return !rq_is_sync(rq) == !rw_is_sync(bio->bi_rw);
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(flash_rb_root(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+/*
+ * Put rq on the fifo of its class, behind the requests that do not
+ * expire later than it does.  Usually that is the tail.
+ */
+static void flash_fifo_insert(struct flash_data *fd, struct request *rq)
+{
+	struct list_head *head = &fd->fifo_list[RQ_CLASS(rq)];
+	struct list_head *pos;
+
+	list_for_each_prev(pos, head)
+		if (!time_after(rq_fifo_time(rq_entry_fifo(pos)),
+				rq_fifo_time(rq)))
+			break;
+	list_add(&rq->queuelist, pos);
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * req takes over the earlier expiry time and the more urgent
+	 * class of the two, and is moved to the fifo of that class.
+	 * next will be deleted.
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		int moved = 0;
+
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			rq_set_fifo_time(req, rq_fifo_time(next));
+			moved = 1;
+		}
+		if (RQ_CLASS(next) < RQ_CLASS(req)) {
+			RQ_SET_CLASS(req, RQ_CLASS(next));
+			moved = 1;
+		}
+		if (moved) {
+			list_del_init(&req->queuelist);
+			flash_fifo_insert(fd, req);
+		}
+		if ((long) (RQ_ADD_TIME(next) - RQ_ADD_TIME(req)) < 0)
+			req->elevator_private[1] = next->elevator_private[1];
+	}
+
+	flash_remove_request(q, next);
+}
+
+/*
+ * move request from the scheduler to the dispatch queue.
+ */
+static void
+flash_move_to_dispatch(struct flash_data *fd, struct request *rq)
+{
+	struct request_queue *q = rq->q;
+
+	rq->elevator_private[2] = (void *) flash_now_us();
+	if (RQ_CLASS(rq) == FLASH_SYNC_READ && blk_account_rq(rq))
+		fd->reads_in_flight++;
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+}
+
+/*
+ * returns 1 if the oldest request of a class has expired.
+ * Requires !list_empty(&fd->fifo_list[class])
+ */
+static inline int flash_check_fifo(struct flash_data *fd, int class)
+{
+	struct request *rq = rq_entry_fifo(fd->fifo_list[class].next);
+
+	return time_after(jiffies, rq_fifo_time(rq));
+}
+
+/*
+ * Should a class that is waiting be served before the more urgent ones?
+ * Either its oldest request expired, or it was passed over too often.
+ */
+static int flash_starved(struct flash_data *fd, int class, int limit)
+{
+	if (list_empty(&fd->fifo_list[class]))
+		return 0;
+	return flash_check_fifo(fd, class) || fd->starved[class] >= limit;
+}
+
+/*
+ * flash_dispatch_requests selects the next class to serve, and moves the
+ * oldest request of that class to the dispatch queue
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	int class, starved;
+
+	/*
+	 * continue the current batch while it lasts and no other class
+	 * has requests that expired.  A batch of writes yields to reads
+	 * as soon as one is queued, unless the writes had starved.
+	 */
+	class = fd->batch_queue;
+	if (fd->batching < fd->fifo_batch &&
+	    !list_empty(&fd->fifo_list[class]) &&
+	    (class == FLASH_SYNC_READ || fd->batch_starved ||
+	     list_empty(&fd->fifo_list[FLASH_SYNC_READ]))) {
+		int i;
+
+		for (i = 0; i < FLASH_NR_QUEUES; i++)
+			if (i != class && !list_empty(&fd->fifo_list[i]) &&
+			    flash_check_fifo(fd, i))
+				break;
+		if (i == FLASH_NR_QUEUES)
+			goto dispatch_request;
+	}
+
+	/*
+	 * select a new class: async requests and sync writes that have
+	 * waited long enough go first, then reads, sync writes and async
+	 * requests in that order
+	 */
+	starved = 1;
+	if (flash_starved(fd, FLASH_ASYNC, fd->async_starved))
+		class = FLASH_ASYNC;
+	else if (flash_starved(fd, FLASH_SYNC_WRITE, fd->writes_starved))
+		class = FLASH_SYNC_WRITE;
+	else
+		starved = 0;
+
+	if (starved)
+		goto new_batch;
+
+	if (!list_empty(&fd->fifo_list[FLASH_SYNC_READ]))
+		class = FLASH_SYNC_READ;
+	else if (!list_empty(&fd->fifo_list[FLASH_SYNC_WRITE]))
+		class = FLASH_SYNC_WRITE;
+	else if (!list_empty(&fd->fifo_list[FLASH_ASYNC])) {
+		/*
+		 * Only writeback is left.  Keep it off the device while
+		 * reads are still being served, unless we are draining.
+		 * The completion of the last read kicks the queue.
+		 */
+		if (!force && fd->hold_async && fd->reads_in_flight) {
+			fd->async_held = 1;
+			return 0;
+		}
+		class = FLASH_ASYNC;
+	} else
+		return 0;
+
+new_batch:
+	/*
+	 * account a missed batch to every other class that is waiting
+	 */
+	if (!list_empty(&fd->fifo_list[FLASH_SYNC_WRITE]) &&
+	    class == FLASH_SYNC_READ)
+		fd->starved[FLASH_SYNC_WRITE]++;
+	if (!list_empty(&fd->fifo_list[FLASH_ASYNC]) && class != FLASH_ASYNC)
+		fd->starved[FLASH_ASYNC]++;
+	fd->starved[class] = 0;
+
+	fd->batch_queue = class;
+	fd->batch_starved = starved;
+	fd->batching = 0;
+
+dispatch_request:
+	fd->batching++;
+	flash_move_to_dispatch(fd, rq_entry_fifo(fd->fifo_list[class].next));
+
+	return 1;
+}
+
+static void flash_completed_request(struct request_queue *q,
+				    struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct flash_lat_stats *st = &fd->stats[RQ_CLASS(rq)];
+	unsigned long now = flash_now_us();
+	unsigned long wait = RQ_DISPATCH_TIME(rq) - RQ_ADD_TIME(rq);
+	unsigned long total = now - RQ_ADD_TIME(rq);
+
+	st->nr++;
+	st->wait_total += wait;
+	st->total += total;
+	if (wait > st->wait_max)
+		st->wait_max = wait;
+	if (total > st->max)
+		st->max = total;
+
+	if (RQ_CLASS(rq) != FLASH_SYNC_READ)
+		return;
+
+	WARN_ON(!fd->reads_in_flight);
+	if (fd->reads_in_flight && !--fd->reads_in_flight && fd->async_held) {
+		fd->async_held = 0;
+		blk_run_queue_async(q);
+	}
+}
+
+static void flash_exit_queue(struct elevator_queue *e)
+{
+	struct flash_data *fd = e->elevator_data;
+	int i;
+
+	for (i = 0; i < FLASH_NR_QUEUES; i++)
+		BUG_ON(!list_empty(&fd->fifo_list[i]));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int i;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	for (i = 0; i < FLASH_NR_QUEUES; i++)
+		INIT_LIST_HEAD(&fd->fifo_list[i]);
+	fd->sort_list[READ] = RB_ROOT;
+	fd->sort_list[WRITE] = RB_ROOT;
+	fd->fifo_expire[FLASH_SYNC_READ] = read_expire;
+	fd->fifo_expire[FLASH_SYNC_WRITE] = sync_write_expire;
+	fd->fifo_expire[FLASH_ASYNC] = async_expire;
+	fd->writes_starved = writes_starved;
+	fd->async_starved = async_starved;
+	fd->hold_async = 1;
+	fd->front_merges = 1;
+	fd->fifo_batch = fifo_batch;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(struct elevator_queue *e, char *page)		\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_read_expire_show, fd->fifo_expire[FLASH_SYNC_READ], 1);
+SHOW_FUNCTION(flash_sync_write_expire_show, fd->fifo_expire[FLASH_SYNC_WRITE], 1);
+SHOW_FUNCTION(flash_async_expire_show, fd->fifo_expire[FLASH_ASYNC], 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_async_starved_show, fd->async_starved, 0);
+SHOW_FUNCTION(flash_hold_async_show, fd->hold_async, 0);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+SHOW_FUNCTION(flash_fifo_batch_show, fd->fifo_batch, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(struct elevator_queue *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_read_expire_store, &fd->fifo_expire[FLASH_SYNC_READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_sync_write_expire_store, &fd->fifo_expire[FLASH_SYNC_WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_async_expire_store, &fd->fifo_expire[FLASH_ASYNC], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_async_starved_store, &fd->async_starved, 0, INT_MAX, 0);
+STORE_FUNCTION(flash_hold_async_store, &fd->hold_async, 0, 1, 0);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+STORE_FUNCTION(flash_fifo_batch_store, &fd->fifo_batch, 1, INT_MAX, 0);
+#undef STORE_FUNCTION
+
+/*
+ * One line per class: completed requests, then average and maximum
+ * dispatch wait and completion latency, in microseconds.
+ */
+static ssize_t flash_latency_stats_show(struct elevator_queue *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+	struct flash_lat_stats st[FLASH_NR_QUEUES];
+	ssize_t len = 0;
+	int i;
+
+	memcpy(st, fd->stats, sizeof(st));
+
+	for (i = 0; i < FLASH_NR_QUEUES; i++) {
+		u64 wait_avg = st[i].wait_total, avg = st[i].total;
+
+		if (st[i].nr) {
+			do_div(wait_avg, st[i].nr);
+			do_div(avg, st[i].nr);
+		}
+		len += sprintf(page + len, "%-10s %lu %llu %lu %llu %lu\n",
+			       flash_queue_names[i], st[i].nr,
+			       (unsigned long long) wait_avg, st[i].wait_max,
+			       (unsigned long long) avg, st[i].max);
+	}
+	return len;
+}
+
+/* writing anything resets the statistics */
+static ssize_t flash_latency_stats_store(struct elevator_queue *e,
+					 const char *page, size_t count)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	memset(fd->stats, 0, sizeof(fd->stats));
+	return count;
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(read_expire),
+	FD_ATTR(sync_write_expire),
+	FD_ATTR(async_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(async_starved),
+	FD_ATTR(hold_async),
+	FD_ATTR(front_merges),
+	FD_ATTR(fifo_batch),
+	FD_ATTR(latency_stats),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Flash IO scheduler");
@@ -0,0 +1,473 @@
+/*
+ * ChaCha20-Poly1305 AEAD, RFC7539
+ *
+ * Copyright (C) 2015 Martin Willi
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The construction runs synchronously: the ChaCha20 instance must not be
+ * asynchronous, and Poly1305 is an shash fed straight from the mapped
+ * scatterlists.  Both have SIMD implementations that fall back to scalar
+ * code where the vector unit may not be used, so no cryptd is needed.
+ */
+
+#include <crypto/internal/aead.h>
+#include <crypto/internal/hash.h>
+#include <crypto/internal/skcipher.h>
+#include <crypto/scatterwalk.h>
+#include <crypto/chacha20.h>
+#include <crypto/poly1305.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include "internal.h"
+
+#define CHACHAPOLY_IV_SIZE	12
+
+struct chachapoly_instance_ctx {
+	struct crypto_skcipher_spawn chacha;
+	struct crypto_shash_spawn poly;
+	unsigned int saltlen;
+};
+
+struct chachapoly_ctx {
+	struct crypto_ablkcipher *chacha;
+	struct crypto_shash *poly;
+	/* key bytes we use for the ChaCha20 IV */
+	unsigned int saltlen;
+	u8 salt[];
+};
+
+struct chachapoly_req_ctx {
+	/* the key we generate for Poly1305 using Chacha20 */
+	u8 key[POLY1305_KEY_SIZE];
+	/* calculated Poly1305 tag */
+	u8 tag[POLY1305_DIGEST_SIZE];
+	/* tag carried in the message on decryption */
+	u8 msgtag[POLY1305_DIGEST_SIZE];
+	/* length block closing the Poly1305 input */
+	struct {
+		__le64 assoclen;
+		__le64 cryptlen;
+	} tail;
+	u8 iv[CHACHA20_IV_SIZE];
+	struct scatterlist sg[1];
+	/* must be last, the child request contexts follow */
+	union {
+		struct shash_desc desc;
+		struct ablkcipher_request req;
+	} u;
+};
+
+static void chacha_iv(u8 *iv, struct aead_request *req, u32 icb)
+{
+	struct chachapoly_ctx *ctx = crypto_aead_ctx(crypto_aead_reqtfm(req));
+	__le32 leicb = cpu_to_le32(icb);
+
+	memcpy(iv, &leicb, sizeof(leicb));
+	memcpy(iv + sizeof(leicb), ctx->salt, ctx->saltlen);
+	memcpy(iv + sizeof(leicb) + ctx->saltlen, req->iv,
+	       CHACHA20_IV_SIZE - sizeof(leicb) - ctx->saltlen);
+}
+
+static int chacha_crypt(struct aead_request *req, struct scatterlist *dst,
+			struct scatterlist *src, unsigned int len, u32 icb)
+{
+	struct chachapoly_ctx *ctx = crypto_aead_ctx(crypto_aead_reqtfm(req));
+	struct chachapoly_req_ctx *rctx = aead_request_ctx(req);
+	struct ablkcipher_request *creq = &rctx->u.req;
+
+	chacha_iv(rctx->iv, req, icb);
+
+	ablkcipher_request_set_tfm(creq, ctx->chacha);
+	ablkcipher_request_set_callback(creq, 0, NULL, NULL);
+	ablkcipher_request_set_crypt(creq, src, dst, len, rctx->iv);
+
+	return crypto_ablkcipher_encrypt(creq);
+}
+
+/* The one-time Poly1305 key is the first half of ChaCha20 block 0 */
+static int poly_genkey(struct aead_request *req)
+{
+	struct chachapoly_req_ctx *rctx = aead_request_ctx(req);
+
+	memset(rctx->key, 0, sizeof(rctx->key));
+	sg_init_one(rctx->sg, rctx->key, sizeof(rctx->key));
+
+	return chacha_crypt(req, rctx->sg, rctx->sg, sizeof(rctx->key), 0);
+}
+
+static int poly_update_sg(struct shash_desc *desc, struct scatterlist *sg,
+			  unsigned int nbytes)
+{
+	struct scatter_walk walk;
+	int err = 0;
+
+	if (!nbytes)
+		return 0;
+
+	scatterwalk_start(&walk, sg);
+	while (nbytes && !err) {
+		unsigned int n = scatterwalk_clamp(&walk, nbytes);
+		u8 *vaddr = scatterwalk_map(&walk, 0);
+
+		err = crypto_shash_update(desc, vaddr, n);
+		scatterwalk_unmap(vaddr, 0);
+		scatterwalk_advance(&walk, n);
+		nbytes -= n;
+		scatterwalk_done(&walk, 0, nbytes);
+	}
+
+	return err;
+}
+
+static int poly_pad(struct shash_desc *desc, unsigned int len)
+{
+	static const u8 zero[POLY1305_BLOCK_SIZE];
+	unsigned int padlen = -len % POLY1305_BLOCK_SIZE;
+
+	return padlen ? crypto_shash_update(desc, zero, padlen) : 0;
+}
+
+/*
+ * Poly1305 over the one-time key, the padded associated data, the padded
+ * ciphertext and the lengths of both, into rctx->tag.
+ */
+static int poly_tag(struct aead_request *req, struct scatterlist *crypt,
+		    unsigned int cryptlen)
+{
+	struct chachapoly_ctx *ctx = crypto_aead_ctx(crypto_aead_reqtfm(req));
+	struct chachapoly_req_ctx *rctx = aead_request_ctx(req);
+	struct shash_desc *desc = &rctx->u.desc;
+	int err;
+
+	desc->tfm = ctx->poly;
+	desc->flags = 0;
+
+	rctx->tail.assoclen = cpu_to_le64(req->assoclen);
+	rctx->tail.cryptlen = cpu_to_le64(cryptlen);
+
+	err = crypto_shash_init(desc);
+	if (!err)
+		err = crypto_shash_update(desc, rctx->key, sizeof(rctx->key));
+	if (!err)
+		err = poly_update_sg(desc, req->assoc, req->assoclen);
+	if (!err)
+		err = poly_pad(desc, req->assoclen);
+	if (!err)
+		err = poly_update_sg(desc, crypt, cryptlen);
+	if (!err)
+		err = poly_pad(desc, cryptlen);
+	if (!err)
+		err = crypto_shash_update(desc, (u8 *)&rctx->tail,
+					  sizeof(rctx->tail));
+	if (!err)
+		err = crypto_shash_final(desc, rctx->tag);
+
+	return err;
+}
+
+static int chachapoly_encrypt(struct aead_request *req)
+{
+	struct chachapoly_req_ctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	int err;
+
+	err = poly_genkey(req);
+	if (err)
+		return err;
+
+	if (req->cryptlen) {
+		err = chacha_crypt(req, req->dst, req->src, req->cryptlen, 1);
+		if (err)
+			return err;
+	}
+
+	err = poly_tag(req, req->dst, req->cryptlen);
+	if (err)
+		return err;
+
+	scatterwalk_map_and_copy(rctx->tag, req->dst, req->cryptlen,
+				 crypto_aead_authsize(tfm), 1);
+
+	return 0;
+}
+
+static int chachapoly_decrypt(struct aead_request *req)
+{
+	struct chachapoly_req_ctx *rctx = aead_request_ctx(req);
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	unsigned int authsize = crypto_aead_authsize(tfm);
+	unsigned int cryptlen;
+	u8 diff = 0;
+	int err, i;
+
+	if (req->cryptlen < authsize)
+		return -EINVAL;
+	cryptlen = req->cryptlen - authsize;
+
+	err = poly_genkey(req);
+	if (err)
+		return err;
+
+	/* authenticate the ciphertext before decrypting it, maybe in place */
+	err = poly_tag(req, req->src, cryptlen);
+	if (err)
+		return err;
+
+	scatterwalk_map_and_copy(rctx->msgtag, req->src, cryptlen, authsize, 0);
+	for (i = 0; i < authsize; i++)
+		diff |= rctx->tag[i] ^ rctx->msgtag[i];
+	if (diff)
+		return -EBADMSG;
+
+	if (!cryptlen)
+		return 0;
+
+	return chacha_crypt(req, req->dst, req->src, cryptlen, 1);
+}
+
+static int chachapoly_setkey(struct crypto_aead *aead, const u8 *key,
+			     unsigned int keylen)
+{
+	struct chachapoly_ctx *ctx = crypto_aead_ctx(aead);
+	int err;
+
+	if (keylen != ctx->saltlen + CHACHA20_KEY_SIZE)
+		return -EINVAL;
+
+	keylen -= ctx->saltlen;
+	memcpy(ctx->salt, key + keylen, ctx->saltlen);
+
+	crypto_ablkcipher_clear_flags(ctx->chacha, CRYPTO_TFM_REQ_MASK);
+	crypto_ablkcipher_set_flags(ctx->chacha, crypto_aead_get_flags(aead) &
+						 CRYPTO_TFM_REQ_MASK);
+
+	err = crypto_ablkcipher_setkey(ctx->chacha, key, keylen);
+	crypto_aead_set_flags(aead, crypto_ablkcipher_get_flags(ctx->chacha) &
+				    CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static int chachapoly_setauthsize(struct crypto_aead *tfm,
+				  unsigned int authsize)
+{
+	if (authsize != POLY1305_DIGEST_SIZE)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int chachapoly_init(struct crypto_tfm *tfm)
+{
+	struct crypto_instance *inst = (void *)tfm->__crt_alg;
+	struct chachapoly_instance_ctx *ictx = crypto_instance_ctx(inst);
+	struct chachapoly_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct crypto_ablkcipher *chacha;
+	struct crypto_shash *poly;
+
+	poly = crypto_spawn_shash(&ictx->poly);
+	if (IS_ERR(poly))
+		return PTR_ERR(poly);
+
+	chacha = crypto_spawn_skcipher(&ictx->chacha);
+	if (IS_ERR(chacha)) {
+		crypto_free_shash(poly);
+		return PTR_ERR(chacha);
+	}
+
+	ctx->chacha = chacha;
+	ctx->poly = poly;
+	ctx->saltlen = ictx->saltlen;
+
+	tfm->crt_aead.reqsize = offsetof(struct chachapoly_req_ctx, u) +
+				max(sizeof(struct shash_desc) +
+				    crypto_shash_descsize(poly),
+				    sizeof(struct ablkcipher_request) +
+				    crypto_ablkcipher_reqsize(chacha));
+
+	return 0;
+}
+
+static void chachapoly_exit(struct crypto_tfm *tfm)
+{
+	struct chachapoly_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_shash(ctx->poly);
+	crypto_free_ablkcipher(ctx->chacha);
+}
+
+static struct crypto_instance *chachapoly_alloc(struct rtattr **tb,
+						const char *name,
+						unsigned int ivsize)
+{
+	struct crypto_attr_type *algt;
+	struct crypto_instance *inst;
+	struct crypto_alg *chacha;
+	struct shash_alg *poly;
+	struct chachapoly_instance_ctx *ctx;
+	const char *chacha_name;
+	int err;
+
+	if (ivsize > CHACHAPOLY_IV_SIZE)
+		return ERR_PTR(-EINVAL);
+
+	algt = crypto_get_attr_type(tb);
+	if (IS_ERR(algt))
+		return ERR_CAST(algt);
+
+	if ((algt->type ^ CRYPTO_ALG_TYPE_AEAD) & algt->mask)
+		return ERR_PTR(-EINVAL);
+
+	chacha_name = crypto_attr_alg_name(tb[1]);
+	if (IS_ERR(chacha_name))
+		return ERR_CAST(chacha_name);
+
+	poly = shash_attr_alg(tb[2], 0, 0);
+	if (IS_ERR(poly))
+		return ERR_CAST(poly);
+
+	err = -EINVAL;
+	if (poly->digestsize != POLY1305_DIGEST_SIZE)
+		goto out_put_poly;
+
+	err = -ENOMEM;
+	inst = kzalloc(sizeof(*inst) + sizeof(*ctx), GFP_KERNEL);
+	if (!inst)
+		goto out_put_poly;
+
+	ctx = crypto_instance_ctx(inst);
+	ctx->saltlen = CHACHAPOLY_IV_SIZE - ivsize;
+	err = crypto_init_shash_spawn(&ctx->poly, poly, inst);
+	if (err)
+		goto err_free_inst;
+
+	/* The AEAD runs synchronously, so must its cipher */
+	crypto_set_skcipher_spawn(&ctx->chacha, inst);
+	err = crypto_grab_skcipher(&ctx->chacha, chacha_name, 0,
+				   CRYPTO_ALG_ASYNC);
+	if (err)
+		goto err_drop_poly;
+
+	chacha = crypto_skcipher_spawn_alg(&ctx->chacha);
+
+	err = -EINVAL;
+	/* Need 16-byte IV size, including Initial Block Counter value */
+	if (chacha->cra_ablkcipher.ivsize != CHACHA20_IV_SIZE)
+		goto out_drop_chacha;
+	/* Not a stream cipher? */
+	if (chacha->cra_blocksize != 1)
+		goto out_drop_chacha;
+
+	err = -ENAMETOOLONG;
+	if (snprintf(inst->alg.cra_name, CRYPTO_MAX_ALG_NAME,
+		     "%s(%s,%s)", name, chacha->cra_name,
+		     poly->base.cra_name) >= CRYPTO_MAX_ALG_NAME)
+		goto out_drop_chacha;
+	if (snprintf(inst->alg.cra_driver_name, CRYPTO_MAX_ALG_NAME,
+		     "%s(%s,%s)", name, chacha->cra_driver_name,
+		     poly->base.cra_driver_name) >= CRYPTO_MAX_ALG_NAME)
+		goto out_drop_chacha;
+
+	inst->alg.cra_flags = CRYPTO_ALG_TYPE_AEAD;
+	inst->alg.cra_priority = (chacha->cra_priority +
+				  poly->base.cra_priority) / 2;
+	inst->alg.cra_blocksize = 1;
+	inst->alg.cra_alignmask = chacha->cra_alignmask |
+				  poly->base.cra_alignmask;
+	inst->alg.cra_type = ivsize == CHACHAPOLY_IV_SIZE ?
+			     &crypto_aead_type : &crypto_nivaead_type;
+	inst->alg.cra_aead.ivsize = ivsize;
+	inst->alg.cra_aead.maxauthsize = POLY1305_DIGEST_SIZE;
+	if (ivsize != CHACHAPOLY_IV_SIZE)
+		inst->alg.cra_aead.geniv = "seqiv";
+	inst->alg.cra_ctxsize = sizeof(struct chachapoly_ctx) + ctx->saltlen;
+	inst->alg.cra_init = chachapoly_init;
+	inst->alg.cra_exit = chachapoly_exit;
+	inst->alg.cra_aead.setkey = chachapoly_setkey;
+	inst->alg.cra_aead.setauthsize = chachapoly_setauthsize;
+	inst->alg.cra_aead.encrypt = chachapoly_encrypt;
+	inst->alg.cra_aead.decrypt = chachapoly_decrypt;
+
+out:
+	crypto_mod_put(&poly->base);
+	return inst;
+
+out_drop_chacha:
+	crypto_drop_skcipher(&ctx->chacha);
+err_drop_poly:
+	crypto_drop_shash(&ctx->poly);
+err_free_inst:
+	kfree(inst);
+out_put_poly:
+	inst = ERR_PTR(err);
+	goto out;
+}
+
+static struct crypto_instance *rfc7539_alloc(struct rtattr **tb)
+{
+	return chachapoly_alloc(tb, "rfc7539", 12);
+}
+
+static struct crypto_instance *rfc7539esp_alloc(struct rtattr **tb)
+{
+	return chachapoly_alloc(tb, "rfc7539esp", 8);
+}
+
+static void chachapoly_free(struct crypto_instance *inst)
+{
+	struct chachapoly_instance_ctx *ctx = crypto_instance_ctx(inst);
+
+	crypto_drop_skcipher(&ctx->chacha);
+	crypto_drop_shash(&ctx->poly);
+	kfree(inst);
+}
+
+static struct crypto_template rfc7539_tmpl = {
+	.name = "rfc7539",
+	.alloc = rfc7539_alloc,
+	.free = chachapoly_free,
+	.module = THIS_MODULE,
+};
+
+static struct crypto_template rfc7539esp_tmpl = {
+	.name = "rfc7539esp",
+	.alloc = rfc7539esp_alloc,
+	.free = chachapoly_free,
+	.module = THIS_MODULE,
+};
+
+static int __init chacha20poly1305_module_init(void)
+{
+	int err;
+
+	err = crypto_register_template(&rfc7539_tmpl);
+	if (err)
+		return err;
+
+	err = crypto_register_template(&rfc7539esp_tmpl);
+	if (err)
+		crypto_unregister_template(&rfc7539_tmpl);
+
+	return err;
+}
+
+static void __exit chacha20poly1305_module_exit(void)
+{
+	crypto_unregister_template(&rfc7539esp_tmpl);
+	crypto_unregister_template(&rfc7539_tmpl);
+}
+
+module_init(chacha20poly1305_module_init);
+module_exit(chacha20poly1305_module_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("ChaCha20-Poly1305 AEAD");
+MODULE_ALIAS("rfc7539");
+MODULE_ALIAS("rfc7539esp");
@@ -44,14 +44,16 @@ static void lzo_exit(struct crypto_tfm *tfm)
 	vfree(ctx->lzo_comp_mem);
 }
 
-static int lzo_compress(struct crypto_tfm *tfm, const u8 *src,
-			    unsigned int slen, u8 *dst, unsigned int *dlen)
+static int __lzo_compress(struct crypto_tfm *tfm, const u8 *src,
+			  unsigned int slen, u8 *dst, unsigned int *dlen,
+			  int (*compress)(const unsigned char *, size_t,
+					  unsigned char *, size_t *, void *))
 {
 	struct lzo_ctx *ctx = crypto_tfm_ctx(tfm);
 	size_t tmp_len = *dlen; /* size_t(ulong) <-> uint on 64 bit */
 	int err;
 
-	err = lzo1x_1_compress(src, slen, dst, &tmp_len, ctx->lzo_comp_mem);
+	err = compress(src, slen, dst, &tmp_len, ctx->lzo_comp_mem);
 
 	if (err != LZO_E_OK)
 		return -EINVAL;
@@ -60,6 +62,18 @@ static int lzo_compress(struct crypto_tfm *tfm, const u8 *src,
 	return 0;
 }
 
+static int lzo_compress(struct crypto_tfm *tfm, const u8 *src,
+			    unsigned int slen, u8 *dst, unsigned int *dlen)
+{
+	return __lzo_compress(tfm, src, slen, dst, dlen, lzo1x_1_compress);
+}
+
+static int lzorle_compress(struct crypto_tfm *tfm, const u8 *src,
+			    unsigned int slen, u8 *dst, unsigned int *dlen)
+{
+	return __lzo_compress(tfm, src, slen, dst, dlen, lzorle1x_1_compress);
+}
+
 static int lzo_decompress(struct crypto_tfm *tfm, const u8 *src,
 			      unsigned int slen, u8 *dst, unsigned int *dlen)
 {
@@ -76,27 +90,37 @@ static int lzo_decompress(struct crypto_tfm *tfm, const u8 *src,
 
 }
 
-static struct crypto_alg alg = {
+/* LZO-RLE streams are read by the same decompressor */
+static struct crypto_alg algs[] = { {
 	.cra_name		= "lzo",
 	.cra_flags		= CRYPTO_ALG_TYPE_COMPRESS,
 	.cra_ctxsize		= sizeof(struct lzo_ctx),
 	.cra_module		= THIS_MODULE,
-	.cra_list		= LIST_HEAD_INIT(alg.cra_list),
 	.cra_init		= lzo_init,
 	.cra_exit		= lzo_exit,
 	.cra_u			= { .compress = {
 	.coa_compress 		= lzo_compress,
 	.coa_decompress  	= lzo_decompress } }
-};
+}, {
+	.cra_name		= "lzo-rle",
+	.cra_flags		= CRYPTO_ALG_TYPE_COMPRESS,
+	.cra_ctxsize		= sizeof(struct lzo_ctx),
+	.cra_module		= THIS_MODULE,
+	.cra_init		= lzo_init,
+	.cra_exit		= lzo_exit,
+	.cra_u			= { .compress = {
+	.coa_compress 		= lzorle_compress,
+	.coa_decompress  	= lzo_decompress } }
+} };
 
 static int __init lzo_mod_init(void)
 {
-	return crypto_register_alg(&alg);
+	return crypto_register_algs(algs, ARRAY_SIZE(algs));
 }
 
 static void __exit lzo_mod_fini(void)
 {
-	crypto_unregister_alg(&alg);
+	crypto_unregister_algs(algs, ARRAY_SIZE(algs));
 }
 
 module_init(lzo_mod_init);
@@ -162,6 +162,64 @@ int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_finup);
 
+static int shash_finup_mb_fallback(struct shash_desc *desc,
+				   const u8 * const data[], unsigned int len,
+				   u8 * const outs[], unsigned int num_msgs)
+{
+	u8 state[crypto_shash_statesize(desc->tfm)];
+	unsigned int i;
+	int err;
+
+	err = crypto_shash_export(desc, state);
+
+	for (i = 0; !err && i < num_msgs; i++) {
+		if (i)
+			err = crypto_shash_import(desc, state);
+		err = err ?: crypto_shash_finup(desc, data[i], len, outs[i]);
+	}
+
+	memset(state, 0, sizeof(state));
+	return err;
+}
+
+/*
+ * Finish num_msgs messages of len bytes each, all continuing from the
+ * state in desc (e.g. after a common salt), into outs[].  Algorithms
+ * with finup_mb hash them interleaved, everything else one by one.
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	unsigned long alignmask = crypto_shash_alignmask(tfm);
+	unsigned int i;
+	int err;
+
+	if (!num_msgs)
+		return 0;
+
+	if (num_msgs == 1)
+		return crypto_shash_finup(desc, data[0], len, outs[0]);
+
+	if (!shash->finup_mb || num_msgs > shash->mb_max_msgs)
+		goto fallback;
+
+	for (i = 0; i < num_msgs; i++)
+		if (((unsigned long)data[i] | (unsigned long)outs[i]) &
+		    alignmask)
+			goto fallback;
+
+	err = shash->finup_mb(desc, data, len, outs, num_msgs);
+	if (err != -EOPNOTSUPP)
+		return err;
+
+fallback:
+	return shash_finup_mb_fallback(desc, data, len, outs, num_msgs);
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
 static int shash_digest_unaligned(struct shash_desc *desc, const u8 *data,
 				  unsigned int len, u8 *out)
 {
@@ -578,6 +636,8 @@ static int shash_prepare_alg(struct shash_alg *alg)
 	}
 	if (!alg->setkey)
 		alg->setkey = shash_no_setkey;
+	if (!alg->finup_mb || !alg->mb_max_msgs)
+		alg->mb_max_msgs = 1;
 
 	return 0;
 }
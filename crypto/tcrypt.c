@@ -22,6 +22,7 @@
  *
  */
 
+#include <crypto/aead.h>
 #include <crypto/hash.h>
 #include <linux/err.h>
 #include <linux/init.h>
@@ -64,7 +65,7 @@ static char *check[] = {
 	"cast6", "arc4", "michael_mic", "deflate", "crc32c", "tea", "xtea",
 	"khazad", "wp512", "wp384", "wp256", "tnepres", "xeta",  "fcrypt",
 	"camellia", "seed", "salsa20", "rmd128", "rmd160", "rmd256", "rmd320",
-	"lzo", "cts", "zlib", NULL
+	"lzo", "lzo-rle", "cts", "zlib", "chacha20", "poly1305", NULL
 };
 
 static int test_cipher_jiffies(struct blkcipher_desc *desc, int enc,
@@ -475,6 +476,116 @@ out:
 	crypto_free_hash(tfm);
 }
 
+static int test_hash_mb_jiffies(struct shash_desc *desc, const u8 *data[],
+				unsigned int len, u8 *outs[], unsigned int num,
+				int sec, bool mb)
+{
+	unsigned long start, end;
+	unsigned int i;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount += num) {
+		if (mb) {
+			ret = crypto_shash_init(desc) ?:
+			      crypto_shash_finup_mb(desc, data, len, outs, num);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		for (i = 0; i < num; i++) {
+			ret = crypto_shash_digest(desc, data[i], len, outs[i]);
+			if (ret)
+				return ret;
+		}
+	}
+
+	printk("%8u blocks/sec %s\n", bcount / sec,
+	       mb ? "interleaved" : "one by one");
+
+	return 0;
+}
+
+/*
+ * Blocks per second hashed one at a time and with crypto_shash_finup_mb(),
+ * for as many messages as the algorithm interleaves.  Timed in jiffies
+ * only, for at least one second.
+ */
+static void test_hash_mb_speed(const char *algo, unsigned int sec,
+			       unsigned int *blen)
+{
+	const u8 *data[TVMEMSIZE];
+	u8 *outs[TVMEMSIZE];
+	static u8 output[TVMEMSIZE][64];
+	struct crypto_shash *tfm;
+	unsigned int num, i;
+	int ret;
+
+	printk(KERN_INFO "\ntesting multi-buffer speed of %s\n", algo);
+
+	tfm = crypto_alloc_shash(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		printk(KERN_ERR "failed to load transform for %s: %ld\n", algo,
+		       PTR_ERR(tfm));
+		return;
+	}
+
+	if (crypto_shash_digestsize(tfm) > sizeof(output[0])) {
+		printk(KERN_ERR "digestsize(%u) > outputbuffer(%zu)\n",
+		       crypto_shash_digestsize(tfm), sizeof(output[0]));
+		goto out;
+	}
+
+	num = min_t(unsigned int, crypto_shash_mb_max_msgs(tfm), TVMEMSIZE);
+	for (i = 0; i < num; i++) {
+		memset(tvmem[i], 0xff - i, PAGE_SIZE);
+		data[i] = tvmem[i];
+		outs[i] = output[i];
+	}
+
+	if (!sec)
+		sec = 1;
+
+	do {
+		struct {
+			struct shash_desc shash;
+			char ctx[crypto_shash_descsize(tfm)];
+		} sdesc;
+
+		sdesc.shash.tfm = tfm;
+		sdesc.shash.flags = 0;
+
+		for (i = 0; blen[i] != 0; i++) {
+			if (blen[i] > PAGE_SIZE) {
+				printk(KERN_ERR "template (%u) too big for "
+				       "tvmem (%lu)\n", blen[i], PAGE_SIZE);
+				goto out;
+			}
+
+			printk(KERN_INFO "test%3u (%5u byte blocks, %u at "
+			       "once, %s):\n", i, blen[i], num,
+			       crypto_tfm_alg_driver_name(
+					crypto_shash_tfm(tfm)));
+
+			ret = test_hash_mb_jiffies(&sdesc.shash, data, blen[i],
+						   outs, num, sec, false);
+			if (!ret)
+				ret = test_hash_mb_jiffies(&sdesc.shash, data,
+							   blen[i], outs, num,
+							   sec, true);
+			if (ret) {
+				printk(KERN_ERR "hashing failed ret=%d\n", ret);
+				break;
+			}
+		}
+	} while (0);
+
+out:
+	crypto_free_shash(tfm);
+}
+
 struct tcrypt_result {
 	struct completion completion;
 	int err;
@@ -719,6 +830,158 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+static inline int do_one_aead_op(struct aead_request *req, int ret)
+{
+	if (ret == -EINPROGRESS || ret == -EBUSY) {
+		struct tcrypt_result *tr = req->base.data;
+
+		ret = wait_for_completion_interruptible(&tr->completion);
+		if (!ret)
+			ret = tr->err;
+		INIT_COMPLETION(tr->completion);
+	}
+	return ret;
+}
+
+static int test_aead_jiffies(struct aead_request *req, int blen, int sec)
+{
+	unsigned long start, end;
+	int bcount;
+	int ret;
+
+	for (start = jiffies, end = start + sec * HZ, bcount = 0;
+	     time_before(jiffies, end); bcount++) {
+		ret = do_one_aead_op(req, crypto_aead_encrypt(req));
+		if (ret)
+			return ret;
+	}
+
+	printk("%d operations in %d seconds (%ld bytes)\n",
+	       bcount, sec, (long)bcount * blen);
+	return 0;
+}
+
+/*
+ * Unlike test_cipher_cycles() this runs with interrupts and bottom halves
+ * enabled: SIMD implementations hand requests from atomic context to a
+ * kernel thread, which would be measured instead.
+ */
+static int test_aead_cycles(struct aead_request *req, int blen)
+{
+	unsigned long cycles = 0;
+	int ret = 0;
+	int i;
+
+	/* Warm-up run. */
+	for (i = 0; i < 4; i++) {
+		ret = do_one_aead_op(req, crypto_aead_encrypt(req));
+		if (ret)
+			return ret;
+	}
+
+	/* The real thing. */
+	for (i = 0; i < 8; i++) {
+		cycles_t start, end;
+
+		start = get_cycles();
+		ret = do_one_aead_op(req, crypto_aead_encrypt(req));
+		end = get_cycles();
+
+		if (ret)
+			return ret;
+
+		cycles += end - start;
+	}
+
+	printk("1 operation in %lu cycles (%d bytes)\n",
+	       (cycles + 4) / 8, blen);
+	return 0;
+}
+
+/* Packet sizes, 1420 bytes being a full size ESP payload */
+static u32 aead_sizes[] = { 16, 64, 256, 512, 1024, 1420, 0 };
+
+static void test_aead_speed(const char *algo, unsigned int sec,
+			    u8 *keysize, unsigned int assoclen)
+{
+	struct scatterlist sg[1], asg[1];
+	struct tcrypt_result tresult;
+	struct aead_request *req;
+	struct crypto_aead *tfm;
+	unsigned int authsize, i;
+	char iv[128];
+	u32 *b_size;
+	int ret;
+
+	printk(KERN_INFO "\ntesting speed of %s encryption\n", algo);
+
+	tfm = crypto_alloc_aead(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(tfm));
+		return;
+	}
+
+	req = aead_request_alloc(tfm, GFP_KERNEL);
+	if (!req) {
+		pr_err("aead request allocation failure\n");
+		goto out;
+	}
+
+	init_completion(&tresult.completion);
+	aead_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+				  tcrypt_complete, &tresult);
+
+	authsize = crypto_aead_authsize(tfm);
+	memset(tvmem[0], 0xff, PAGE_SIZE);
+	memset(tvmem[1], 0xff, PAGE_SIZE);
+	memset(iv, 0xff, crypto_aead_ivsize(tfm));
+
+	/* one buffer per packet, as ESP passes it */
+	sg_init_one(asg, tvmem[0], assoclen);
+
+	i = 0;
+	do {
+		ret = crypto_aead_setkey(tfm, tvmem[0], *keysize);
+		if (ret) {
+			pr_err("setkey() failed flags=%x\n",
+			       crypto_aead_get_flags(tfm));
+			goto out_free_req;
+		}
+
+		for (b_size = aead_sizes; *b_size; b_size++, i++) {
+			if (*b_size + authsize > PAGE_SIZE) {
+				pr_err("template (%u) too big for tvmem (%lu)\n",
+				       *b_size + authsize, PAGE_SIZE);
+				goto out_free_req;
+			}
+
+			printk("test %u (%d bit key, %d byte blocks): ", i,
+			       *keysize * 8, *b_size);
+
+			sg_init_one(sg, tvmem[1], *b_size + authsize);
+			aead_request_set_crypt(req, sg, sg, *b_size, iv);
+			aead_request_set_assoc(req, asg, assoclen);
+
+			if (sec)
+				ret = test_aead_jiffies(req, *b_size, sec);
+			else
+				ret = test_aead_cycles(req, *b_size);
+
+			if (ret) {
+				pr_err("encryption failed ret=%d\n", ret);
+				goto out_free_req;
+			}
+		}
+		keysize++;
+	} while (*keysize);
+
+out_free_req:
+	aead_request_free(req);
+out:
+	crypto_free_aead(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -906,6 +1169,7 @@ static int do_test(int m)
 
 	case 36:
 		ret += tcrypt_test("lzo");
+		ret += tcrypt_test("lzo-rle");
 		break;
 
 	case 37:
@@ -944,6 +1208,22 @@ static int do_test(int m)
 		ret += tcrypt_test("rfc4309(ccm(aes))");
 		break;
 
+	case 46:
+		ret += tcrypt_test("chacha20");
+		break;
+
+	case 47:
+		ret += tcrypt_test("poly1305");
+		break;
+
+	case 48:
+		ret += tcrypt_test("rfc7539(chacha20,poly1305)");
+		break;
+
+	case 49:
+		ret += tcrypt_test("rfc7539esp(chacha20,poly1305)");
+		break;
+
 	case 100:
 		ret += tcrypt_test("hmac(md5)");
 		break;
@@ -1079,6 +1359,24 @@ static int do_test(int m)
 				  speed_template_16_32);
 		break;
 
+	case 207:
+		test_aead_speed("rfc4106(gcm(aes))", sec,
+				aead_speed_template_20_28_36, 8);
+		test_aead_speed("gcm(aes)", sec, speed_template_16_24_32, 16);
+		break;
+
+	case 208:
+		test_cipher_speed("chacha20", ENCRYPT, sec, NULL, 0,
+				  speed_template_32);
+		break;
+
+	case 209:
+		test_aead_speed("rfc7539esp(chacha20,poly1305)", sec,
+				aead_speed_template_36, 8);
+		test_aead_speed("rfc7539(chacha20,poly1305)", sec,
+				speed_template_32, 16);
+		break;
+
 	case 300:
 		/* fall through */
 
@@ -1152,6 +1450,24 @@ static int do_test(int m)
 
 	case 318:
 		test_hash_speed("ghash-generic", sec, hash_speed_template_16);
+		test_hash_speed("ghash-neon", sec, hash_speed_template_16);
+		if (mode > 300 && mode < 400) break;
+
+	case 319:
+		test_hash_speed("sha256-generic", sec,
+				generic_hash_speed_template);
+		test_hash_speed("sha256-asm", sec, generic_hash_speed_template);
+		test_hash_speed("sha256-neon", sec, generic_hash_speed_template);
+		if (mode > 300 && mode < 400) break;
+
+	case 320:
+		test_hash_speed("poly1305-generic", sec,
+				poly1305_speed_template);
+		test_hash_speed("poly1305-neon", sec, poly1305_speed_template);
+		if (mode > 300 && mode < 400) break;
+
+	case 321:
+		test_hash_mb_speed("sha256", sec, hash_mb_speed_template);
 		if (mode > 300 && mode < 400) break;
 
 	case 399:
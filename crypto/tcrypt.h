@@ -47,12 +47,19 @@ static struct cipher_speed_template des3_speed_template[] = {
  */
 static u8 speed_template_8[] = {8, 0};
 static u8 speed_template_24[] = {24, 0};
+static u8 speed_template_32[] = {32, 0};
 static u8 speed_template_8_32[] = {8, 32, 0};
 static u8 speed_template_16_32[] = {16, 32, 0};
 static u8 speed_template_16_24_32[] = {16, 24, 32, 0};
 static u8 speed_template_32_40_48[] = {32, 40, 48, 0};
 static u8 speed_template_32_48_64[] = {32, 48, 64, 0};
 
+/*
+ * AEAD speed tests, rfc4106 and rfc7539esp keys carry a four byte nonce
+ */
+static u8 aead_speed_template_20_28_36[] = {20, 28, 36, 0};
+static u8 aead_speed_template_36[] = {36, 0};
+
 /*
  * Digest speed tests
  */
@@ -112,4 +119,31 @@ static struct hash_speed hash_speed_template_16[] = {
 	{  .blen = 0,	.plen = 0,	.klen = 0, }
 };
 
+/*
+ * Poly1305 takes its one time key as the first 32 bytes of data, so every
+ * test starts with at least that much.
+ */
+static struct hash_speed poly1305_speed_template[] = {
+	{ .blen = 96,	.plen = 16, },
+	{ .blen = 96,	.plen = 32, },
+	{ .blen = 96,	.plen = 96, },
+	{ .blen = 288,	.plen = 16, },
+	{ .blen = 288,	.plen = 32, },
+	{ .blen = 288,	.plen = 288, },
+	{ .blen = 1056,	.plen = 32, },
+	{ .blen = 1056,	.plen = 1056, },
+	{ .blen = 2080,	.plen = 32, },
+	{ .blen = 2080,	.plen = 2080, },
+	{ .blen = 4128,	.plen = 4128, },
+	{ .blen = 8224,	.plen = 8224, },
+
+	/* End marker */
+	{  .blen = 0,	.plen = 0, }
+};
+
+/*
+ * Multi-buffer digest speed tests, message sizes in bytes
+ */
+static unsigned int hash_mb_speed_template[] = {64, 512, 1024, 4096, 0};
+
 #endif	/* _CRYPTO_TCRYPT_H */
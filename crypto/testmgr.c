@@ -1433,6 +1433,126 @@ static int alg_test_pcomp(const struct alg_test_desc *desc, const char *driver,
 	return err;
 }
 
+static int test_hash_mb_one(struct crypto_shash *tfm, const char *salt,
+			    unsigned int saltlen, const u8 *data[],
+			    unsigned int len, u8 *outs[], unsigned int n,
+			    u8 *result)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_shash_tfm(tfm));
+	unsigned int ds = crypto_shash_digestsize(tfm);
+	struct {
+		struct shash_desc shash;
+		char ctx[crypto_shash_descsize(tfm)];
+	} sdesc;
+	unsigned int i;
+	int ret;
+
+	sdesc.shash.tfm = tfm;
+	sdesc.shash.flags = 0;
+
+	ret = crypto_shash_init(&sdesc.shash) ?:
+	      crypto_shash_update(&sdesc.shash, salt, saltlen) ?:
+	      crypto_shash_finup_mb(&sdesc.shash, data, len, outs, n);
+	if (ret) {
+		printk(KERN_ERR "alg: hash: finup_mb failed for %s: %d\n",
+		       algo, -ret);
+		return ret;
+	}
+
+	for (i = 0; i < n; i++) {
+		ret = crypto_shash_init(&sdesc.shash) ?:
+		      crypto_shash_update(&sdesc.shash, salt, saltlen) ?:
+		      crypto_shash_finup(&sdesc.shash, data[i], len, result);
+		if (ret) {
+			printk(KERN_ERR "alg: hash: finup failed for %s: %d\n",
+			       algo, -ret);
+			return ret;
+		}
+
+		if (memcmp(result, outs[i], ds)) {
+			printk(KERN_ERR "alg: hash: Multi-buffer test failed "
+			       "for %s: %u messages, salt %u, length %u, "
+			       "message %u\n", algo, n, saltlen, len, i);
+			hexdump(outs[i], ds);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Compare crypto_shash_finup_mb() with one crypto_shash_finup() per
+ * message, for shash algorithms that hash several messages at once.
+ */
+static int test_hash_mb(const char *driver, u32 type, u32 mask,
+			struct hash_testvec *template)
+{
+	static const unsigned int salts[] = { 0, 16, 64 };
+	static const unsigned int lens[] = { 0, 1, 55, 56, 64, 100, 1000,
+					     PAGE_SIZE };
+	struct crypto_shash *tfm;
+	char *xbuf[XBUFSIZE];
+	const u8 *data[XBUFSIZE];
+	u8 *outs[XBUFSIZE];
+	unsigned int num, ds, i, j, n;
+	u8 *result;
+	int ret;
+
+	tfm = crypto_alloc_shash(driver, type, mask);
+	if (IS_ERR(tfm))
+		return 0;
+
+	ret = 0;
+	num = min_t(unsigned int, crypto_shash_mb_max_msgs(tfm), XBUFSIZE);
+	if (num < 2)
+		goto out_nobuf;
+
+	ret = -ENOMEM;
+	if (testmgr_alloc_buf(xbuf))
+		goto out_nobuf;
+
+	ds = crypto_shash_digestsize(tfm);
+	result = kmalloc((num + 1) * ds, GFP_KERNEL);
+	if (!result)
+		goto out_noresult;
+
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < PAGE_SIZE; j++)
+			xbuf[i][j] = j * 7 + i * 13;
+		data[i] = xbuf[i];
+		outs[i] = result + (i + 1) * ds;
+	}
+
+	if (template[0].ksize) {
+		ret = crypto_shash_setkey(tfm, template[0].key,
+					  template[0].ksize);
+		if (ret) {
+			printk(KERN_ERR "alg: hash: setkey failed for %s: "
+			       "%d\n", driver, -ret);
+			goto out;
+		}
+	}
+
+	for (n = 2; n <= num; n++)
+		for (i = 0; i < ARRAY_SIZE(salts); i++)
+			for (j = 0; j < ARRAY_SIZE(lens); j++) {
+				ret = test_hash_mb_one(tfm, xbuf[0], salts[i],
+						       data, lens[j], outs, n,
+						       result);
+				if (ret)
+					goto out;
+			}
+
+out:
+	kfree(result);
+out_noresult:
+	testmgr_free_buf(xbuf);
+out_nobuf:
+	crypto_free_shash(tfm);
+	return ret;
+}
+
 static int alg_test_hash(const struct alg_test_desc *desc, const char *driver,
 			 u32 type, u32 mask)
 {
@@ -1453,6 +1573,10 @@ static int alg_test_hash(const struct alg_test_desc *desc, const char *driver,
 				desc->suite.hash.count, false);
 
 	crypto_free_ahash(tfm);
+
+	if (!err)
+		err = test_hash_mb(driver, type, mask, desc->suite.hash.vecs);
+
 	return err;
 }
 
@@ -1705,6 +1829,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "chacha20",
+		.test = alg_test_skcipher,
+		.suite = {
+			.cipher = {
+				.enc = {
+					.vecs = chacha20_enc_tv_template,
+					.count = CHACHA20_ENC_TEST_VECTORS
+				},
+				.dec = {
+					.vecs = chacha20_enc_tv_template,
+					.count = CHACHA20_ENC_TEST_VECTORS
+				},
+			}
+		}
 	}, {
 		.alg = "crc32c",
 		.test = alg_test_crc32c,
@@ -2191,6 +2330,21 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "lzo-rle",
+		.test = alg_test_comp,
+		.suite = {
+			.comp = {
+				.comp = {
+					.vecs = lzorle_comp_tv_template,
+					.count = LZORLE_COMP_TEST_VECTORS
+				},
+				.decomp = {
+					.vecs = lzorle_decomp_tv_template,
+					.count = LZORLE_DECOMP_TEST_VECTORS
+				}
+			}
+		}
 	}, {
 		.alg = "md4",
 		.test = alg_test_hash,
@@ -2249,6 +2403,15 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "poly1305",
+		.test = alg_test_hash,
+		.suite = {
+			.hash = {
+				.vecs = poly1305_tv_template,
+				.count = POLY1305_TEST_VECTORS
+			}
+		}
 	}, {
 		.alg = "rfc3686(ctr(aes))",
 		.test = alg_test_skcipher,
@@ -2298,6 +2461,36 @@ static const struct alg_test_desc alg_test_descs[] = {
 				}
 			}
 		}
+	}, {
+		.alg = "rfc7539(chacha20,poly1305)",
+		.test = alg_test_aead,
+		.suite = {
+			.aead = {
+				.enc = {
+					.vecs = rfc7539_enc_tv_template,
+					.count = RFC7539_ENC_TEST_VECTORS
+				},
+				.dec = {
+					.vecs = rfc7539_dec_tv_template,
+					.count = RFC7539_DEC_TEST_VECTORS
+				},
+			}
+		}
+	}, {
+		.alg = "rfc7539esp(chacha20,poly1305)",
+		.test = alg_test_aead,
+		.suite = {
+			.aead = {
+				.enc = {
+					.vecs = rfc7539esp_enc_tv_template,
+					.count = RFC7539ESP_ENC_TEST_VECTORS
+				},
+				.dec = {
+					.vecs = rfc7539esp_dec_tv_template,
+					.count = RFC7539ESP_DEC_TEST_VECTORS
+				},
+			}
+		}
 	}, {
 		.alg = "rmd128",
 		.test = alg_test_hash,
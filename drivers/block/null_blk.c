@@ -0,0 +1,312 @@
+/*
+ * null_blk - a block device that completes all I/O without doing any
+ *
+ * Meant for measuring the overhead of the block layer itself: reads and
+ * writes finish as soon as they reach the driver, so what is left is the
+ * cost of getting them there.  The same device can be driven through the
+ * three submission paths, picked with queue_mode=:
+ *
+ *   0  bio based, no request queue at all
+ *   1  request based, single queue with elevator and queue_lock
+ *   2  multiqueue, see block/blk-mq.c (the default)
+ *
+ * and completed inline or from BLOCK_SOFTIRQ, picked with irqmode=.
+ * Please see Documentation/block/null_blk.txt.
+ */
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/bio.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/hdreg.h>
+#include <linux/log2.h>
+
+#define NULLB_NAME	"nullb"
+
+struct nullb {
+	struct list_head list;
+	unsigned int index;
+	struct request_queue *q;
+	struct gendisk *disk;
+};
+
+static LIST_HEAD(nullb_list);
+static DEFINE_MUTEX(nullb_lock);
+static int null_major;
+static int nullb_indexes;
+
+enum {
+	NULL_IRQ_NONE		= 0,
+	NULL_IRQ_SOFTIRQ	= 1,
+};
+
+enum {
+	NULL_Q_BIO		= 0,
+	NULL_Q_RQ		= 1,
+	NULL_Q_MQ		= 2,
+};
+
+static int submit_queues;
+module_param(submit_queues, int, S_IRUGO);
+MODULE_PARM_DESC(submit_queues, "Number of submission queues, default one per cpu");
+
+static int home_node = NUMA_NO_NODE;
+module_param(home_node, int, S_IRUGO);
+MODULE_PARM_DESC(home_node, "Home node for the device");
+
+static int queue_mode = NULL_Q_MQ;
+module_param(queue_mode, int, S_IRUGO);
+MODULE_PARM_DESC(queue_mode, "Block interface to use (0=bio,1=rq,2=multiqueue)");
+
+static int gb = 250;
+module_param(gb, int, S_IRUGO);
+MODULE_PARM_DESC(gb, "Size in GB");
+
+static int bs = 512;
+module_param(bs, int, S_IRUGO);
+MODULE_PARM_DESC(bs, "Block size (in bytes)");
+
+static int nr_devices = 2;
+module_param(nr_devices, int, S_IRUGO);
+MODULE_PARM_DESC(nr_devices, "Number of devices to register");
+
+static int irqmode = NULL_IRQ_SOFTIRQ;
+module_param(irqmode, int, S_IRUGO);
+MODULE_PARM_DESC(irqmode, "IRQ completion handler. 0-none, 1-softirq");
+
+static int hw_queue_depth = 64;
+module_param(hw_queue_depth, int, S_IRUGO);
+MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: 64");
+
+static void null_end_rq(struct request *rq, int error)
+{
+	if (queue_mode == NULL_Q_MQ)
+		blk_mq_end_io(rq, error);
+	else
+		blk_end_request_all(rq, error);
+}
+
+static void null_softirq_done_fn(struct request *rq)
+{
+	null_end_rq(rq, rq->errors);
+}
+
+static void null_complete_rq(struct request *rq)
+{
+	if (irqmode == NULL_IRQ_NONE) {
+		null_end_rq(rq, 0);
+		return;
+	}
+
+	/* bounce the completion through BLOCK_SOFTIRQ, like a real device */
+	if (queue_mode == NULL_Q_MQ)
+		blk_mq_complete_request(rq, 0);
+	else
+		blk_complete_request(rq);
+}
+
+static int null_queue_rq(struct blk_mq_hw_ctx *hctx, struct request *rq)
+{
+	null_complete_rq(rq);
+	return BLK_MQ_RQ_QUEUE_OK;
+}
+
+static struct blk_mq_ops null_mq_ops = {
+	.queue_rq	= null_queue_rq,
+	.map_queue	= blk_mq_map_queue,
+};
+
+/*
+ * Called with q->queue_lock held and interrupts off.  blk_end_request_all
+ * takes the lock itself, so completing inline means dropping it.
+ */
+static void null_request_fn(struct request_queue *q)
+{
+	struct request *rq;
+
+	while ((rq = blk_fetch_request(q)) != NULL) {
+		if (irqmode == NULL_IRQ_NONE) {
+			spin_unlock_irq(q->queue_lock);
+			blk_end_request_all(rq, 0);
+			spin_lock_irq(q->queue_lock);
+		} else {
+			blk_complete_request(rq);
+		}
+	}
+}
+
+static int null_make_request(struct request_queue *q, struct bio *bio)
+{
+	bio_endio(bio, 0);
+	return 0;
+}
+
+static int null_open(struct block_device *bdev, fmode_t mode)
+{
+	return 0;
+}
+
+static int null_release(struct gendisk *disk, fmode_t mode)
+{
+	return 0;
+}
+
+static const struct block_device_operations null_fops = {
+	.owner =	THIS_MODULE,
+	.open =		null_open,
+	.release =	null_release,
+};
+
+static void null_del_dev(struct nullb *nullb)
+{
+	list_del_init(&nullb->list);
+
+	del_gendisk(nullb->disk);
+	blk_cleanup_queue(nullb->q);
+	put_disk(nullb->disk);
+	kfree(nullb);
+}
+
+static int null_add_dev(void)
+{
+	struct gendisk *disk;
+	struct nullb *nullb;
+	sector_t size;
+
+	nullb = kzalloc_node(sizeof(*nullb), GFP_KERNEL, home_node);
+	if (!nullb)
+		return -ENOMEM;
+
+	switch (queue_mode) {
+	case NULL_Q_MQ: {
+		struct blk_mq_reg reg = {
+			.ops		= &null_mq_ops,
+			.nr_hw_queues	= submit_queues,
+			.queue_depth	= hw_queue_depth,
+			.numa_node	= home_node,
+			.flags		= BLK_MQ_F_SHOULD_MERGE,
+		};
+
+		nullb->q = blk_mq_init_queue(&reg, nullb);
+		if (IS_ERR(nullb->q)) {
+			nullb->q = NULL;
+			goto out_free_nullb;
+		}
+		break;
+	}
+	case NULL_Q_BIO:
+		nullb->q = blk_alloc_queue_node(GFP_KERNEL, home_node);
+		if (!nullb->q)
+			goto out_free_nullb;
+		blk_queue_make_request(nullb->q, null_make_request);
+		break;
+	default:
+		nullb->q = blk_init_queue_node(null_request_fn, NULL, home_node);
+		if (!nullb->q)
+			goto out_free_nullb;
+		break;
+	}
+
+	nullb->q->queuedata = nullb;
+	if (irqmode == NULL_IRQ_SOFTIRQ)
+		blk_queue_softirq_done(nullb->q, null_softirq_done_fn);
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, nullb->q);
+	blk_queue_logical_block_size(nullb->q, bs);
+	blk_queue_physical_block_size(nullb->q, bs);
+
+	disk = nullb->disk = alloc_disk_node(1, home_node);
+	if (!disk)
+		goto out_cleanup_queue;
+
+	mutex_lock(&nullb_lock);
+	list_add_tail(&nullb->list, &nullb_list);
+	nullb->index = nullb_indexes++;
+	mutex_unlock(&nullb_lock);
+
+	size = gb * 1024 * 1024 * 1024ULL;
+	sector_div(size, bs);
+	set_capacity(disk, size * (bs >> 9));
+
+	disk->flags |= GENHD_FL_EXT_DEVT;
+	disk->major		= null_major;
+	disk->first_minor	= nullb->index;
+	disk->fops		= &null_fops;
+	disk->private_data	= nullb;
+	disk->queue		= nullb->q;
+	sprintf(disk->disk_name, "nullb%d", nullb->index);
+	add_disk(disk);
+	return 0;
+
+out_cleanup_queue:
+	blk_cleanup_queue(nullb->q);
+out_free_nullb:
+	kfree(nullb);
+	return -ENOMEM;
+}
+
+static void null_exit_devices(void)
+{
+	struct nullb *nullb;
+
+	mutex_lock(&nullb_lock);
+	while (!list_empty(&nullb_list)) {
+		nullb = list_entry(nullb_list.next, struct nullb, list);
+		null_del_dev(nullb);
+	}
+	mutex_unlock(&nullb_lock);
+}
+
+static int __init null_init(void)
+{
+	unsigned int i;
+
+	if (bs > PAGE_SIZE || bs < 512 || !is_power_of_2(bs)) {
+		printk(KERN_WARNING "null_blk: invalid block size %d, "
+		       "using 512\n", bs);
+		bs = 512;
+	}
+
+	if (irqmode != NULL_IRQ_NONE && irqmode != NULL_IRQ_SOFTIRQ)
+		irqmode = NULL_IRQ_SOFTIRQ;
+	if (queue_mode < NULL_Q_BIO || queue_mode > NULL_Q_MQ)
+		queue_mode = NULL_Q_MQ;
+
+	if (queue_mode == NULL_Q_MQ) {
+		if (submit_queues <= 0 || submit_queues > nr_cpu_ids)
+			submit_queues = nr_cpu_ids;
+		if (hw_queue_depth <= 0)
+			hw_queue_depth = 64;
+	} else {
+		submit_queues = 1;
+	}
+
+	null_major = register_blkdev(0, NULLB_NAME);
+	if (null_major < 0)
+		return null_major;
+
+	for (i = 0; i < nr_devices; i++) {
+		if (null_add_dev()) {
+			null_exit_devices();
+			unregister_blkdev(null_major, NULLB_NAME);
+			return -EINVAL;
+		}
+	}
+
+	printk(KERN_INFO "null_blk: module loaded\n");
+	return 0;
+}
+
+static void __exit null_exit(void)
+{
+	null_exit_devices();
+	unregister_blkdev(null_major, NULLB_NAME);
+}
+
+module_init(null_init);
+module_exit(null_exit);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,138 @@
+/*
+ * drivers/cpufreq/cpufreq_dummy.c
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A cpufreq driver for no hardware at all.  Every cpu gets a made up
+ * table of operating points and the driver only pretends to switch
+ * between them, optionally taking transition_latency_us to do so.
+ * Transitions are notified like on real hardware, so governors can be
+ * exercised and compared through cpufreq_stats and the cpu_frequency
+ * events on machines whose clocks cannot, or should not, be touched.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/cpufreq.h>
+#include <linux/delay.h>
+#include <linux/percpu.h>
+
+static struct cpufreq_frequency_table dummy_freq_table[] = {
+	{ 0,  200000 },
+	{ 1,  400000 },
+	{ 2,  600000 },
+	{ 3,  800000 },
+	{ 4, 1000000 },
+	{ 5, 1200000 },
+	{ 6, CPUFREQ_TABLE_END },
+};
+
+static DEFINE_PER_CPU(unsigned int, dummy_cur_freq);
+
+static unsigned int transition_latency_us;
+module_param(transition_latency_us, uint, S_IRUGO);
+MODULE_PARM_DESC(transition_latency_us,
+		 "Time a frequency switch takes, in microseconds (default 0)");
+
+static int dummy_verify_speed(struct cpufreq_policy *policy)
+{
+	return cpufreq_frequency_table_verify(policy, dummy_freq_table);
+}
+
+static unsigned int dummy_getspeed(unsigned int cpu)
+{
+	return per_cpu(dummy_cur_freq, cpu);
+}
+
+static int dummy_target(struct cpufreq_policy *policy,
+			unsigned int target_freq, unsigned int relation)
+{
+	struct cpufreq_freqs freqs;
+	unsigned int index;
+	int ret;
+
+	ret = cpufreq_frequency_table_target(policy, dummy_freq_table,
+					     target_freq, relation, &index);
+	if (ret)
+		return ret;
+
+	freqs.cpu = policy->cpu;
+	freqs.old = per_cpu(dummy_cur_freq, policy->cpu);
+	freqs.new = dummy_freq_table[index].frequency;
+	if (freqs.old == freqs.new)
+		return 0;
+
+	cpufreq_notify_transition(&freqs, CPUFREQ_PRECHANGE);
+	if (transition_latency_us)
+		usleep_range(transition_latency_us, transition_latency_us);
+	per_cpu(dummy_cur_freq, policy->cpu) = freqs.new;
+	cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
+
+	return 0;
+}
+
+static int dummy_cpu_init(struct cpufreq_policy *policy)
+{
+	int ret;
+
+	ret = cpufreq_frequency_table_cpuinfo(policy, dummy_freq_table);
+	if (ret)
+		return ret;
+
+	if (!per_cpu(dummy_cur_freq, policy->cpu))
+		per_cpu(dummy_cur_freq, policy->cpu) =
+			dummy_freq_table[0].frequency;
+	policy->cur = per_cpu(dummy_cur_freq, policy->cpu);
+	policy->cpuinfo.transition_latency =
+		transition_latency_us * NSEC_PER_USEC;
+	cpufreq_frequency_table_get_attr(dummy_freq_table, policy->cpu);
+
+	return 0;
+}
+
+static int dummy_cpu_exit(struct cpufreq_policy *policy)
+{
+	cpufreq_frequency_table_put_attr(policy->cpu);
+	return 0;
+}
+
+static struct freq_attr *dummy_cpufreq_attr[] = {
+	&cpufreq_freq_attr_scaling_available_freqs,
+	NULL,
+};
+
+static struct cpufreq_driver dummy_cpufreq_driver = {
+	.flags		= CPUFREQ_STICKY,
+	.verify		= dummy_verify_speed,
+	.target		= dummy_target,
+	.get		= dummy_getspeed,
+	.init		= dummy_cpu_init,
+	.exit		= dummy_cpu_exit,
+	.name		= "dummy",
+	.owner		= THIS_MODULE,
+	.attr		= dummy_cpufreq_attr,
+};
+
+static int __init dummy_cpufreq_init(void)
+{
+	return cpufreq_register_driver(&dummy_cpufreq_driver);
+}
+
+static void __exit dummy_cpufreq_exit(void)
+{
+	cpufreq_unregister_driver(&dummy_cpufreq_driver);
+}
+
+module_init(dummy_cpufreq_init);
+module_exit(dummy_cpufreq_exit);
+
+MODULE_DESCRIPTION("cpufreq driver without hardware, for testing governors");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,453 @@
+/*
+ * drivers/cpufreq/cpufreq_schedutil.c
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * A governor that does not sample anything.  The scheduler calls into
+ * it whenever the utilization of a runqueue changes (task enqueue and
+ * dequeue, and the tick), and the frequency is picked right there from
+ * the tracked utilization instead of from idle time measured over the
+ * last timer period.  Frequency switches may sleep, so they are handed
+ * to a SCHED_FIFO thread, and are rate limited separately for going up
+ * and going down.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpumask.h>
+#include <linux/cpufreq.h>
+#include <linux/module.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/irq_work.h>
+#include <linux/kthread.h>
+#include <linux/math64.h>
+#include <linux/time.h>
+
+static int active_count;
+
+struct cpufreq_schedutil_cpuinfo {
+	struct update_util_data update_util;
+	struct cpufreq_policy *policy;
+	unsigned long util;
+	unsigned long max;
+	u64 last_update;
+
+	/*
+	 * Only used in the instance of policy->cpu.  update_lock protects
+	 * the next three fields as well as util, max and last_update of
+	 * all cpus of the policy.
+	 */
+	raw_spinlock_t update_lock;
+	unsigned int next_freq;
+	u64 last_freq_update_time;
+	bool work_in_progress;
+	struct irq_work irq_work;
+	struct cpufreq_frequency_table *freq_table;
+	struct rw_semaphore enable_sem;
+	int governor_enabled;
+};
+
+static DEFINE_PER_CPU(struct cpufreq_schedutil_cpuinfo, cpuinfo);
+
+/* realtime thread handles frequency scaling */
+static struct task_struct *speedchange_task;
+static cpumask_t speedchange_cpumask;
+static spinlock_t speedchange_cpumask_lock;
+static struct mutex gov_lock;
+
+/*
+ * Utilization, in percent of the current capacity, the chosen frequency
+ * should end up at.  Lower values result in higher CPU speeds.
+ */
+#define DEFAULT_TARGET_LOAD 80
+static unsigned int target_load = DEFAULT_TARGET_LOAD;
+
+/* Minimum time between two frequency increases, resp. decreases. */
+#define DEFAULT_UP_RATE_LIMIT (500)
+static unsigned int up_rate_limit_us = DEFAULT_UP_RATE_LIMIT;
+#define DEFAULT_DOWN_RATE_LIMIT (20 * USEC_PER_MSEC)
+static unsigned int down_rate_limit_us = DEFAULT_DOWN_RATE_LIMIT;
+
+static int cpufreq_governor_schedutil(struct cpufreq_policy *policy,
+		unsigned int event);
+
+#ifndef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHEDUTIL
+static
+#endif
+struct cpufreq_governor cpufreq_gov_schedutil = {
+	.name = "schedutil",
+	.governor = cpufreq_governor_schedutil,
+	.max_transition_latency = 10000000,
+	.owner = THIS_MODULE,
+};
+
+/*
+ * The frequency a policy needs is that of its busiest cpu.  A cpu that
+ * has not reported for more than a tick is idle with its tick stopped
+ * and does not count.
+ */
+static unsigned int cpufreq_schedutil_next_freq(
+	struct cpufreq_schedutil_cpuinfo *ppol, u64 time)
+{
+	struct cpufreq_policy *policy = ppol->policy;
+	unsigned long util = 0, max = 1;
+	unsigned int freq, index;
+	unsigned int j;
+
+	for_each_cpu(j, policy->cpus) {
+		struct cpufreq_schedutil_cpuinfo *pcpu = &per_cpu(cpuinfo, j);
+
+		if ((s64)(time - pcpu->last_update) > TICK_NSEC)
+			continue;
+		if (pcpu->util * max > util * pcpu->max) {
+			util = pcpu->util;
+			max = pcpu->max;
+		}
+	}
+
+	freq = div64_u64((u64)policy->cpuinfo.max_freq * util * 100,
+			 (u64)max * target_load);
+	freq = clamp(freq, policy->min, policy->max);
+
+	if (ppol->freq_table &&
+	    !cpufreq_frequency_table_target(policy, ppol->freq_table, freq,
+					    CPUFREQ_RELATION_L, &index))
+		freq = ppol->freq_table[index].frequency;
+
+	return freq;
+}
+
+/*
+ * Called by the scheduler with the runqueue lock of the cpu held and
+ * interrupts off, so nothing here may sleep or wake a task directly.
+ */
+static void cpufreq_schedutil_update(struct update_util_data *data, u64 time,
+				     unsigned long util, unsigned long max)
+{
+	struct cpufreq_schedutil_cpuinfo *pcpu =
+		container_of(data, struct cpufreq_schedutil_cpuinfo,
+			     update_util);
+	struct cpufreq_schedutil_cpuinfo *ppol =
+		&per_cpu(cpuinfo, pcpu->policy->cpu);
+	unsigned int next_freq;
+	u64 delay_ns;
+
+	raw_spin_lock(&ppol->update_lock);
+
+	pcpu->util = util;
+	pcpu->max = max;
+	pcpu->last_update = time;
+
+	next_freq = cpufreq_schedutil_next_freq(ppol, time);
+	if (next_freq == ppol->next_freq)
+		goto out;
+
+	if (next_freq > ppol->next_freq)
+		delay_ns = (u64)up_rate_limit_us * NSEC_PER_USEC;
+	else
+		delay_ns = (u64)down_rate_limit_us * NSEC_PER_USEC;
+	if ((s64)(time - ppol->last_freq_update_time) < (s64)delay_ns)
+		goto out;
+
+	ppol->next_freq = next_freq;
+	ppol->last_freq_update_time = time;
+
+	if (!ppol->work_in_progress) {
+		ppol->work_in_progress = true;
+		irq_work_queue(&ppol->irq_work);
+	}
+out:
+	raw_spin_unlock(&ppol->update_lock);
+}
+
+static void cpufreq_schedutil_irq_work(struct irq_work *irq_work)
+{
+	struct cpufreq_schedutil_cpuinfo *ppol =
+		container_of(irq_work, struct cpufreq_schedutil_cpuinfo,
+			     irq_work);
+	unsigned long flags;
+
+	spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+	cpumask_set_cpu(ppol->policy->cpu, &speedchange_cpumask);
+	spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+	wake_up_process(speedchange_task);
+}
+
+static int cpufreq_schedutil_speedchange_task(void *data)
+{
+	unsigned int cpu;
+	cpumask_t tmp_mask;
+	unsigned long flags;
+	struct cpufreq_schedutil_cpuinfo *ppol;
+
+	while (1) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+
+		if (cpumask_empty(&speedchange_cpumask)) {
+			spin_unlock_irqrestore(&speedchange_cpumask_lock,
+					       flags);
+			schedule();
+
+			if (kthread_should_stop())
+				break;
+
+			spin_lock_irqsave(&speedchange_cpumask_lock, flags);
+		}
+
+		set_current_state(TASK_RUNNING);
+		tmp_mask = speedchange_cpumask;
+		cpumask_clear(&speedchange_cpumask);
+		spin_unlock_irqrestore(&speedchange_cpumask_lock, flags);
+
+		for_each_cpu(cpu, &tmp_mask) {
+			unsigned int freq;
+
+			ppol = &per_cpu(cpuinfo, cpu);
+			if (!down_read_trylock(&ppol->enable_sem))
+				continue;
+			if (!ppol->governor_enabled) {
+				up_read(&ppol->enable_sem);
+				continue;
+			}
+
+			raw_spin_lock_irqsave(&ppol->update_lock, flags);
+			freq = ppol->next_freq;
+			ppol->work_in_progress = false;
+			raw_spin_unlock_irqrestore(&ppol->update_lock, flags);
+
+			if (freq != ppol->policy->cur)
+				__cpufreq_driver_target(ppol->policy, freq,
+							CPUFREQ_RELATION_L);
+
+			up_read(&ppol->enable_sem);
+		}
+	}
+
+	return 0;
+}
+
+static ssize_t show_target_load(struct kobject *kobj,
+				struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", target_load);
+}
+
+static ssize_t store_target_load(struct kobject *kobj,
+				 struct attribute *attr, const char *buf,
+				 size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	if (!val || val > 100)
+		return -EINVAL;
+
+	target_load = val;
+	return count;
+}
+
+static struct global_attr target_load_attr = __ATTR(target_load, 0644,
+		show_target_load, store_target_load);
+
+static ssize_t show_up_rate_limit_us(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", up_rate_limit_us);
+}
+
+static ssize_t store_up_rate_limit_us(struct kobject *kobj,
+				      struct attribute *attr, const char *buf,
+				      size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	up_rate_limit_us = val;
+	return count;
+}
+
+static struct global_attr up_rate_limit_us_attr =
+	__ATTR(up_rate_limit_us, 0644, show_up_rate_limit_us,
+	       store_up_rate_limit_us);
+
+static ssize_t show_down_rate_limit_us(struct kobject *kobj,
+				       struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", down_rate_limit_us);
+}
+
+static ssize_t store_down_rate_limit_us(struct kobject *kobj,
+					struct attribute *attr,
+					const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = kstrtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	down_rate_limit_us = val;
+	return count;
+}
+
+static struct global_attr down_rate_limit_us_attr =
+	__ATTR(down_rate_limit_us, 0644, show_down_rate_limit_us,
+	       store_down_rate_limit_us);
+
+static struct attribute *schedutil_attributes[] = {
+	&target_load_attr.attr,
+	&up_rate_limit_us_attr.attr,
+	&down_rate_limit_us_attr.attr,
+	NULL,
+};
+
+static struct attribute_group schedutil_attr_group = {
+	.attrs = schedutil_attributes,
+	.name = "schedutil",
+};
+
+static int cpufreq_governor_schedutil(struct cpufreq_policy *policy,
+		unsigned int event)
+{
+	int rc;
+	unsigned int j;
+	struct cpufreq_schedutil_cpuinfo *pcpu, *ppol;
+
+	switch (event) {
+	case CPUFREQ_GOV_START:
+		if (!cpu_online(policy->cpu))
+			return -EINVAL;
+
+		mutex_lock(&gov_lock);
+
+		ppol = &per_cpu(cpuinfo, policy->cpu);
+		down_write(&ppol->enable_sem);
+		ppol->freq_table = cpufreq_frequency_get_table(policy->cpu);
+		ppol->next_freq = policy->cur;
+		ppol->last_freq_update_time = 0;
+		ppol->work_in_progress = false;
+		ppol->governor_enabled = 1;
+		up_write(&ppol->enable_sem);
+
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->policy = policy;
+			pcpu->util = 0;
+			pcpu->max = SCHED_LOAD_SCALE;
+			pcpu->last_update = 0;
+			cpufreq_set_update_util_data(j, &pcpu->update_util);
+		}
+
+		/* Do not create sysfs entries if we have already done so. */
+		if (++active_count > 1) {
+			mutex_unlock(&gov_lock);
+			return 0;
+		}
+
+		rc = sysfs_create_group(cpufreq_global_kobject,
+				&schedutil_attr_group);
+		mutex_unlock(&gov_lock);
+		return rc;
+
+	case CPUFREQ_GOV_STOP:
+		mutex_lock(&gov_lock);
+		for_each_cpu(j, policy->cpus)
+			cpufreq_set_update_util_data(j, NULL);
+
+		/* wait for hooks already running, then for their irq_work */
+		synchronize_sched();
+		ppol = &per_cpu(cpuinfo, policy->cpu);
+		irq_work_sync(&ppol->irq_work);
+
+		down_write(&ppol->enable_sem);
+		ppol->governor_enabled = 0;
+		up_write(&ppol->enable_sem);
+
+		if (--active_count > 0) {
+			mutex_unlock(&gov_lock);
+			return 0;
+		}
+
+		sysfs_remove_group(cpufreq_global_kobject,
+				&schedutil_attr_group);
+		mutex_unlock(&gov_lock);
+		break;
+
+	case CPUFREQ_GOV_LIMITS:
+		if (policy->max < policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->max, CPUFREQ_RELATION_H);
+		else if (policy->min > policy->cur)
+			__cpufreq_driver_target(policy,
+					policy->min, CPUFREQ_RELATION_L);
+		break;
+	}
+	return 0;
+}
+
+static int __init cpufreq_schedutil_init(void)
+{
+	unsigned int i;
+	struct cpufreq_schedutil_cpuinfo *pcpu;
+	struct sched_param param = { .sched_priority = MAX_RT_PRIO-1 };
+
+	for_each_possible_cpu(i) {
+		pcpu = &per_cpu(cpuinfo, i);
+		pcpu->update_util.func = cpufreq_schedutil_update;
+		raw_spin_lock_init(&pcpu->update_lock);
+		init_irq_work(&pcpu->irq_work, cpufreq_schedutil_irq_work);
+		init_rwsem(&pcpu->enable_sem);
+	}
+
+	spin_lock_init(&speedchange_cpumask_lock);
+	mutex_init(&gov_lock);
+	speedchange_task =
+		kthread_create(cpufreq_schedutil_speedchange_task, NULL,
+			       "cfschedutil");
+	if (IS_ERR(speedchange_task))
+		return PTR_ERR(speedchange_task);
+
+	sched_setscheduler_nocheck(speedchange_task, SCHED_FIFO, &param);
+	get_task_struct(speedchange_task);
+
+	/* NB: wake up so the thread does not look hung to the freezer */
+	wake_up_process(speedchange_task);
+
+	return cpufreq_register_governor(&cpufreq_gov_schedutil);
+}
+
+#ifdef CONFIG_CPU_FREQ_DEFAULT_GOV_SCHEDUTIL
+fs_initcall(cpufreq_schedutil_init);
+#else
+module_init(cpufreq_schedutil_init);
+#endif
+
+static void __exit cpufreq_schedutil_exit(void)
+{
+	cpufreq_unregister_governor(&cpufreq_gov_schedutil);
+	kthread_stop(speedchange_task);
+	put_task_struct(speedchange_task);
+}
+
+module_exit(cpufreq_schedutil_exit);
+
+MODULE_DESCRIPTION("'cpufreq_schedutil' - A cpufreq governor driven by "
+	"scheduler utilization");
+MODULE_LICENSE("GPL");
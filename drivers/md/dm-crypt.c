@@ -11,6 +11,8 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/hardirq.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
 #include <linux/mempool.h>
@@ -19,6 +21,7 @@
 #include <linux/workqueue.h>
 #include <linux/backing-dev.h>
 #include <linux/percpu.h>
+#include <linux/rbtree.h>
 #include <asm/atomic.h>
 #include <linux/scatterlist.h>
 #include <asm/page.h>
@@ -45,6 +48,8 @@ struct convert_context {
 	unsigned int idx_out;
 	sector_t sector;
 	atomic_t pending;
+	/* private request for inline conversion, see crypt_convert_inline */
+	struct ablkcipher_request *req;
 };
 
 /*
@@ -61,6 +66,11 @@ struct dm_crypt_io {
 	int error;
 	sector_t sector;
 	struct dm_crypt_io *base_io;
+
+	/* small request on a synchronous cipher, convert without kcryptd */
+	bool inline_crypt;
+	/* position in crypt_config.write_tree */
+	struct rb_node rb_node;
 };
 
 struct dm_crypt_request {
@@ -103,7 +113,9 @@ struct iv_lmk_private {
  * Crypt: maps a linear range of a block device
  * and encrypts / decrypts at the same time.
  */
-enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID };
+enum flags { DM_CRYPT_SUSPENDED, DM_CRYPT_KEY_VALID, DM_CRYPT_SYNC_TFM,
+	     DM_CRYPT_NO_READ_WORKQUEUE, DM_CRYPT_NO_WRITE_WORKQUEUE,
+	     DM_CRYPT_NO_OFFLOAD };
 
 /*
  * Duplicated per-CPU state for cipher.
@@ -135,6 +147,14 @@ struct crypt_config {
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
 
+	/*
+	 * Encrypted writes waiting for submission by write_thread,
+	 * sorted by sector.  Protected by write_thread_wait.lock.
+	 */
+	struct task_struct *write_thread;
+	wait_queue_head_t write_thread_wait;
+	struct rb_root write_tree;
+
 	char *cipher;
 	char *cipher_string;
 
@@ -178,6 +198,9 @@ struct crypt_config {
 #define MIN_IOS        16
 #define MIN_POOL_PAGES 32
 
+/* Largest bio converted inline with no_read/no_write_workqueue */
+#define MAX_INLINE_SIZE PAGE_SIZE
+
 static struct kmem_cache *_crypt_io_pool;
 
 static void clone_init(struct dm_crypt_io *, struct bio *);
@@ -761,6 +784,42 @@ static void crypt_alloc_req(struct crypt_config *cc,
 	    kcryptd_async_done, dmreq_of_req(cc, this_cc->req));
 }
 
+/*
+ * Convert in the context that submitted or completed the bio.  That may
+ * have preempted, or interrupted, a kcryptd worker halfway through using
+ * the per-cpu request, so use the private one in ctx->req instead.  The
+ * cipher is synchronous, so every block is done when crypt_convert_block
+ * returns, and the bio is small enough to do with preemption disabled.
+ */
+static int crypt_convert_inline(struct crypt_config *cc,
+				struct convert_context *ctx)
+{
+	struct ablkcipher_request *req = ctx->req;
+	unsigned key_index;
+	int r = 0;
+
+	atomic_set(&ctx->pending, 1);
+
+	ablkcipher_request_set_callback(req, 0, NULL, NULL);
+
+	preempt_disable();
+	while (ctx->idx_in < ctx->bio_in->bi_vcnt &&
+	       ctx->idx_out < ctx->bio_out->bi_vcnt) {
+		key_index = ctx->sector & (cc->tfms_count - 1);
+		ablkcipher_request_set_tfm(req,
+			this_crypt_config(cc)->tfms[key_index]);
+
+		r = crypt_convert_block(cc, ctx, req);
+		if (r < 0)
+			break;
+
+		ctx->sector++;
+	}
+	preempt_enable();
+
+	return r;
+}
+
 /*
  * Encrypt / decrypt data from one bio to another one (can be the same one)
  */
@@ -770,6 +829,9 @@ static int crypt_convert(struct crypt_config *cc,
 	struct crypt_cpu *this_cc = this_crypt_config(cc);
 	int r;
 
+	if (ctx->req)
+		return crypt_convert_inline(cc, ctx);
+
 	atomic_set(&ctx->pending, 1);
 
 	while(ctx->idx_in < ctx->bio_in->bi_vcnt &&
@@ -885,6 +947,22 @@ static void crypt_free_buffer_pages(struct crypt_config *cc, struct bio *clone)
 	}
 }
 
+/*
+ * Small bios on a synchronous cipher are cheaper to convert right away
+ * than to hand over to kcryptd, if the table asks for it.
+ */
+static bool crypt_can_inline(struct crypt_config *cc, struct bio *bio)
+{
+	if (!test_bit(DM_CRYPT_SYNC_TFM, &cc->flags) ||
+	    bio->bi_size > MAX_INLINE_SIZE)
+		return false;
+
+	if (bio_data_dir(bio) == READ)
+		return test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+
+	return test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+}
+
 static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 					  struct bio *bio, sector_t sector)
 {
@@ -897,6 +975,8 @@ static struct dm_crypt_io *crypt_io_alloc(struct dm_target *ti,
 	io->sector = sector;
 	io->error = 0;
 	io->base_io = NULL;
+	io->ctx.req = NULL;
+	io->inline_crypt = crypt_can_inline(cc, bio);
 	atomic_set(&io->pending, 0);
 
 	return io;
@@ -1045,6 +1125,90 @@ static void kcryptd_queue_io(struct dm_crypt_io *io)
 	queue_work(cc->io_queue, &io->work);
 }
 
+#define crypt_io_from_node(node) rb_entry((node), struct dm_crypt_io, rb_node)
+
+/*
+ * dmcrypt_write submits the encrypted writes in sector order, so that
+ * writes encrypted in parallel by kcryptd on different cpus still reach
+ * the elevator sorted and can be merged.
+ */
+static int dmcrypt_write(void *data)
+{
+	struct crypt_config *cc = data;
+	struct dm_crypt_io *io;
+	struct rb_root write_tree;
+	struct blk_plug plug;
+
+	while (1) {
+		DECLARE_WAITQUEUE(wait, current);
+
+		spin_lock_irq(&cc->write_thread_wait.lock);
+continue_locked:
+		if (!RB_EMPTY_ROOT(&cc->write_tree))
+			goto pop_from_list;
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		__add_wait_queue(&cc->write_thread_wait, &wait);
+
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		if (unlikely(kthread_should_stop())) {
+			set_current_state(TASK_RUNNING);
+			remove_wait_queue(&cc->write_thread_wait, &wait);
+			break;
+		}
+
+		schedule();
+
+		set_current_state(TASK_RUNNING);
+		spin_lock_irq(&cc->write_thread_wait.lock);
+		__remove_wait_queue(&cc->write_thread_wait, &wait);
+		goto continue_locked;
+
+pop_from_list:
+		write_tree = cc->write_tree;
+		cc->write_tree = RB_ROOT;
+		spin_unlock_irq(&cc->write_thread_wait.lock);
+
+		/*
+		 * Don't walk the tree with rb_next: the io may be freed
+		 * as soon as its clone is submitted.
+		 */
+		blk_start_plug(&plug);
+		do {
+			io = crypt_io_from_node(rb_first(&write_tree));
+			rb_erase(&io->rb_node, &write_tree);
+			kcryptd_io_write(io);
+		} while (!RB_EMPTY_ROOT(&write_tree));
+		blk_finish_plug(&plug);
+	}
+
+	return 0;
+}
+
+static void kcryptd_queue_write(struct dm_crypt_io *io)
+{
+	struct crypt_config *cc = io->target->private;
+	struct rb_node **rbp, *parent;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cc->write_thread_wait.lock, flags);
+	rbp = &cc->write_tree.rb_node;
+	parent = NULL;
+	while (*rbp) {
+		parent = *rbp;
+		if (io->sector < crypt_io_from_node(parent)->sector)
+			rbp = &(*rbp)->rb_left;
+		else
+			rbp = &(*rbp)->rb_right;
+	}
+	rb_link_node(&io->rb_node, parent, rbp);
+	rb_insert_color(&io->rb_node, &cc->write_tree);
+
+	wake_up_locked(&cc->write_thread_wait);
+	spin_unlock_irqrestore(&cc->write_thread_wait.lock, flags);
+}
+
 static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 {
 	struct bio *clone = io->ctx.bio_out;
@@ -1062,7 +1226,9 @@ static void kcryptd_crypt_write_io_submit(struct dm_crypt_io *io, int async)
 
 	clone->bi_sector = cc->start + io->sector;
 
-	if (async)
+	if (!test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
+		kcryptd_queue_write(io);
+	else if (async)
 		kcryptd_queue_io(io);
 	else
 		generic_make_request(clone);
@@ -1121,7 +1287,12 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			if (unlikely(r < 0))
 				break;
 
-			io->sector = sector;
+			/*
+			 * An io queued for dmcrypt_write sits in the write
+			 * tree keyed by its sector, so it cannot be reused.
+			 */
+			if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
+				io->sector = sector;
 		}
 
 		/*
@@ -1132,10 +1303,13 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 			congestion_wait(BLK_RW_ASYNC, HZ/100);
 
 		/*
-		 * With async crypto it is unsafe to share the crypto context
-		 * between fragments, so switch to a new dm_crypt_io structure.
+		 * With async crypto, or with the io queued for dmcrypt_write,
+		 * it is unsafe to share the crypto context between fragments,
+		 * so switch to a new dm_crypt_io structure.
 		 */
-		if (unlikely(!crypt_finished && remaining)) {
+		if (unlikely((!crypt_finished ||
+			      !test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) &&
+			     remaining)) {
 			new_io = crypt_io_alloc(io->target, io->base_bio,
 						sector);
 			crypt_inc_pending(new_io);
@@ -1143,6 +1317,7 @@ static void kcryptd_crypt_write_convert(struct dm_crypt_io *io)
 					   io->base_bio, sector);
 			new_io->ctx.idx_in = io->ctx.idx_in;
 			new_io->ctx.offset_in = io->ctx.offset_in;
+			new_io->ctx.req = io->ctx.req;
 
 			/*
 			 * Fragments after the first use the base_io
@@ -1231,8 +1406,26 @@ static void kcryptd_crypt(struct work_struct *work)
 static void kcryptd_queue_crypt(struct dm_crypt_io *io)
 {
 	struct crypt_config *cc = io->target->private;
+	struct ablkcipher_request *req;
 
 	INIT_WORK(&io->work, kcryptd_crypt);
+
+	/*
+	 * Convert small bios right here rather than paying for two context
+	 * switches.  Reads complete in softirq context with most drivers;
+	 * those completing in hard interrupt context still go to kcryptd.
+	 */
+	if (io->inline_crypt && !in_irq() && !irqs_disabled()) {
+		req = mempool_alloc(cc->req_pool,
+				    in_interrupt() ? GFP_ATOMIC : GFP_NOIO);
+		if (likely(req)) {
+			io->ctx.req = req;
+			kcryptd_crypt(&io->work);
+			mempool_free(req, cc->req_pool);
+			return;
+		}
+	}
+
 	queue_work(cc->crypt_queue, &io->work);
 }
 
@@ -1370,6 +1563,9 @@ static void crypt_dtr(struct dm_target *ti)
 	if (!cc)
 		return;
 
+	if (cc->write_thread)
+		kthread_stop(cc->write_thread);
+
 	if (cc->io_queue)
 		destroy_workqueue(cc->io_queue);
 	if (cc->crypt_queue)
@@ -1570,9 +1766,41 @@ bad_mem:
 	return -ENOMEM;
 }
 
+/*
+ * Optional feature arguments:
+ * <#opt_params> <opt_params>...
+ */
+static int crypt_ctr_optional(struct dm_target *ti,
+			      unsigned int argc, char **argv)
+{
+	struct crypt_config *cc = ti->private;
+	unsigned int opt_params, i;
+
+	if (sscanf(argv[0], "%u", &opt_params) != 1 ||
+	    opt_params != argc - 1) {
+		ti->error = "Invalid number of feature args";
+		return -EINVAL;
+	}
+
+	for (i = 1; i <= opt_params; i++) {
+		if (!strcasecmp(argv[i], "no_read_workqueue"))
+			set_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags);
+		else if (!strcasecmp(argv[i], "no_write_workqueue"))
+			set_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags);
+		else if (!strcasecmp(argv[i], "submit_from_crypt_cpus"))
+			set_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+		else {
+			ti->error = "Invalid feature arguments";
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 /*
  * Construct an encryption mapping:
- * <cipher> <key> <iv_offset> <dev_path> <start>
+ * <cipher> <key> <iv_offset> <dev_path> <start> [<#opt_params> <opts>...]
  */
 static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
@@ -1581,7 +1809,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	unsigned long long tmpll;
 	int ret;
 
-	if (argc != 5) {
+	if (argc < 5) {
 		ti->error = "Not enough arguments";
 		return -EINVAL;
 	}
@@ -1600,6 +1828,10 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	if (!(crypto_ablkcipher_tfm(any_tfm(cc))->__crt_alg->cra_flags &
+	      CRYPTO_ALG_ASYNC))
+		set_bit(DM_CRYPT_SYNC_TFM, &cc->flags);
+
 	ret = -ENOMEM;
 	cc->io_pool = mempool_create_slab_pool(MIN_IOS, _crypt_io_pool);
 	if (!cc->io_pool) {
@@ -1650,6 +1882,12 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	}
 	cc->start = tmpll;
 
+	if (argc > 5) {
+		ret = crypt_ctr_optional(ti, argc - 5, &argv[5]);
+		if (ret)
+			goto bad;
+	}
+
 	ret = -ENOMEM;
 	cc->io_queue = alloc_workqueue("kcryptd_io",
 				       WQ_NON_REENTRANT|
@@ -1670,6 +1908,21 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 		goto bad;
 	}
 
+	if (!test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags)) {
+		init_waitqueue_head(&cc->write_thread_wait);
+		cc->write_tree = RB_ROOT;
+
+		cc->write_thread = kthread_create(dmcrypt_write, cc,
+						  "dmcrypt_write");
+		if (IS_ERR(cc->write_thread)) {
+			ret = PTR_ERR(cc->write_thread);
+			cc->write_thread = NULL;
+			ti->error = "Couldn't spawn write thread";
+			goto bad;
+		}
+		wake_up_process(cc->write_thread);
+	}
+
 	ti->num_flush_requests = 1;
 	return 0;
 
@@ -1706,6 +1959,7 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 {
 	struct crypt_config *cc = ti->private;
 	unsigned int sz = 0;
+	int num_feature_args = 0;
 
 	switch (type) {
 	case STATUSTYPE_INFO:
@@ -1729,6 +1983,21 @@ static int crypt_status(struct dm_target *ti, status_type_t type,
 
 		DMEMIT(" %llu %s %llu", (unsigned long long)cc->iv_offset,
 				cc->dev->name, (unsigned long long)cc->start);
+
+		num_feature_args += !!test_bit(DM_CRYPT_NO_READ_WORKQUEUE,
+					       &cc->flags);
+		num_feature_args += !!test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE,
+					       &cc->flags);
+		num_feature_args += !!test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags);
+		if (num_feature_args) {
+			DMEMIT(" %d", num_feature_args);
+			if (test_bit(DM_CRYPT_NO_READ_WORKQUEUE, &cc->flags))
+				DMEMIT(" no_read_workqueue");
+			if (test_bit(DM_CRYPT_NO_WRITE_WORKQUEUE, &cc->flags))
+				DMEMIT(" no_write_workqueue");
+			if (test_bit(DM_CRYPT_NO_OFFLOAD, &cc->flags))
+				DMEMIT(" submit_from_crypt_cpus");
+		}
 		break;
 	}
 	return 0;
@@ -1825,7 +2094,7 @@ static int crypt_iterate_devices(struct dm_target *ti,
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 10, 0},
+	.version = {1, 11, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -42,6 +42,23 @@ struct zram *devices;
 /* Module params (documentation at end) */
 unsigned int num_devices;
 
+const struct zram_comp zram_comps[] = {
+	{ "lzo",	lzo1x_1_compress },
+	{ "lzo-rle",	lzorle1x_1_compress },
+	{ }
+};
+
+const struct zram_comp *zram_find_comp(const char *name)
+{
+	const struct zram_comp *comp;
+
+	for (comp = zram_comps; comp->name; comp++)
+		if (!strcmp(comp->name, name))
+			return comp;
+
+	return NULL;
+}
+
 static void zram_stat_inc(u32 *v)
 {
 	*v = *v + 1;
@@ -319,7 +336,7 @@ static void zram_write(struct zram *zram, struct bio *bio)
 			continue;
 		}
 
-		ret = lzo1x_1_compress(user_mem, PAGE_SIZE, src, &clen,
+		ret = zram->comp->compress(user_mem, PAGE_SIZE, src, &clen,
 					zram->compress_workmem);
 
 		kunmap_atomic(user_mem, KM_USER0);
@@ -633,6 +650,7 @@ static int create_device(struct zram *zram, int device_id)
 		goto out;
 	}
 
+	zram->comp = zram_find_comp(default_compressor);
 	zram->init_done = 0;
 
 out:
@@ -43,6 +43,9 @@ struct zobj_header {
 /* Default zram disk size: 25% of total RAM */
 static const unsigned default_disksize_perc_ram = 25;
 
+/* Default compressor, see zram_comps[] */
+static const char default_compressor[] = "lzo-rle";
+
 /*
  * Pages that compress to size greater than this are stored
  * uncompressed in memory.
@@ -98,8 +101,19 @@ struct zram_stats {
 	u32 pages_expand;	/* % of incompressible pages */
 };
 
+/*
+ * All compressors write streams that lzo1x_decompress_safe() can read,
+ * so only the compression side needs to be selectable.
+ */
+struct zram_comp {
+	const char *name;
+	int (*compress)(const unsigned char *src, size_t src_len,
+			unsigned char *dst, size_t *dst_len, void *wrkmem);
+};
+
 struct zram {
 	struct xv_pool *mem_pool;
+	const struct zram_comp *comp;	/* can only change before init */
 	void *compress_workmem;
 	void *compress_buffer;
 	struct table *table;
@@ -122,11 +136,13 @@ struct zram {
 
 extern struct zram *devices;
 extern unsigned int num_devices;
+extern const struct zram_comp zram_comps[];
 #ifdef CONFIG_SYSFS
 extern struct attribute_group zram_disk_attr_group;
 #endif
 
 extern int zram_init_device(struct zram *zram);
 extern void zram_reset_device(struct zram *zram);
+extern const struct zram_comp *zram_find_comp(const char *name);
 
 #endif
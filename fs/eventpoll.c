@@ -23,6 +23,7 @@
 #include <linux/poll.h>
 #include <linux/string.h>
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <linux/hash.h>
 #include <linux/spinlock.h>
 #include <linux/syscalls.h>
@@ -41,22 +42,23 @@
 
 /*
  * LOCKING:
- * There are three level of locking required by epoll :
+ * There are two level of locking required by epoll :
  *
  * 1) epmutex (mutex)
  * 2) ep->mtx (mutex)
- * 3) ep->lock (spinlock)
  *
- * The acquire order is the one listed above, from 1 to 3.
- * We need a spinlock (ep->lock) because we manipulate objects
- * from inside the poll callback, that might be triggered from
- * a wake_up() that in turn might be called from IRQ context.
- * So we can't sleep inside the poll callback and hence we need
- * a spinlock. During the event transfer loop (from kernel to
- * user space) we could end up sleeping due a copy_to_user(), so
- * we need a lock that will allow us to sleep. This lock is a
- * mutex (ep->mtx). It is acquired during the event transfer loop,
- * during epoll_ctl(EPOLL_CTL_DEL) and during eventpoll_release_file().
+ * The acquire order is the one listed above, from 1 to 2.
+ * The poll callback might be triggered from a wake_up() that in
+ * turn might be called from IRQ context, so it can neither sleep
+ * nor take ep->mtx.  It takes no lock at all: it pushes the item on
+ * the lock-less ep->rdllhead list, and whoever holds ep->mtx moves
+ * such items over to ep->rdllist before looking at it.  ep->rdllist
+ * is thus only ever modified with ep->mtx held.  During the event
+ * transfer loop (from kernel to user space) we could end up sleeping
+ * due a copy_to_user(), so we need a lock that will allow us to
+ * sleep. This lock is a mutex (ep->mtx). It is acquired during the
+ * event transfer loop, during epoll_ctl() and during
+ * eventpoll_release_file().
  * Then we also need a global mutex to serialize eventpoll_release_file()
  * and ep_free().
  * This mutex is acquired by ep_free() during the epoll file
@@ -80,7 +82,7 @@
  * of epoll file descriptors, we use the current recursion depth as
  * the lockdep subkey.
  * It is possible to drop the "ep->mtx" and to use the global
- * mutex "epmutex" (together with "ep->lock") to have it working,
+ * mutex "epmutex" to have it working,
  * but having "ep->mtx" will make the interface more scalable.
  * Events that require holding "epmutex" are very rare, while for
  * normal operations the epoll private "ep->mtx" will guarantee
@@ -95,7 +97,8 @@
 
 #define EP_MAX_EVENTS (INT_MAX / sizeof(struct epoll_event))
 
-#define EP_UNACTIVE_PTR ((void *) -1L)
+/* Bit in epitem->state: the item sits on the ep->rdllhead list */
+#define EPI_QUEUED 0
 
 #define EP_ITEM_COST (sizeof(struct epitem) + sizeof(struct eppoll_entry))
 
@@ -134,11 +137,14 @@ struct epitem {
 	/* List header used to link this structure to the eventpoll ready list */
 	struct list_head rdllink;
 
-	/*
-	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
-	 */
-	struct epitem *next;
+	/* Node used by the poll callback to queue the item on ep->rdllhead */
+	struct llist_node rdllnode;
+
+	/* EPI_QUEUED is set while the item is on ep->rdllhead */
+	unsigned long state;
+
+	/* Events reported by the poll callbacks since the last delivery */
+	unsigned int revents;
 
 	/* The file descriptor information this item refers to */
 	struct epoll_filefd ffd;
@@ -165,9 +171,6 @@ struct epitem {
  * interface.
  */
 struct eventpoll {
-	/* Protect the access to this structure */
-	spinlock_t lock;
-
 	/*
 	 * This mutex is used to ensure that files are not removed
 	 * while epoll is using them. This is held during the event
@@ -182,18 +185,17 @@ struct eventpoll {
 	/* Wait queue used by file->poll() */
 	wait_queue_head_t poll_wait;
 
-	/* List of ready file descriptors */
+	/* List of ready file descriptors, protected by "mtx" */
 	struct list_head rdllist;
 
-	/* RB tree root used to store monitored fd structs */
-	struct rb_root rbr;
-
 	/*
-	 * This is a single linked list that chains all the "struct epitem" that
-	 * happened while transferring ready events to userspace w/out
-	 * holding ->lock.
+	 * Lock-less list the poll callback queues ready items on. They are
+	 * moved to "rdllist" by ep_collect_ready().
 	 */
-	struct epitem *ovflist;
+	struct llist_head rdllhead;
+
+	/* RB tree root used to store monitored fd structs */
+	struct rb_root rbr;
 
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
@@ -360,7 +362,11 @@ static void ep_nested_calls_init(struct nested_calls *ncalls)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
-	return !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
+	/*
+	 * This is a hint only, "rdllist" may be changing under us. Anybody
+	 * who makes events available wakes up the waiters afterwards.
+	 */
+	return !list_empty(&ep->rdllist) || !llist_empty(&ep->rdllhead);
 }
 
 /**
@@ -472,6 +478,51 @@ static void ep_poll_safewake(wait_queue_head_t *wq)
 	put_cpu();
 }
 
+/*
+ * Wake up (if active) both the eventpoll wait list and the ->poll() wait
+ * list, after ready items have been made visible on either ready list.
+ */
+static void ep_wakeup(struct eventpoll *ep)
+{
+	/*
+	 * Order the queueing of the ready item before the waitqueue_active()
+	 * checks. Pairs with set_current_state() in ep_poll().
+	 */
+	smp_mb();
+
+	if (waitqueue_active(&ep->wq))
+		wake_up(&ep->wq);
+	if (waitqueue_active(&ep->poll_wait))
+		ep_poll_safewake(&ep->poll_wait);
+}
+
+/*
+ * Move the items queued by the poll callback on "rdllhead" to the tail of
+ * "rdllist", in the order they were queued. Must be called with "mtx" held
+ * (or "epmutex" if called from ep_free).
+ */
+static void ep_collect_ready(struct eventpoll *ep)
+{
+	struct llist_node *node;
+	struct epitem *epi;
+
+	node = llist_reverse_order(llist_del_all(&ep->rdllhead));
+	while (node) {
+		epi = llist_entry(node, struct epitem, rdllnode);
+		node = node->next;
+
+		if (!ep_is_linked(&epi->rdllink))
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+
+		/*
+		 * Once EPI_QUEUED is clear the poll callback may queue the
+		 * item again, reusing ->rdllnode, so we must be done with it.
+		 */
+		smp_mb__before_clear_bit();
+		clear_bit(EPI_QUEUED, &epi->state);
+	}
+}
+
 static void ep_remove_wait_queue(struct eppoll_entry *pwq)
 {
 	wait_queue_head_t *whead;
@@ -521,9 +572,7 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 			      void *priv,
 			      int depth)
 {
-	int error, pwake = 0;
-	unsigned long flags;
-	struct epitem *epi, *nepi;
+	int error, wake;
 	LIST_HEAD(txlist);
 
 	/*
@@ -533,69 +582,33 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	mutex_lock_nested(&ep->mtx, depth);
 
 	/*
-	 * Steal the ready list, and re-init the original one to the
-	 * empty list. Also, set ep->ovflist to NULL so that events
-	 * happening while looping w/out locks, are not lost. We cannot
-	 * have the poll callback to queue directly on ep->rdllist,
-	 * because we want the "sproc" callback to be able to do it
-	 * in a lockless way.
+	 * Pick up what the poll callback queued so far and steal the ready
+	 * list. Items queued while "sproc" runs stay on ep->rdllhead, where
+	 * the next scan will find them, so "sproc" can walk "txlist" and
+	 * re-add items to ep->rdllist without any lock besides "mtx".
 	 */
-	spin_lock_irqsave(&ep->lock, flags);
+	ep_collect_ready(ep);
 	list_splice_init(&ep->rdllist, &txlist);
-	ep->ovflist = NULL;
-	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/*
 	 * Now call the callback function.
 	 */
 	error = (*sproc)(ep, &txlist, priv);
 
-	spin_lock_irqsave(&ep->lock, flags);
-	/*
-	 * During the time we spent inside the "sproc" callback, some
-	 * other events might have been queued by the poll callback.
-	 * We re-insert them inside the main ready-list here.
-	 */
-	for (nepi = ep->ovflist; (epi = nepi) != NULL;
-	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
-		/*
-		 * We need to check if the item is already in the list.
-		 * During the "sproc" callback execution time, items are
-		 * queued into ->ovflist but the "txlist" might already
-		 * contain them, and the list_splice() below takes care of them.
-		 */
-		if (!ep_is_linked(&epi->rdllink))
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-	}
-	/*
-	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
-	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
-	 */
-	ep->ovflist = EP_UNACTIVE_PTR;
-
 	/*
 	 * Quickly re-inject items left on "txlist".
 	 */
 	list_splice(&txlist, &ep->rdllist);
-
-	if (!list_empty(&ep->rdllist)) {
-		/*
-		 * Wake up (if active) both the eventpoll wait list and
-		 * the ->poll() wait list (delayed after we release the lock).
-		 */
-		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
-		if (waitqueue_active(&ep->poll_wait))
-			pwake++;
-	}
-	spin_unlock_irqrestore(&ep->lock, flags);
+	wake = !list_empty(&ep->rdllist);
 
 	mutex_unlock(&ep->mtx);
 
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&ep->poll_wait);
+	/*
+	 * Items queued by the poll callback in the meantime already woke
+	 * the waiters, but the ones left over on ep->rdllist did not.
+	 */
+	if (wake)
+		ep_wakeup(ep);
 
 	return error;
 }
@@ -606,16 +619,11 @@ static int ep_scan_ready_list(struct eventpoll *ep,
  */
 static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 {
-	unsigned long flags;
 	struct file *file = epi->ffd.file;
 
 	/*
-	 * Removes poll wait queue hooks. We _have_ to do this without holding
-	 * the "ep->lock" otherwise a deadlock might occur. This because of the
-	 * sequence of the lock acquisition. Here we do "ep->lock" then the wait
-	 * queue head lock when unregistering the wait queue. The wakeup callback
-	 * will run by holding the wait queue head lock and will call our callback
-	 * that will try to get "ep->lock".
+	 * Removes poll wait queue hooks. Once this is done the poll callback
+	 * cannot run anymore for this item.
 	 */
 	ep_unregister_pollwait(ep, epi);
 
@@ -627,10 +635,15 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 
 	rb_erase(&epi->rbn, &ep->rbr);
 
-	spin_lock_irqsave(&ep->lock, flags);
+	/*
+	 * The poll callback cannot hit the item anymore, but it may have
+	 * left it on ep->rdllhead, from where only ep_collect_ready() can
+	 * take it off.
+	 */
+	if (test_bit(EPI_QUEUED, &epi->state))
+		ep_collect_ready(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
-	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/* At this point it is safe to free the eventpoll item */
 	kmem_cache_free(epi_cache, epi);
@@ -672,7 +685,7 @@ static void ep_free(struct eventpoll *ep)
 	 * Walks through the whole tree by freeing each "struct epitem". At this
 	 * point we are sure no poll callbacks will be lingering around, and also by
 	 * holding "epmutex" we can be sure that no file cleanup code will hit
-	 * us during this operation. So we can avoid the lock on "ep->lock".
+	 * us during this operation. So we can avoid taking "ep->mtx".
 	 */
 	while ((rbp = rb_first(&ep->rbr)) != NULL) {
 		epi = rb_entry(rbp, struct epitem, rbn);
@@ -709,8 +722,10 @@ static int ep_read_events_proc(struct eventpoll *ep, struct list_head *head,
 			 * Item has been dropped into the ready list by the poll
 			 * callback, but it's not actually ready, as far as
 			 * caller requested events goes. We can remove it here.
+			 * The events the callback saw are stale as well.
 			 */
 			list_del_init(&epi->rdllink);
+			epi->revents = 0;
 		}
 	}
 
@@ -800,13 +815,12 @@ static int ep_alloc(struct eventpoll **pep)
 	if (unlikely(!ep))
 		goto free_uid;
 
-	spin_lock_init(&ep->lock);
 	mutex_init(&ep->mtx);
 	init_waitqueue_head(&ep->wq);
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
+	init_llist_head(&ep->rdllhead);
 	ep->rbr = RB_ROOT;
-	ep->ovflist = EP_UNACTIVE_PTR;
 	ep->user = user;
 
 	*pep = ep;
@@ -854,23 +868,9 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
-	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
-
-	if ((unsigned long)key & POLLFREE) {
-		ep_pwq_from_wait(wait)->whead = NULL;
-		/*
-		 * whead = NULL above can race with ep_remove_wait_queue()
-		 * which can do another remove_wait_queue() after us, so we
-		 * can't use __remove_wait_queue(). whead->lock is held by
-		 * the caller.
-		 */
-		list_del_init(&wait->task_list);
-	}
-
-	spin_lock_irqsave(&ep->lock, flags);
+	unsigned int events = ACCESS_ONCE(epi->event.events);
 
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
@@ -878,8 +878,8 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * EPOLLONESHOT bit that disables the descriptor when an event is received,
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
-	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+	if (!(events & ~EP_PRIVATE_BITS))
+		goto out;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -887,42 +887,43 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * callback. We need to be able to handle both cases here, hence the
 	 * test for "key" != NULL before the event match test.
 	 */
-	if (key && !((unsigned long) key & epi->event.events))
-		goto out_unlock;
+	if (key) {
+		unsigned int old, mask = (unsigned long) key & events;
 
-	/*
-	 * If we are transferring events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happen during that period of time are
-	 * chained in ep->ovflist and requeued later on.
-	 */
-	if (unlikely(ep->ovflist != EP_UNACTIVE_PTR)) {
-		if (epi->next == EP_UNACTIVE_PTR) {
-			epi->next = ep->ovflist;
-			ep->ovflist = epi;
-		}
-		goto out_unlock;
-	}
+		if (!mask)
+			goto out;
 
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+		/* Remember them for ep_send_events_proc() */
+		do {
+			old = ACCESS_ONCE(epi->revents);
+		} while (cmpxchg(&epi->revents, old, old | mask) != old);
+	}
 
 	/*
-	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * Queue the item unless it is already waiting to be collected. This
+	 * is done without any lock, so that wakeups on many files do not
+	 * contend with each other nor with ep_scan_ready_list().
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
-	if (waitqueue_active(&ep->poll_wait))
-		pwake++;
-
-out_unlock:
-	spin_unlock_irqrestore(&ep->lock, flags);
+	if (!test_and_set_bit(EPI_QUEUED, &epi->state)) {
+		llist_add(&epi->rdllnode, &ep->rdllhead);
+		ep_wakeup(ep);
+	}
 
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&ep->poll_wait);
+out:
+	if ((unsigned long)key & POLLFREE) {
+		/*
+		 * whead->lock is held by the caller. We can't use
+		 * __remove_wait_queue() because ep_remove_wait_queue() can
+		 * race with us and do another remove_wait_queue().
+		 */
+		list_del_init(&wait->task_list);
+		/*
+		 * Clear whead last: once ep_remove_wait_queue() sees it NULL
+		 * the item may be freed, so we must be done with it.
+		 */
+		smp_wmb();
+		ep_pwq_from_wait(wait)->whead = NULL;
+	}
 
 	return 1;
 }
@@ -1072,8 +1073,7 @@ static int reverse_path_check(void)
 static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 		     struct file *tfile, int fd)
 {
-	int error, revents, pwake = 0;
-	unsigned long flags;
+	int error, revents;
 	long user_watches;
 	struct epitem *epi;
 	struct ep_pqueue epq;
@@ -1092,7 +1092,8 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	ep_set_ffd(&epi->ffd, tfile, fd);
 	epi->event = *event;
 	epi->nwait = 0;
-	epi->next = EP_UNACTIVE_PTR;
+	epi->state = 0;
+	epi->revents = 0;
 
 	/* Initialize the poll table using the queue callback */
 	epq.epi = epi;
@@ -1132,28 +1133,18 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	if (reverse_path_check())
 		goto error_remove_epi;
 
-	/* We have to drop the new item inside our item list to keep track of it */
-	spin_lock_irqsave(&ep->lock, flags);
+	atomic_long_inc(&ep->user->epoll_watches);
 
-	/* If the file is already "ready" we drop it inside the ready list */
+	/*
+	 * If the file is already "ready" we drop it inside the ready list,
+	 * and notify waiting tasks that events are available. ep->rdllist
+	 * is protected by "mtx", which ep_insert() is called with.
+	 */
 	if ((revents & event->events) && !ep_is_linked(&epi->rdllink)) {
 		list_add_tail(&epi->rdllink, &ep->rdllist);
-
-		/* Notify waiting tasks that events are available */
-		if (waitqueue_active(&ep->wq))
-			wake_up_locked(&ep->wq);
-		if (waitqueue_active(&ep->poll_wait))
-			pwake++;
+		ep_wakeup(ep);
 	}
 
-	spin_unlock_irqrestore(&ep->lock, flags);
-
-	atomic_long_inc(&ep->user->epoll_watches);
-
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&ep->poll_wait);
-
 	return 0;
 
 error_remove_epi:
@@ -1169,14 +1160,12 @@ error_unregister:
 
 	/*
 	 * We need to do this because an event could have been arrived on some
-	 * allocated wait queue. Note that we don't care about the ep->ovflist
-	 * list, since that is used/cleaned only inside a section bound by "mtx".
-	 * And ep_insert() is called with "mtx" held.
+	 * allocated wait queue, and the poll callback queued the item.
 	 */
-	spin_lock_irqsave(&ep->lock, flags);
+	if (test_bit(EPI_QUEUED, &epi->state))
+		ep_collect_ready(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
-	spin_unlock_irqrestore(&ep->lock, flags);
 
 	kmem_cache_free(epi_cache, epi);
 
@@ -1189,7 +1178,6 @@ error_unregister:
  */
 static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_event *event)
 {
-	int pwake = 0;
 	unsigned int revents;
 
 	/*
@@ -1206,9 +1194,8 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 * 1) Flush epi changes above to other CPUs.  This ensures
 	 *    we do not miss events from ep_poll_callback if an
 	 *    event occurs immediately after we call f_op->poll().
-	 *    We need this because we did not take ep->lock while
-	 *    changing epi above (but ep_poll_callback does take
-	 *    ep->lock).
+	 *    We need this because ep_poll_callback reads the
+	 *    event mask without any lock.
 	 *
 	 * 2) We also need to ensure we do not miss _past_ events
 	 *    when calling f_op->poll().  This barrier also
@@ -1220,6 +1207,12 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 */
 	smp_mb();
 
+	/*
+	 * Forget the events the poll callback collected under the old mask,
+	 * the poll below reports the current ones.
+	 */
+	epi->revents = 0;
+
 	/*
 	 * Get current event bits. We can safely use the file* here because
 	 * its usage count has been increased by the caller of this function.
@@ -1230,24 +1223,13 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 * If the item is "hot" and it is not registered inside the ready
 	 * list, push it inside.
 	 */
-	if (revents & event->events) {
-		spin_lock_irq(&ep->lock);
-		if (!ep_is_linked(&epi->rdllink)) {
-			list_add_tail(&epi->rdllink, &ep->rdllist);
+	if ((revents & event->events) && !ep_is_linked(&epi->rdllink)) {
+		list_add_tail(&epi->rdllink, &ep->rdllist);
 
-			/* Notify waiting tasks that events are available */
-			if (waitqueue_active(&ep->wq))
-				wake_up_locked(&ep->wq);
-			if (waitqueue_active(&ep->poll_wait))
-				pwake++;
-		}
-		spin_unlock_irq(&ep->lock);
+		/* Notify waiting tasks that events are available */
+		ep_wakeup(ep);
 	}
 
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&ep->poll_wait);
-
 	return 0;
 }
 
@@ -1271,8 +1253,16 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 
 		list_del_init(&epi->rdllink);
 
-		revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL) &
-			epi->event.events;
+		/*
+		 * A one-shot item is disabled once it is reported, so when
+		 * the poll callback already told us what happened there is
+		 * no need to ask the file again. Everything else has its
+		 * current state polled, which also drops stale wakeups.
+		 */
+		revents = xchg(&epi->revents, 0);
+		if (!revents || !(epi->event.events & EPOLLONESHOT))
+			revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL);
+		revents &= epi->event.events;
 
 		/*
 		 * If the event mask intersect the caller-requested one,
@@ -1284,6 +1274,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 			if (__put_user(revents, &uevent->events) ||
 			    __put_user(epi->event.data, &uevent->data)) {
 				list_add(&epi->rdllink, head);
+				epi->revents = revents;
 				return eventcnt ? eventcnt : -EFAULT;
 			}
 			eventcnt++;
@@ -1300,7 +1291,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 				 * into ep->rdllist besides us. The epoll_ctl()
 				 * callers are locked out by
 				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
+				 * poll callback will queue them in ep->rdllhead.
 				 */
 				list_add_tail(&epi->rdllink, &ep->rdllist);
 			}
@@ -1370,13 +1361,10 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		 * caller specified a non blocking operation.
 		 */
 		timed_out = 1;
-		spin_lock_irqsave(&ep->lock, flags);
 		goto check_events;
 	}
 
 fetch_events:
-	spin_lock_irqsave(&ep->lock, flags);
-
 	if (!ep_events_available(ep)) {
 		/*
 		 * We don't have any available event to return to the caller.
@@ -1384,6 +1372,7 @@ fetch_events:
 		 * ep_poll_callback() when events will become available.
 		 */
 		init_waitqueue_entry(&wait, current);
+		spin_lock_irqsave(&ep->wq.lock, flags);
 		__add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
@@ -1400,13 +1389,14 @@ fetch_events:
 				break;
 			}
 
-			spin_unlock_irqrestore(&ep->lock, flags);
+			spin_unlock_irqrestore(&ep->wq.lock, flags);
 			if (!schedule_hrtimeout_range(to, slack, HRTIMER_MODE_ABS))
 				timed_out = 1;
 
-			spin_lock_irqsave(&ep->lock, flags);
+			spin_lock_irqsave(&ep->wq.lock, flags);
 		}
 		__remove_wait_queue(&ep->wq, &wait);
+		spin_unlock_irqrestore(&ep->wq.lock, flags);
 
 		set_current_state(TASK_RUNNING);
 	}
@@ -1414,8 +1404,6 @@ check_events:
 	/* Is it worth to try to dig for events ? */
 	eavail = ep_events_available(ep);
 
-	spin_unlock_irqrestore(&ep->lock, flags);
-
 	/*
 	 * Try to transfer events to user space. In case we get 0 events and
 	 * there's still timeout left over, we go trying again in search of
@@ -266,6 +266,12 @@ EXPORT_SYMBOL(free_inode_nonrcu);
 void __destroy_inode(struct inode *inode)
 {
 	BUG_ON(inode_has_buffers(inode));
+	/*
+	 * Free the shadow tree, in case the filesystem skipped
+	 * truncate_inode_pages().  Done even with no shadows left: it
+	 * takes tree_lock, which the workingset shrinker may still hold.
+	 */
+	workingset_clear_shadows(&inode->i_data, 0, ~0UL);
 	security_inode_free(inode);
 	fsnotify_inode_delete(inode);
 #ifdef CONFIG_FS_POSIX_ACL
@@ -299,6 +305,9 @@ void address_space_init_once(struct address_space *mapping)
 {
 	memset(mapping, 0, sizeof(*mapping));
 	INIT_RADIX_TREE(&mapping->page_tree, GFP_ATOMIC);
+	INIT_RADIX_TREE(&mapping->shadow_tree,
+			GFP_NOWAIT | __GFP_NOWARN | __GFP_NOMEMALLOC);
+	INIT_LIST_HEAD(&mapping->shadow_lru);
 	spin_lock_init(&mapping->tree_lock);
 	mutex_init(&mapping->i_mmap_mutex);
 	INIT_LIST_HEAD(&mapping->private_list);
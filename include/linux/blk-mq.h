@@ -0,0 +1,152 @@
+#ifndef BLK_MQ_H
+#define BLK_MQ_H
+
+#include <linux/blkdev.h>
+
+struct blk_mq_tags;
+
+/*
+ * Software queue: one per cpu and request_queue.  Requests are staged
+ * here by the submitting cpu and pulled off by the hardware queue the
+ * cpu is mapped to.
+ */
+struct blk_mq_ctx {
+	spinlock_t		lock;
+	struct list_head	rq_list;
+
+	unsigned int		cpu;
+	unsigned int		index_hw;	/* index in hctx->ctxs */
+	struct request_queue	*queue;
+
+	/* incremented at dispatch and completion time */
+	unsigned long		rq_dispatched[2];
+	unsigned long		rq_merged;
+	unsigned long		rq_completed[2];
+} ____cacheline_aligned_in_smp;
+
+/*
+ * Hardware queue: one per submission queue of the device.
+ */
+struct blk_mq_hw_ctx {
+	spinlock_t		lock;		/* protects dispatch */
+	struct list_head	dispatch;	/* requests the driver bounced */
+	unsigned long		state;		/* BLK_MQ_S_* flags */
+	struct delayed_work	delayed_work;	/* async queue runs */
+
+	cpumask_var_t		cpumask;	/* cpus mapped to this queue */
+	unsigned long		flags;		/* BLK_MQ_F_* flags */
+
+	struct request_queue	*queue;
+	unsigned int		queue_num;
+	void			*driver_data;
+
+	unsigned int		nr_ctx;
+	struct blk_mq_ctx	**ctxs;
+	unsigned long		*ctx_map;	/* ctxs with queued requests */
+
+	struct blk_mq_tags	*tags;
+	struct request		**rqs;		/* preallocated, by tag */
+	unsigned int		queue_depth;
+
+	unsigned long		queued;
+	unsigned long		run;
+	int			numa_node;
+};
+
+struct blk_mq_ops;
+
+/*
+ * Registration info handed to blk_mq_init_queue() by a driver.
+ */
+struct blk_mq_reg {
+	struct blk_mq_ops	*ops;
+	unsigned int		nr_hw_queues;
+	unsigned int		queue_depth;	/* tags per hardware queue */
+	unsigned int		cmd_size;	/* per-request driver data */
+	int			numa_node;
+	unsigned int		timeout;	/* in jiffies, 0 for default */
+	unsigned int		flags;		/* BLK_MQ_F_* flags */
+};
+
+typedef int (queue_rq_fn)(struct blk_mq_hw_ctx *, struct request *);
+typedef struct blk_mq_hw_ctx *(map_queue_fn)(struct request_queue *,
+					     const int);
+typedef int (init_hctx_fn)(struct blk_mq_hw_ctx *, void *, unsigned int);
+typedef void (exit_hctx_fn)(struct blk_mq_hw_ctx *, unsigned int);
+
+struct blk_mq_ops {
+	/*
+	 * Queue request: may not sleep, and may be called concurrently
+	 * for one hardware queue from the cpus mapped to it.
+	 */
+	queue_rq_fn		*queue_rq;
+
+	/*
+	 * Map a cpu to a hardware queue, usually blk_mq_map_queue.
+	 */
+	map_queue_fn		*map_queue;
+
+	/*
+	 * Called on request timeout, see enum blk_eh_timer_return.
+	 */
+	rq_timed_out_fn		*timeout;
+
+	/*
+	 * Optional per hardware queue setup and teardown.
+	 */
+	init_hctx_fn		*init_hctx;
+	exit_hctx_fn		*exit_hctx;
+};
+
+enum {
+	BLK_MQ_RQ_QUEUE_OK	= 0,	/* queued fine */
+	BLK_MQ_RQ_QUEUE_BUSY	= 1,	/* requeue IO for later */
+	BLK_MQ_RQ_QUEUE_ERROR	= 2,	/* end IO with error */
+
+	BLK_MQ_F_SHOULD_MERGE	= 1 << 0,
+
+	BLK_MQ_S_STOPPED	= 0,
+
+	BLK_MQ_MAX_DEPTH	= 2048,
+};
+
+struct request_queue *blk_mq_init_queue(struct blk_mq_reg *, void *);
+
+struct blk_mq_hw_ctx *blk_mq_map_queue(struct request_queue *, const int);
+
+struct request *blk_mq_alloc_request(struct request_queue *q, int rw,
+				     gfp_t gfp);
+void blk_mq_free_request(struct request *rq);
+void blk_mq_insert_request(struct request *rq, bool at_head, bool run_queue,
+			   bool async);
+
+void blk_mq_end_io(struct request *rq, int error);
+void blk_mq_complete_request(struct request *rq, int error);
+
+void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx, bool async);
+void blk_mq_run_queues(struct request_queue *q, bool async);
+void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *hctx);
+void blk_mq_start_stopped_hw_queues(struct request_queue *q);
+
+/*
+ * Driver command data is laid out right after the request.
+ */
+static inline void *blk_mq_rq_to_pdu(struct request *rq)
+{
+	return (void *) rq + sizeof(*rq);
+}
+
+static inline struct request *blk_mq_rq_from_pdu(void *pdu)
+{
+	return pdu - sizeof(struct request);
+}
+
+#define queue_for_each_hw_ctx(q, hctx, i)				\
+	for ((i) = 0; (i) < (q)->nr_hw_queues &&			\
+	     ({ hctx = (q)->queue_hw_ctx[i]; 1; }); (i)++)
+
+#define hctx_for_each_ctx(hctx, ctx, i)					\
+	for ((i) = 0; (i) < (hctx)->nr_ctx &&				\
+	     ({ ctx = (hctx)->ctxs[(i)]; 1; }); (i)++)
+
+#endif
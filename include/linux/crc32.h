@@ -11,6 +11,13 @@
 extern u32  crc32_le(u32 crc, unsigned char const *p, size_t len);
 extern u32  crc32_be(u32 crc, unsigned char const *p, size_t len);
 
+/* CRC32c (Castagnoli), reflected like crc32_le() */
+extern u32  __crc32c_le(u32 crc, unsigned char const *p, size_t len);
+
+/* The table driven versions, for architectures overriding the above */
+extern u32  crc32_le_base(u32 crc, unsigned char const *p, size_t len);
+extern u32  __crc32c_le_base(u32 crc, unsigned char const *p, size_t len);
+
 #define crc32(seed, data, length)  crc32_le(seed, (unsigned char const *)(data), length)
 
 /*
@@ -188,6 +188,9 @@ struct gendisk {
 	struct disk_events *ev;
 #ifdef  CONFIG_BLK_DEV_INTEGRITY
 	struct blk_integrity *integrity;
+#endif
+#ifdef CONFIG_BLK_LATENCY_HIST
+	struct disk_latency_hist __percpu *lat_hist;
 #endif
 	int node_id;
 };
@@ -173,6 +173,8 @@ enum  hrtimer_base_type {
  * @nr_events:		Total number of hrtimer interrupt events
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
+ * @nr_coalesced:	Timers expired before their hard expiry because an
+ *			earlier timer's interrupt already woke the cpu
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
  * @clock_base:		array of clock bases for this cpu
  */
@@ -187,6 +189,7 @@ struct hrtimer_cpu_base {
 	unsigned long			nr_events;
 	unsigned long			nr_retries;
 	unsigned long			nr_hangs;
+	unsigned long			nr_coalesced;
 	ktime_t				max_hang_time;
 #endif
 	struct hrtimer_clock_base	clock_base[HRTIMER_MAX_CLOCK_BASES];
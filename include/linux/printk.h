@@ -95,6 +95,8 @@ extern int printk_needs_cpu(int cpu);
 extern void printk_tick(void);
 
 #ifdef CONFIG_PRINTK
+extern const struct file_operations kmsg_fops;
+
 asmlinkage __attribute__ ((format (printf, 1, 0)))
 int vprintk(const char *fmt, va_list args);
 asmlinkage __attribute__ ((format (printf, 1, 2))) __cold
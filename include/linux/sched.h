@@ -992,6 +992,10 @@ struct sched_domain {
 	unsigned int ttwu_wake_remote;
 	unsigned int ttwu_move_affine;
 	unsigned int ttwu_move_balance;
+
+	/* wake_affine() stats */
+	unsigned int ttwu_wake_affine;
+	unsigned int ttwu_wake_affine_failed;
 #endif
 #ifdef CONFIG_SCHED_DEBUG
 	char *name;
@@ -1102,6 +1106,7 @@ struct sched_class {
 	void (*post_schedule) (struct rq *this_rq);
 	void (*task_waking) (struct task_struct *task);
 	void (*task_woken) (struct rq *this_rq, struct task_struct *task);
+	void (*migrate_task_rq) (struct task_struct *p, int next_cpu);
 
 	void (*set_cpus_allowed)(struct task_struct *p,
 				 const struct cpumask *newmask);
@@ -1131,6 +1136,44 @@ struct load_weight {
 	unsigned long weight, inv_weight;
 };
 
+#ifdef CONFIG_SMP
+/*
+ * Decayed runnable average of a scheduling entity, see
+ * __update_entity_runnable_avg() in kernel/sched_fair.c.
+ *
+ * runnable_avg_sum and runnable_avg_period are geometric series of the
+ * time (in ~1us units) spent runnable, resp. spent at all, with each
+ * ~1ms period weighted y times the one after it, y^32 = 1/2.  They are
+ * bounded by 1024/(1-y) and so fit a u32.
+ */
+struct sched_avg {
+	u32			runnable_avg_sum;
+	u32			runnable_avg_period;
+	u64			last_runnable_update;
+	/* blocked: decay_counter of our cfs_rq when we went to sleep */
+	s64			decay_count;
+	/* our share of cfs_rq->runnable_load_avg or ->blocked_load_avg */
+	unsigned long		load_avg_contrib;
+	/* runnable fraction scaled to SCHED_LOAD_SCALE, regardless of weight */
+	unsigned long		util_avg_contrib;
+};
+
+#ifdef CONFIG_CPU_FREQ
+/*
+ * Utilization hook for cpufreq governors.  ->func is called with the
+ * cpu's rq->lock held whenever the scheduler has updated the cpu's
+ * utilization: on fair class enqueue, dequeue and tick.  @util ranges
+ * from 0 to @max.
+ */
+struct update_util_data {
+	void (*func)(struct update_util_data *data, u64 time,
+		     unsigned long util, unsigned long max);
+};
+
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data);
+#endif
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 struct sched_statistics {
 	u64			wait_start;
@@ -1180,6 +1223,10 @@ struct sched_entity {
 
 	u64			nr_migrations;
 
+#ifdef CONFIG_SMP
+	struct sched_avg	avg;
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_statistics statistics;
 #endif
@@ -213,6 +213,7 @@ extern int mod_timer_pending(struct timer_list *timer, unsigned long expires);
 extern int mod_timer_pinned(struct timer_list *timer, unsigned long expires);
 
 extern void set_timer_slack(struct timer_list *time, int slack_hz);
+extern int sysctl_timer_deferrable_slack;
 
 #define TIMER_NOT_PINNED	0
 #define TIMER_PINNED		1
@@ -229,6 +230,12 @@ extern void set_timer_slack(struct timer_list *time, int slack_hz);
  */
 extern unsigned long get_next_timer_interrupt(unsigned long now);
 
+/*
+ * Number of timers that expired in the same jiffy as an earlier one on
+ * @cpu and so did not need a wakeup of their own:
+ */
+extern unsigned long timer_get_nr_batched(int cpu);
+
 /*
  * Timer-statistics info:
  */
@@ -61,6 +61,9 @@
 #include <linux/nsproxy.h>
 #include <linux/ptrace.h>
 #include <linux/hugetlb.h>
+#include <linux/bootmem.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <asm/futex.h>
 
@@ -68,8 +71,6 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
-
 /*
  * Futex flags used to encode options to functions and preserve them across
  * restarts.
@@ -147,9 +148,14 @@ static const struct futex_q futex_q_init = {
 struct futex_hash_bucket {
 	spinlock_t lock;
 	struct plist_head chain;
-};
+#ifdef CONFIG_FUTEX_HASH_STATS
+	unsigned long contended;
+#endif
+} ____cacheline_aligned_in_smp;
+
+static unsigned long __read_mostly futex_hashsize;
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static struct futex_hash_bucket *futex_queues;
 
 /*
  * We hash on the keys returned from get_futex_key (see below).
@@ -159,9 +165,41 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+	return &futex_queues[hash & (futex_hashsize - 1)];
+}
+
+#ifdef CONFIG_FUTEX_HASH_STATS
+/*
+ * Count the acquisitions of a hash bucket lock that had to spin.  The
+ * counter is only modified with the lock held.
+ */
+static inline void hb_lock(struct futex_hash_bucket *hb)
+{
+	if (!spin_trylock(&hb->lock)) {
+		spin_lock(&hb->lock);
+		hb->contended++;
+	}
+}
+
+static inline void hb_lock_nested(struct futex_hash_bucket *hb)
+{
+	if (!spin_trylock(&hb->lock)) {
+		spin_lock_nested(&hb->lock, SINGLE_DEPTH_NESTING);
+		hb->contended++;
+	}
+}
+#else
+static inline void hb_lock(struct futex_hash_bucket *hb)
+{
+	spin_lock(&hb->lock);
 }
 
+static inline void hb_lock_nested(struct futex_hash_bucket *hb)
+{
+	spin_lock_nested(&hb->lock, SINGLE_DEPTH_NESTING);
+}
+#endif
+
 /*
  * Return 1 if two futex_keys are equal, 0 otherwise.
  */
@@ -561,7 +599,7 @@ void exit_pi_state_list(struct task_struct *curr)
 		hb = hash_futex(&key);
 		raw_spin_unlock_irq(&curr->pi_lock);
 
-		spin_lock(&hb->lock);
+		hb_lock(hb);
 
 		raw_spin_lock_irq(&curr->pi_lock);
 		/*
@@ -957,12 +995,12 @@ static inline void
 double_lock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 {
 	if (hb1 <= hb2) {
-		spin_lock(&hb1->lock);
+		hb_lock(hb1);
 		if (hb1 < hb2)
-			spin_lock_nested(&hb2->lock, SINGLE_DEPTH_NESTING);
+			hb_lock_nested(hb2);
 	} else { /* hb1 > hb2 */
-		spin_lock(&hb2->lock);
-		spin_lock_nested(&hb1->lock, SINGLE_DEPTH_NESTING);
+		hb_lock(hb2);
+		hb_lock_nested(hb1);
 	}
 }
 
@@ -994,7 +1032,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	head = &hb->chain;
 
 	plist_for_each_entry_safe(this, next, head, list) {
@@ -1501,7 +1539,7 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	hb = hash_futex(&q->key);
 	q->lock_ptr = &hb->lock;
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	return hb;
 }
 
@@ -2144,7 +2182,7 @@ retry:
 		goto out;
 
 	hb = hash_futex(&key);
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 
 	/*
 	 * To avoid races, try to do the TID -> 0 atomic transition
@@ -2359,7 +2397,7 @@ static int futex_wait_requeue_pi(u32 __user *uaddr, unsigned int flags,
 	/* Queue the futex_q, drop the hb lock, wait for wakeup. */
 	futex_wait_queue_me(hb, &q, to);
 
-	spin_lock(&hb->lock);
+	hb_lock(hb);
 	ret = handle_early_requeue_pi_wakeup(hb, &q, &key2, to);
 	spin_unlock(&hb->lock);
 	if (ret)
@@ -2765,10 +2803,67 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 	return do_futex(uaddr, op, val, tp, uaddr2, val2, val3);
 }
 
+#ifdef CONFIG_FUTEX_HASH_STATS
+static int futex_hash_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long i, total = 0;
+
+	seq_printf(m, "buckets: %lu\n", futex_hashsize);
+	for (i = 0; i < futex_hashsize; i++)
+		total += futex_queues[i].contended;
+	seq_printf(m, "contended: %lu\n", total);
+
+	for (i = 0; i < futex_hashsize; i++) {
+		if (futex_queues[i].contended)
+			seq_printf(m, "%6lu %lu\n", i,
+				   futex_queues[i].contended);
+	}
+	return 0;
+}
+
+static int futex_hash_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, futex_hash_stats_show, NULL);
+}
+
+static const struct file_operations futex_hash_stats_fops = {
+	.open		= futex_hash_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void __init futex_hash_stats_init(void)
+{
+	debugfs_create_file("futex_hash", S_IRUSR, NULL, NULL,
+			    &futex_hash_stats_fops);
+}
+#else
+static inline void futex_hash_stats_init(void) { }
+#endif
+
 static int __init futex_init(void)
 {
+	unsigned int futex_shift;
+	unsigned long limit;
 	u32 curval;
-	int i;
+	unsigned long i;
+
+#if CONFIG_BASE_SMALL
+	futex_hashsize = 16;
+#else
+	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+#endif
+	/*
+	 * Keep the table to at most one bucket per 64k of memory, but
+	 * never go below the 256 buckets of the old static table.
+	 */
+	limit = max(256UL, totalram_pages >> (16 - PAGE_SHIFT));
+
+	futex_queues = alloc_large_system_hash("futex", sizeof(*futex_queues),
+					       futex_hashsize, 0, 0,
+					       &futex_shift, NULL, limit);
+	futex_hashsize = 1UL << futex_shift;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2783,11 +2878,13 @@ static int __init futex_init(void)
 	if (cmpxchg_futex_value_locked(&curval, NULL, 0, 0) == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	for (i = 0; i < futex_hashsize; i++) {
 		plist_head_init(&futex_queues[i].chain);
 		spin_lock_init(&futex_queues[i].lock);
 	}
 
+	futex_hash_stats_init();
+
 	return 0;
 }
 __initcall(futex_init);
@@ -1324,6 +1324,13 @@ retry:
 				break;
 			}
 
+			/*
+			 * Still inside its slack range: this timer would
+			 * have needed an interrupt of its own later on.
+			 */
+			if (basenow.tv64 < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_coalesced++;
+
 			__run_hrtimer(timer, &basenow);
 		}
 	}
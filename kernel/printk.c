@@ -41,6 +41,9 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
+#include <linux/poll.h>
+#include <linux/uio.h>
 
 #include <asm/uaccess.h>
 
@@ -100,9 +103,9 @@ EXPORT_SYMBOL_GPL(console_drivers);
 static int console_locked, console_suspended;
 
 /*
- * logbuf_lock protects log_buf, log_start, log_end, con_start and logged_chars
- * It is also used in interesting ways to provide interlocking in
- * console_unlock();.
+ * logbuf_lock protects log_buf, log_start, log_end, con_start, logged_chars
+ * and the record index.  It is also used in interesting ways to provide
+ * interlocking in console_unlock();.
  */
 static DEFINE_SPINLOCK(logbuf_lock);
 
@@ -146,6 +149,21 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/*
+ * Once running, printk_kthread writes to the consoles on behalf of
+ * printk(), which then only copies its message into log_buf and leaves.
+ * Booting with printk.synchronous=1 keeps the old behaviour.
+ */
+static struct task_struct *printk_kthread;
+static int printk_sync;
+module_param_named(synchronous, printk_sync, bool, S_IRUGO | S_IWUSR);
+
+/* work for the next tick of a cpu, see printk_tick() */
+#define PRINTK_PENDING_WAKEUP	0x01
+#define PRINTK_PENDING_CONSOLE	0x02
+
+static DEFINE_PER_CPU(int, printk_pending);
+
 #ifdef CONFIG_PRINTK
 
 static char __log_buf[__LOG_BUF_LEN];
@@ -154,6 +172,67 @@ static int log_buf_len = __LOG_BUF_LEN;
 static unsigned logged_chars; /* Number of chars produced since last read+clear operation */
 static int saved_console_loglevel = -1;
 
+/*
+ * Every line in log_buf is also indexed as a record, numbered by a
+ * sequence number that never goes backwards, so that /dev/kmsg readers
+ * can follow the log line by line without re-reading it.  Records whose
+ * text has since been overwritten in log_buf are skipped.  The index
+ * has room for lines of 64 characters on average, prefix included.
+ */
+struct log_rec {
+	u64 ts_nsec;		/* cpu_clock() when the line was started */
+	unsigned start;		/* index into log_buf of the text */
+	unsigned short len;	/* length of the text, without the newline */
+	unsigned short prefix;	/* syslog facility and level */
+};
+
+#define LOG_REC_NR	(__LOG_BUF_LEN >> 6)
+#define LOG_REC(seq)	(&log_recs[(seq) & (LOG_REC_NR - 1)])
+
+static struct log_rec log_recs[LOG_REC_NR];
+static u64 log_first_seq;	/* oldest record that may still be valid */
+static u64 log_next_seq;	/* the line being written, once complete */
+
+/* longest message a single printk() call can log */
+#define PRINTK_BUF_LEN	1024
+
+static void log_rec_begin(unsigned short prefix, u64 ts_nsec)
+{
+	struct log_rec *rec = LOG_REC(log_next_seq);
+
+	/* the slot of the oldest record is about to be reused */
+	if (log_next_seq - log_first_seq >= LOG_REC_NR - 1)
+		log_first_seq = log_next_seq - (LOG_REC_NR - 1);
+
+	rec->ts_nsec = ts_nsec;
+	rec->start = log_end;
+	rec->len = 0;
+	rec->prefix = prefix;
+}
+
+static void log_rec_end(void)
+{
+	struct log_rec *rec = LOG_REC(log_next_seq);
+
+	rec->len = min_t(unsigned, log_end - rec->start, USHRT_MAX);
+	log_next_seq++;
+}
+
+static int log_rec_valid(struct log_rec *rec)
+{
+	return log_end - rec->start <= log_buf_len;
+}
+
+/* The oldest record whose text is still in log_buf */
+static u64 log_oldest_seq(void)
+{
+	u64 seq = log_first_seq;
+
+	while (seq != log_next_seq && !log_rec_valid(LOG_REC(seq)))
+		seq++;
+	return seq;
+}
+
 #ifdef CONFIG_KEXEC
 /*
  * This appends the listed symbols to /proc/vmcoreinfo
@@ -234,6 +313,8 @@ void __init setup_log_buf(int early)
 	log_start -= offset;
 	con_start -= offset;
 	log_end -= offset;
+	for (dest_idx = 0; dest_idx < LOG_REC_NR; dest_idx++)
+		log_recs[dest_idx].start -= offset;
 	spin_unlock_irqrestore(&logbuf_lock, flags);
 
 	pr_info("log_buf_len: %d\n", log_buf_len);
@@ -555,6 +636,229 @@ void kdb_syslog_data(char *syslog_data[4])
 }
 #endif	/* CONFIG_KGDB_KDB */
 
+/*
+ * /dev/kmsg: writes are logged like printk(), reads return one record
+ * per call, formatted as
+ *
+ *	<prefix>,<sequence>,<timestamp in usecs>,-;<text>\n
+ *
+ * A reader that falls behind by more than the buffer holds gets -EPIPE
+ * once and continues with the oldest record still around.  Seeking to
+ * the start or the end of the file moves to the oldest or past the
+ * newest record.
+ */
+static ssize_t devkmsg_writev(struct kiocb *iocb, const struct iovec *iv,
+			      unsigned long count, loff_t pos)
+{
+	char *line, *p;
+	int i;
+	ssize_t ret = -EFAULT;
+	size_t len = iov_length(iv, count);
+
+	line = kmalloc(len + 1, GFP_KERNEL);
+	if (line == NULL)
+		return -ENOMEM;
+
+	/*
+	 * copy all vectors into a single string, to ensure we do
+	 * not interleave our log line with other printk calls
+	 */
+	p = line;
+	for (i = 0; i < count; i++) {
+		if (copy_from_user(p, iv[i].iov_base, iv[i].iov_len))
+			goto out;
+		p += iv[i].iov_len;
+	}
+	p[0] = '\0';
+
+	ret = printk("%s", line);
+	/* printk can add a prefix */
+	if (ret > len)
+		ret = len;
+out:
+	kfree(line);
+	return ret;
+}
+
+#define DEVKMSG_LINE_MAX	(PRINTK_BUF_LEN + 64)
+
+struct devkmsg_user {
+	u64 seq;
+	struct mutex lock;
+	char buf[DEVKMSG_LINE_MAX];
+};
+
+/* Called with logbuf_lock held */
+static size_t log_rec_format(struct log_rec *rec, u64 seq,
+			     char *buf, size_t size)
+{
+	unsigned long long ts = rec->ts_nsec;
+	size_t len;
+	unsigned i;
+
+	do_div(ts, 1000);
+	len = scnprintf(buf, size, "%u,%llu,%llu,-;",
+			rec->prefix, seq, ts);
+	for (i = 0; i < rec->len && len < size - 1; i++)
+		buf[len++] = LOG_BUF(rec->start + i);
+	buf[len++] = '\n';
+	return len;
+}
+
+static ssize_t devkmsg_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct devkmsg_user *user = file->private_data;
+	size_t len;
+	ssize_t ret;
+
+	if (!user)
+		return -EBADF;
+
+	ret = mutex_lock_interruptible(&user->lock);
+	if (ret)
+		return ret;
+
+	spin_lock_irq(&logbuf_lock);
+	while (user->seq == log_next_seq) {
+		if (file->f_flags & O_NONBLOCK) {
+			ret = -EAGAIN;
+			spin_unlock_irq(&logbuf_lock);
+			goto out;
+		}
+
+		spin_unlock_irq(&logbuf_lock);
+		ret = wait_event_interruptible(log_wait,
+					       user->seq != log_next_seq);
+		if (ret)
+			goto out;
+		spin_lock_irq(&logbuf_lock);
+	}
+
+	if (user->seq < log_first_seq || !log_rec_valid(LOG_REC(user->seq))) {
+		/* our next record is gone, tell the reader once */
+		user->seq = log_oldest_seq();
+		ret = -EPIPE;
+		spin_unlock_irq(&logbuf_lock);
+		goto out;
+	}
+
+	len = log_rec_format(LOG_REC(user->seq), user->seq,
+			     user->buf, sizeof(user->buf));
+	spin_unlock_irq(&logbuf_lock);
+
+	if (len > count) {
+		ret = -EINVAL;
+		goto out;
+	}
+	if (copy_to_user(buf, user->buf, len)) {
+		ret = -EFAULT;
+		goto out;
+	}
+	user->seq++;
+	ret = len;
+out:
+	mutex_unlock(&user->lock);
+	return ret;
+}
+
+static loff_t devkmsg_llseek(struct file *file, loff_t offset, int whence)
+{
+	struct devkmsg_user *user = file->private_data;
+	loff_t ret = 0;
+
+	if (!user)
+		return -EBADF;
+	if (offset)
+		return -ESPIPE;
+
+	spin_lock_irq(&logbuf_lock);
+	switch (whence) {
+	case SEEK_SET:
+		user->seq = log_oldest_seq();
+		break;
+	case SEEK_END:
+		user->seq = log_next_seq;
+		break;
+	default:
+		ret = -EINVAL;
+	}
+	spin_unlock_irq(&logbuf_lock);
+	return ret;
+}
+
+static unsigned int devkmsg_poll(struct file *file, poll_table *wait)
+{
+	struct devkmsg_user *user = file->private_data;
+	unsigned int ret = 0;
+
+	if (!user)
+		return POLLERR|POLLNVAL;
+
+	poll_wait(file, &log_wait, wait);
+
+	spin_lock_irq(&logbuf_lock);
+	if (user->seq != log_next_seq) {
+		ret = POLLIN|POLLRDNORM;
+		if (user->seq < log_first_seq)
+			ret |= POLLERR|POLLPRI;
+	}
+	spin_unlock_irq(&logbuf_lock);
+
+	return ret;
+}
+
+static int devkmsg_open(struct inode *inode, struct file *file)
+{
+	struct devkmsg_user *user;
+	int err;
+
+	/* write-only does not need any file context */
+	if ((file->f_flags & O_ACCMODE) == O_WRONLY)
+		return 0;
+
+	err = check_syslog_permissions(SYSLOG_ACTION_READ_ALL, false);
+	if (err)
+		return err;
+	err = security_syslog(SYSLOG_ACTION_READ_ALL);
+	if (err)
+		return err;
+
+	user = kmalloc(sizeof(struct devkmsg_user), GFP_KERNEL);
+	if (!user)
+		return -ENOMEM;
+
+	mutex_init(&user->lock);
+
+	spin_lock_irq(&logbuf_lock);
+	user->seq = log_oldest_seq();
+	spin_unlock_irq(&logbuf_lock);
+
+	file->private_data = user;
+	return 0;
+}
+
+static int devkmsg_release(struct inode *inode, struct file *file)
+{
+	struct devkmsg_user *user = file->private_data;
+
+	if (!user)
+		return 0;
+
+	mutex_destroy(&user->lock);
+	kfree(user);
+	return 0;
+}
+
+const struct file_operations kmsg_fops = {
+	.open = devkmsg_open,
+	.read = devkmsg_read,
+	.aio_write = devkmsg_writev,
+	.llseek = devkmsg_llseek,
+	.poll = devkmsg_poll,
+	.release = devkmsg_release,
+};
+
 /*
  * Call the console drivers on a range of log_buf
  */
@@ -725,6 +1029,8 @@ static void call_console_drivers(unsigned start, unsigned end)
 
 static void emit_log_char(char c)
 {
+	if (c == '\n')
+		log_rec_end();
 	LOG_BUF(log_end) = c;
 	log_end++;
 	if (log_end - log_start > log_buf_len)
@@ -871,7 +1177,13 @@ static const char recursion_bug_msg [] =
 		KERN_CRIT "BUG: recent printk recursion!\n";
 static int recursion_bug;
 static int new_text_line = 1;
-static char printk_buf[1024];
+
+/*
+ * Messages are formatted into a buffer of the printing cpu, so that
+ * logbuf_lock is only held to copy them into log_buf.
+ */
+static DEFINE_PER_CPU(char, printk_buf[PRINTK_BUF_LEN]);
+static DEFINE_PER_CPU(int, printk_formatting);
 
 int printk_delay_msec __read_mostly;
 
@@ -887,61 +1199,19 @@ static inline void printk_delay(void)
 	}
 }
 
-asmlinkage int vprintk(const char *fmt, va_list args)
+/*
+ * Copy a formatted message into log_buf, adding the log level and time
+ * stamp prefixes to each line.  Called with logbuf_lock held.
+ */
+static int log_store(const char *text)
 {
 	int printed_len = 0;
 	int current_log_level = default_message_loglevel;
-	unsigned long flags;
-	int this_cpu;
-	char *p;
+	unsigned short rec_prefix;
+	const char *p = text;
 	size_t plen;
 	char special;
 
-	boot_delay_msec();
-	printk_delay();
-
-	preempt_disable();
-	/* This stops the holder of console_sem just where we want him */
-	raw_local_irq_save(flags);
-	this_cpu = smp_processor_id();
-
-	/*
-	 * Ouch, printk recursed into itself!
-	 */
-	if (unlikely(printk_cpu == this_cpu)) {
-		/*
-		 * If a crash is occurring during printk() on this CPU,
-		 * then try to get the crash message out but make sure
-		 * we can't deadlock. Otherwise just return to avoid the
-		 * recursion and return - but flag the recursion so that
-		 * it can be printed at the next appropriate moment:
-		 */
-		if (!oops_in_progress) {
-			recursion_bug = 1;
-			goto out_restore_irqs;
-		}
-		zap_locks();
-	}
-
-	lockdep_off();
-	spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
-
-	if (recursion_bug) {
-		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
-		printed_len = strlen(recursion_bug_msg);
-	}
-	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
-
-#ifdef	CONFIG_DEBUG_LL
-	printascii(printk_buf);
-#endif
-
-	p = printk_buf;
-
 	/* Read log level and handle special printk prefix */
 	plen = log_prefix(p, &current_log_level, &special);
 	if (plen) {
@@ -961,12 +1231,18 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		}
 	}
 
+	/* the record keeps the facility a caller may have passed */
+	rec_prefix = plen ? simple_strtoul(text + 1, NULL, 10) :
+			    current_log_level;
+
 	/*
 	 * Copy the output into log_buf. If the caller didn't provide
 	 * the appropriate log prefix, we insert them here
 	 */
 	for (; *p; p++) {
 		if (new_text_line) {
+			unsigned long long t;
+
 			new_text_line = 0;
 
 			if (plen) {
@@ -974,7 +1250,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				int i;
 
 				for (i = 0; i < plen; i++)
-					emit_log_char(printk_buf[i]);
+					emit_log_char(text[i]);
 				printed_len += plen;
 			} else {
 				/* Add log prefix */
@@ -984,17 +1260,17 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				printed_len += 3;
 			}
 
+			t = cpu_clock(printk_cpu);
 			if (printk_time) {
 				/* Add the current time stamp */
 				char tbuf[50], *tp;
 				unsigned tlen;
-				unsigned long long t;
+				unsigned long long ts = t;
 				unsigned long nanosec_rem;
 
-				t = cpu_clock(printk_cpu);
-				nanosec_rem = do_div(t, 1000000000);
+				nanosec_rem = do_div(ts, 1000000000);
 				tlen = sprintf(tbuf, "[%5lu.%06lu] ",
-						(unsigned long) t,
+						(unsigned long) ts,
 						nanosec_rem / 1000);
 
 				for (tp = tbuf; tp < tbuf + tlen; tp++)
@@ -1002,6 +1278,8 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				printed_len += tlen;
 			}
 
+			log_rec_begin(rec_prefix, t);
+
 			if (!*p)
 				break;
 		}
@@ -1011,6 +1289,81 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 			new_text_line = 1;
 	}
 
+	return printed_len;
+}
+
+asmlinkage int vprintk(const char *fmt, va_list args)
+{
+	int printed_len = 0;
+	unsigned long flags;
+	int this_cpu;
+	char *buf;
+	u64 seq;
+
+	boot_delay_msec();
+	printk_delay();
+
+	preempt_disable();
+	/* This stops the holder of console_sem just where we want him */
+	raw_local_irq_save(flags);
+	this_cpu = smp_processor_id();
+
+	/*
+	 * Ouch, printk recursed into itself!
+	 */
+	if (unlikely(printk_cpu == this_cpu ||
+		     __this_cpu_read(printk_formatting))) {
+		/*
+		 * If a crash is occurring during printk() on this CPU,
+		 * then try to get the crash message out but make sure
+		 * we can't deadlock. Otherwise just return to avoid the
+		 * recursion and return - but flag the recursion so that
+		 * it can be printed at the next appropriate moment:
+		 */
+		if (!oops_in_progress) {
+			recursion_bug = 1;
+			goto out_restore_irqs;
+		}
+		zap_locks();
+	}
+
+	/* Emit the output into the buffer of this cpu */
+	__this_cpu_write(printk_formatting, 1);
+	buf = __get_cpu_var(printk_buf);
+	vscnprintf(buf, PRINTK_BUF_LEN, fmt, args);
+	__this_cpu_write(printk_formatting, 0);
+
+#ifdef	CONFIG_DEBUG_LL
+	printascii(buf);
+#endif
+
+	lockdep_off();
+	spin_lock(&logbuf_lock);
+	printk_cpu = this_cpu;
+	seq = log_next_seq;
+
+	if (recursion_bug) {
+		recursion_bug = 0;
+		printed_len += log_store(recursion_bug_msg);
+	}
+	printed_len += log_store(buf);
+
+	if (log_next_seq != seq)
+		wake_up_klogd();
+
+	/*
+	 * Once the console thread runs, leave the console drivers to it
+	 * and have the next tick wake it, unless we may not live to see
+	 * that tick.
+	 */
+	if (printk_kthread && !printk_sync && !oops_in_progress &&
+	    system_state == SYSTEM_RUNNING) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		__this_cpu_or(printk_pending, PRINTK_PENDING_CONSOLE);
+		goto out_lockdep;
+	}
+
 	/*
 	 * Try to acquire and then immediately release the
 	 * console semaphore. The release will do all the
@@ -1024,6 +1377,7 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
+out_lockdep:
 	lockdep_on();
 out_restore_irqs:
 	raw_local_irq_restore(flags);
@@ -1268,13 +1622,15 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
-		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		int pending = __this_cpu_xchg(printk_pending, 0);
+
+		if (pending & PRINTK_PENDING_CONSOLE)
+			wake_up_process(printk_kthread);
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
 	}
 }
 
@@ -1288,7 +1644,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1345,6 +1701,29 @@ void console_unlock(void)
 }
 EXPORT_SYMBOL(console_unlock);
 
+static int console_output_pending(void)
+{
+	return con_start != log_end && !console_suspended;
+}
+
+/*
+ * Write out what printk() left in log_buf.  Sleeps while the consoles
+ * are suspended: resume_console() flushes them itself.
+ */
+static int printk_kthread_func(void *unused)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!console_output_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		console_lock();
+		console_unlock();
+	}
+	return 0;
+}
+
 /**
  * console_conditional_schedule - yield the CPU if required
  *
@@ -1649,6 +2028,7 @@ EXPORT_SYMBOL(unregister_console);
 static int __init printk_late_init(void)
 {
 	struct console *con;
+	struct task_struct *thread;
 
 	for_each_console(con) {
 		if (!keep_bootcon && con->flags & CON_BOOT) {
@@ -1658,6 +2038,12 @@ static int __init printk_late_init(void)
 		}
 	}
 	hotcpu_notifier(console_cpu_notify, 0);
+
+	thread = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(thread))
+		printk(KERN_ERR "printk: unable to start console thread\n");
+	else
+		printk_kthread = thread;
 	return 0;
 }
 late_initcall(printk_late_init);
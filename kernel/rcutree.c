@@ -1192,6 +1192,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 {
 	unsigned long flags;
 	struct rcu_head *next, *list, **tail;
+	long offloaded;
 	int count;
 
 	/* If no callbacks are ready, just return.*/
@@ -1212,6 +1213,11 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 			rdp->nxttail[count] = &rdp->nxtlist;
 	local_irq_restore(flags);
 
+	/* Leave them to this CPU's rcuo kthread if it has one. */
+	offloaded = rcu_nocb_enqueue(rdp, list, tail);
+	if (offloaded)
+		list = NULL;
+
 	/* Invoke callbacks. */
 	count = 0;
 	while (list) {
@@ -1227,7 +1233,7 @@ static void rcu_do_batch(struct rcu_state *rsp, struct rcu_data *rdp)
 	local_irq_save(flags);
 
 	/* Update count, and requeue any remaining callbacks. */
-	rdp->qlen -= count;
+	rdp->qlen -= count + offloaded;
 	rdp->n_cbs_invoked += count;
 	if (list != NULL) {
 		*tail = rdp->nxtlist;
@@ -1531,6 +1537,7 @@ __call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *rcu),
 	*rdp->nxttail[RCU_NEXT_TAIL] = head;
 	rdp->nxttail[RCU_NEXT_TAIL] = &head->next;
 	rdp->qlen++;
+	rdp->n_cbs_queued++;
 
 	/* If interrupts were disabled, don't dive into RCU core. */
 	if (irqs_disabled_flags(flags)) {
@@ -1805,6 +1812,7 @@ static void _rcu_barrier(struct rcu_state *rsp,
 	if (atomic_dec_and_test(&rcu_barrier_cpu_count))
 		complete(&rcu_barrier_completion);
 	wait_for_completion(&rcu_barrier_completion);
+	rcu_nocb_barrier(rsp);
 	mutex_unlock(&rcu_barrier_mutex);
 }
 
@@ -1848,6 +1856,7 @@ rcu_boot_init_percpu_data(int cpu, struct rcu_state *rsp)
 	rdp->dynticks = &per_cpu(rcu_dynticks, cpu);
 #endif /* #ifdef CONFIG_NO_HZ */
 	rdp->cpu = cpu;
+	rcu_boot_init_nocb_percpu_data(rdp);
 	raw_spin_unlock_irqrestore(&rnp->lock, flags);
 }
 
@@ -267,6 +267,7 @@ struct rcu_data {
 	long		qlen;		/* # of queued callbacks */
 	long		qlen_last_fqs_check;
 					/* qlen at last check for QS forcing */
+	unsigned long	n_cbs_queued;	/* count of RCU cbs queued. */
 	unsigned long	n_cbs_invoked;	/* count of RCU cbs invoked. */
 	unsigned long   n_cbs_orphaned; /* RCU cbs orphaned by dying CPU */
 	unsigned long   n_cbs_adopted;  /* RCU cbs adopted from dying CPU */
@@ -298,6 +299,15 @@ struct rcu_data {
 	unsigned long n_rp_need_fqs;
 	unsigned long n_rp_need_nothing;
 
+#ifdef CONFIG_RCU_NOCB_CPU
+	/* 6) Callbacks handed off to this CPU's rcuo kthread. */
+	struct rcu_head *nocb_head;	/* CBs waiting for the kthread. */
+	struct rcu_head **nocb_tail;
+	spinlock_t nocb_lock;		/* Protects the two above. */
+	unsigned long n_nocb_queued;	/* CBs handed to the kthread. */
+	unsigned long n_nocb_invoked;	/* CBs invoked by the kthread. */
+#endif /* #ifdef CONFIG_RCU_NOCB_CPU */
+
 	int cpu;
 };
 
@@ -466,5 +476,9 @@ static void rcu_yield(void (*f)(unsigned long), unsigned long arg);
 #endif /* #ifdef CONFIG_RCU_BOOST */
 static void rcu_cpu_kthread_setrt(int cpu, int to_rt);
 static void __cpuinit rcu_prepare_kthreads(int cpu);
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp);
+static long rcu_nocb_enqueue(struct rcu_data *rdp, struct rcu_head *list,
+			     struct rcu_head **tail);
+static void rcu_nocb_barrier(struct rcu_state *rsp);
 
 #endif /* #ifndef RCU_TREE_NONCORE */
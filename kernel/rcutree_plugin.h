@@ -2008,3 +2008,197 @@ static void rcu_needs_cpu_flush(void)
 }
 
 #endif /* #else #if !defined(CONFIG_RCU_FAST_NO_HZ) */
+
+#ifdef CONFIG_RCU_NOCB_CPU
+
+/*
+ * Offload callback invocation from the CPUs listed in the rcu_nocbs=
+ * boot parameter.  Such a CPU still takes part in grace periods and
+ * still moves its callbacks through ->nxtlist, but rcu_do_batch() hands
+ * the ones that are done over to a per-CPU "rcuo" kthread instead of
+ * invoking them from softirq.  The kthreads are not bound to their CPU,
+ * so the scheduler, taskset and chrt decide where and how urgently the
+ * callbacks run.
+ */
+static cpumask_var_t rcu_nocb_mask;
+static bool have_rcu_nocb_mask;
+
+static DEFINE_PER_CPU(struct task_struct *, rcu_nocb_kthread_task);
+static DEFINE_PER_CPU(wait_queue_head_t, rcu_nocb_wq);
+
+/* The flavors whose callbacks the rcuo kthreads invoke. */
+static struct rcu_state *const rcu_nocb_states[] = {
+	&rcu_sched_state,
+	&rcu_bh_state,
+#ifdef CONFIG_TREE_PREEMPT_RCU
+	&rcu_preempt_state,
+#endif /* #ifdef CONFIG_TREE_PREEMPT_RCU */
+};
+
+static int __init rcu_nocb_setup(char *str)
+{
+	alloc_bootmem_cpumask_var(&rcu_nocb_mask);
+	have_rcu_nocb_mask = true;
+	cpulist_parse(str, rcu_nocb_mask);
+	return 1;
+}
+__setup("rcu_nocbs=", rcu_nocb_setup);
+
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
+{
+	rdp->nocb_head = NULL;
+	rdp->nocb_tail = &rdp->nocb_head;
+	spin_lock_init(&rdp->nocb_lock);
+}
+
+/*
+ * Append the ready callbacks extracted by rcu_do_batch() to the list of
+ * the CPU's rcuo kthread, if the CPU has one.  Returns the number of
+ * callbacks handed off, zero if the caller is to invoke them itself.
+ */
+static long rcu_nocb_enqueue(struct rcu_data *rdp, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	struct rcu_head *rhp;
+	unsigned long flags;
+	long count = 0;
+
+	if (!ACCESS_ONCE(per_cpu(rcu_nocb_kthread_task, rdp->cpu)))
+		return 0;
+
+	for (rhp = list; rhp; rhp = rhp->next)
+		count++;
+	spin_lock_irqsave(&rdp->nocb_lock, flags);
+	*rdp->nocb_tail = list;
+	rdp->nocb_tail = tail;
+	rdp->n_nocb_queued += count;
+	spin_unlock_irqrestore(&rdp->nocb_lock, flags);
+	wake_up(&per_cpu(rcu_nocb_wq, rdp->cpu));
+	return count;
+}
+
+static bool rcu_nocb_cpu_has_work(int cpu)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(rcu_nocb_states); i++)
+		if (ACCESS_ONCE(per_cpu_ptr(rcu_nocb_states[i]->rda,
+					    cpu)->nocb_head))
+			return true;
+	return false;
+}
+
+/*
+ * Invoke everything queued for the kthread on one rcu_data.  Callbacks
+ * expect to run with bottom halves disabled, as they would in softirq.
+ */
+static void rcu_nocb_invoke(struct rcu_data *rdp)
+{
+	struct rcu_head *list, *next;
+	unsigned long flags;
+
+	spin_lock_irqsave(&rdp->nocb_lock, flags);
+	list = rdp->nocb_head;
+	rdp->nocb_head = NULL;
+	rdp->nocb_tail = &rdp->nocb_head;
+	spin_unlock_irqrestore(&rdp->nocb_lock, flags);
+
+	while (list) {
+		next = list->next;
+		debug_rcu_head_unqueue(list);
+		local_bh_disable();
+		__rcu_reclaim(list);
+		local_bh_enable();
+		list = next;
+		smp_mb(); /* Callback's effects before rcu_nocb_barrier() sees. */
+		rdp->n_nocb_invoked++;
+		cond_resched();
+	}
+}
+
+static int rcu_nocb_kthread(void *arg)
+{
+	int cpu = (long)arg;
+	int i;
+
+	for (;;) {
+		wait_event_interruptible(per_cpu(rcu_nocb_wq, cpu),
+					 rcu_nocb_cpu_has_work(cpu));
+		for (i = 0; i < ARRAY_SIZE(rcu_nocb_states); i++)
+			rcu_nocb_invoke(per_cpu_ptr(rcu_nocb_states[i]->rda,
+						    cpu));
+	}
+	return 0;
+}
+
+/*
+ * rcu_barrier() sees the callbacks of online CPUs drain through its own
+ * barrier callbacks, which queue up behind them.  Callbacks handed to
+ * the kthread of a CPU that went offline since are not covered by that,
+ * so also wait for every kthread to catch up with what it was given.
+ */
+static void rcu_nocb_barrier(struct rcu_state *rsp)
+{
+	struct rcu_data *rdp;
+	unsigned long snap;
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return;
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		rdp = per_cpu_ptr(rsp->rda, cpu);
+		snap = ACCESS_ONCE(rdp->n_nocb_queued);
+		while (ULONG_CMP_LT(ACCESS_ONCE(rdp->n_nocb_invoked), snap))
+			schedule_timeout_uninterruptible(1);
+	}
+	smp_mb(); /* Callbacks' effects before caller proceeds. */
+}
+
+/*
+ * Spawn the rcuo kthreads of all possible CPUs in rcu_nocb_mask, so
+ * that CPUs coming online later find theirs already running.
+ */
+static int __init rcu_spawn_nocb_kthreads(void)
+{
+	struct task_struct *t;
+	char buf[64];
+	int cpu;
+
+	if (!have_rcu_nocb_mask)
+		return 0;
+	cpumask_and(rcu_nocb_mask, rcu_nocb_mask, cpu_possible_mask);
+	cpulist_scnprintf(buf, sizeof(buf), rcu_nocb_mask);
+	printk(KERN_INFO "RCU: offloading callbacks of CPUs %s.\n", buf);
+
+	for_each_cpu(cpu, rcu_nocb_mask) {
+		init_waitqueue_head(&per_cpu(rcu_nocb_wq, cpu));
+		t = kthread_run(rcu_nocb_kthread, (void *)(long)cpu,
+				"rcuo/%d", cpu);
+		if (IS_ERR(t)) {
+			printk(KERN_ERR "RCU: cannot start rcuo/%d, its "
+			       "callbacks stay in softirq.\n", cpu);
+			continue;
+		}
+		per_cpu(rcu_nocb_kthread_task, cpu) = t;
+	}
+	return 0;
+}
+early_initcall(rcu_spawn_nocb_kthreads);
+
+#else /* #ifdef CONFIG_RCU_NOCB_CPU */
+
+static void __init rcu_boot_init_nocb_percpu_data(struct rcu_data *rdp)
+{
+}
+
+static long rcu_nocb_enqueue(struct rcu_data *rdp, struct rcu_head *list,
+			     struct rcu_head **tail)
+{
+	return 0;
+}
+
+static void rcu_nocb_barrier(struct rcu_state *rsp)
+{
+}
+
+#endif /* #else #ifdef CONFIG_RCU_NOCB_CPU */
@@ -376,6 +376,22 @@ struct cfs_rq {
 	unsigned long load_contribution;
 #endif
 #endif
+
+#ifdef CONFIG_SMP
+	/*
+	 * Per-entity load tracking: runnable_load_avg is the sum of the
+	 * load_avg_contrib of the entities queued here, blocked_load_avg that
+	 * of the tasks which last ran here and are now asleep; it keeps
+	 * decaying, decay_counter counts the ~1ms periods it has decayed by.
+	 * Load of blocked tasks which migrated away is collected in
+	 * removed_load, to be taken off blocked_load_avg under rq->lock.
+	 */
+	unsigned long runnable_load_avg, blocked_load_avg;
+	atomic64_t decay_counter, removed_load;
+	u64 last_decay;
+	/* sum of util_avg_contrib of the queued entities, for cpufreq */
+	unsigned long runnable_util_avg;
+#endif
 };
 
 /* Real-Time classes' related field in a runqueue: */
@@ -471,6 +487,10 @@ struct rq {
 
 	/* capture load from *all* tasks on this cpu: */
 	struct load_weight load;
+#ifdef CONFIG_SMP
+	/* decayed average of the time this cpu had runnable tasks */
+	struct sched_avg avg;
+#endif
 	unsigned long nr_load_updates;
 	u64 nr_switches;
 
@@ -601,6 +621,43 @@ static inline int cpu_of(struct rq *rq)
 #define cpu_curr(cpu)		(cpu_rq(cpu)->curr)
 #define raw_rq()		(&__raw_get_cpu_var(runqueues))
 
+#ifdef CONFIG_SMP
+/*
+ * The highest domain of each cpu sharing its last level cache, and the
+ * first cpu of that domain's span, which identifies the cache.
+ */
+static DEFINE_PER_CPU(struct sched_domain *, sd_llc);
+static DEFINE_PER_CPU(int, sd_llc_id);
+
+/*
+ * Idle cpus of each last level cache, kept in the mask of the cache's
+ * sd_llc_id cpu so that wakeups find an idle sibling without scanning
+ * the domain.  A cpu sets and clears its own bit, under its rq->lock,
+ * when it switches to and away from the idle task.  Each mask sits in
+ * its own cache line, so only cpus sharing a cache write to it.
+ */
+static DEFINE_PER_CPU(struct cpumask *, llc_idle_cpus);
+
+static inline struct cpumask *cpu_llc_idle_mask(int cpu)
+{
+	return per_cpu(llc_idle_cpus, per_cpu(sd_llc_id, cpu));
+}
+
+static inline void update_llc_idle(struct rq *rq, int idle)
+{
+	struct cpumask *mask = cpu_llc_idle_mask(rq->cpu);
+
+	if (idle)
+		cpumask_set_cpu(rq->cpu, mask);
+	else
+		cpumask_clear_cpu(rq->cpu, mask);
+}
+#else
+static inline void update_llc_idle(struct rq *rq, int idle)
+{
+}
+#endif
+
 #ifdef CONFIG_CGROUP_SCHED
 
 /*
@@ -1507,9 +1564,15 @@ static int tg_nop(struct task_group *tg, void *data)
 #endif
 
 #ifdef CONFIG_SMP
-/* Used instead of source_load when we know the type == 0 */
+/*
+ * Used instead of source_load when we know the type == 0.  With
+ * LB_RUNNABLE_AVG this is the decayed runnable load, which sees tasks
+ * that run in short bursts even while they happen to be asleep.
+ */
 static unsigned long weighted_cpuload(const int cpu)
 {
+	if (sched_feat(LB_RUNNABLE_AVG))
+		return cpu_rq(cpu)->cfs.runnable_load_avg;
 	return cpu_rq(cpu)->load.weight;
 }
 
@@ -1559,7 +1622,7 @@ static unsigned long cpu_avg_load_per_task(int cpu)
 	unsigned long nr_running = ACCESS_ONCE(rq->nr_running);
 
 	if (nr_running)
-		rq->avg_load_per_task = rq->load.weight / nr_running;
+		rq->avg_load_per_task = weighted_cpuload(cpu) / nr_running;
 	else
 		rq->avg_load_per_task = 0;
 
@@ -2024,6 +2087,50 @@ static void update_rq_clock_task(struct rq *rq, s64 delta)
 
 #endif /* CONFIG_IRQ_TIME_ACCOUNTING */
 
+#if defined(CONFIG_CPU_FREQ) && defined(CONFIG_SMP)
+static DEFINE_PER_CPU(struct update_util_data *, cpufreq_update_util_data);
+
+/**
+ * cpufreq_set_update_util_data - install a utilization hook for a cpu
+ * @cpu: the cpu
+ * @data: the hook, or NULL to remove it
+ *
+ * The hook is called under rcu_read_lock_sched(); after removing it,
+ * the caller has to synchronize_sched() before freeing @data.
+ */
+void cpufreq_set_update_util_data(int cpu, struct update_util_data *data)
+{
+	rcu_assign_pointer(per_cpu(cpufreq_update_util_data, cpu), data);
+}
+EXPORT_SYMBOL_GPL(cpufreq_set_update_util_data);
+
+/*
+ * The utilization of a cpu is the runnable fraction of the entities
+ * queued on it, which is what a task that has just woken up brings
+ * along, but at least how busy the cpu has recently been, so that the
+ * frequency does not drop the moment a bursty task goes to sleep.
+ */
+static void cpufreq_update_util(struct rq *rq)
+{
+	struct update_util_data *data;
+	unsigned long util;
+
+	data = rcu_dereference_sched(per_cpu(cpufreq_update_util_data,
+					     cpu_of(rq)));
+	if (!data)
+		return;
+
+	util = ((unsigned long)rq->avg.runnable_avg_sum << SCHED_LOAD_SHIFT) /
+	       (rq->avg.runnable_avg_period + 1);
+	util = max(util, rq->cfs.runnable_util_avg);
+	util = min_t(unsigned long, util, SCHED_LOAD_SCALE);
+
+	data->func(data, rq->clock, util, SCHED_LOAD_SCALE);
+}
+#else
+static inline void cpufreq_update_util(struct rq *rq) {}
+#endif
+
 #include "sched_idletask.c"
 #include "sched_fair.c"
 #include "sched_rt.c"
@@ -2217,6 +2324,8 @@ void set_task_cpu(struct task_struct *p, unsigned int new_cpu)
 	trace_sched_migrate_task(p, new_cpu);
 
 	if (task_cpu(p) != new_cpu) {
+		if (p->sched_class->migrate_task_rq)
+			p->sched_class->migrate_task_rq(p, new_cpu);
 		p->se.nr_migrations++;
 		perf_sw_event(PERF_COUNT_SW_CPU_MIGRATIONS, 1, 1, NULL, 0);
 	}
@@ -2839,6 +2948,10 @@ static void __sched_fork(struct task_struct *p)
 	p->se.vruntime			= 0;
 	INIT_LIST_HEAD(&p->se.group_node);
 
+#ifdef CONFIG_SMP
+	memset(&p->se.avg, 0, sizeof(p->se.avg));
+#endif
+
 #ifdef CONFIG_SCHEDSTATS
 	memset(&p->se.statistics, 0, sizeof(p->se.statistics));
 #endif
@@ -6869,6 +6982,31 @@ static void destroy_sched_domains(struct sched_domain *sd, int cpu)
 		destroy_sched_domain(sd, cpu);
 }
 
+/*
+ * Record the last level cache of 'cpu' for select_idle_sibling().  The
+ * bit of 'cpu' is dropped from the idle mask of a cache it has left;
+ * one that races in again is harmless, as users also check the span.
+ */
+static void update_top_cache_domain(int cpu)
+{
+	struct sched_domain *sd, *llc = NULL;
+	int id = cpu;
+
+	for_each_domain(cpu, sd) {
+		if (!(sd->flags & SD_SHARE_PKG_RESOURCES))
+			break;
+		llc = sd;
+	}
+	if (llc)
+		id = cpumask_first(sched_domain_span(llc));
+
+	rcu_assign_pointer(per_cpu(sd_llc, cpu), llc);
+	if (per_cpu(sd_llc_id, cpu) != id) {
+		cpumask_clear_cpu(cpu, cpu_llc_idle_mask(cpu));
+		per_cpu(sd_llc_id, cpu) = id;
+	}
+}
+
 /*
  * Attach the domain 'sd' to 'cpu' as its base domain. Callers must
  * hold the hotplug lock.
@@ -6907,6 +7045,7 @@ cpu_attach_domain(struct sched_domain *sd, struct root_domain *rd, int cpu)
 	rq_attach_root(rq, rd);
 	tmp = rq->sd;
 	rcu_assign_pointer(rq->sd, sd);
+	update_top_cache_domain(cpu);
 	destroy_sched_domains(tmp, cpu);
 }
 
@@ -7959,6 +8098,11 @@ static void init_cfs_rq(struct cfs_rq *cfs_rq, struct rq *rq)
 #ifndef CONFIG_64BIT
 	cfs_rq->min_vruntime_copy = cfs_rq->min_vruntime;
 #endif
+#ifdef CONFIG_SMP
+	/* a decay_count of 0 means "not blocked", see sched_avg */
+	atomic64_set(&cfs_rq->decay_counter, 1);
+	atomic64_set(&cfs_rq->removed_load, 0);
+#endif
 }
 
 static void init_rt_rq(struct rt_rq *rt_rq, struct rq *rq)
@@ -8168,6 +8312,9 @@ void __init sched_init(void)
 		rq->idle_stamp = 0;
 		rq->avg_idle = 2*sysctl_sched_migration_cost;
 		rq_attach_root(rq, &def_root_domain);
+		per_cpu(sd_llc_id, i) = i;
+		per_cpu(llc_idle_cpus, i) = kzalloc(ALIGN(cpumask_size(),
+						L1_CACHE_BYTES), GFP_NOWAIT);
 #ifdef CONFIG_NO_HZ
 		rq->nohz_balance_kick = 0;
 		init_sched_softirq_csd(&per_cpu(remote_sched_softirq_cb, i));
@@ -862,6 +862,359 @@ static inline void update_entity_shares_tick(struct cfs_rq *cfs_rq)
 }
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
+#ifdef CONFIG_SMP
+/*
+ * Per-entity load tracking.
+ *
+ * Time is split into periods of 1024us (~1ms).  For every entity we keep
+ * a geometric series of how much of each period it was runnable, the
+ * most recent period weighted 1 and each one before it y times the one
+ * after, with y chosen so that y^32 = 1/2: load from 32ms ago counts half
+ * as much as load now.  runnable_avg_sum / runnable_avg_period is the
+ * fraction of recent time the entity wanted to run, and its weight times
+ * that fraction is its load_avg_contrib.
+ *
+ * A cfs_rq sums the contributions of its queued entities in
+ * runnable_load_avg.  Tasks that go to sleep move theirs to
+ * blocked_load_avg, which decays as a whole, so that a task waking up
+ * again can be put back with its contribution decayed by the same
+ * amount without walking every sleeper on each tick.
+ */
+
+/* precomputed 2^32 * y^n, for multiplication by y^n */
+static const u32 runnable_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2da, 0xf5257d14, 0xefe4b99a, 0xeac0c6e6, 0xe5b906e6,
+	0xe0ccdeeb, 0xdbfbb796, 0xd744fcc9, 0xd2a81d91, 0xce248c14, 0xc9b9bd85,
+	0xc5672a10, 0xc12c4cc9, 0xbd08a39e, 0xb8fbaf46, 0xb504f333, 0xb123f581,
+	0xad583ee9, 0xa9a15ab4, 0xa5fed6a9, 0xa2704302, 0x9ef5325f, 0x9b8d39b9,
+	0x9837f050, 0x94f4efa8, 0x91c3d373, 0x8ea4398a, 0x8b95c1e3, 0x88980e80,
+	0x85aac367, 0x82cd8698,
+};
+
+/* precomputed sum of 1024 * y^k for k = 1..n */
+static const u32 runnable_avg_yN_sum[] = {
+	    0, 1002, 1982, 2941, 3880, 4798, 5697, 6576, 7437, 8279, 9103,
+	 9909,10698,11470,12226,12966,13690,14398,15091,15769,16433,17082,
+	17718,18340,18949,19545,20128,20698,21256,21802,22336,22859,23371,
+};
+
+#define LOAD_AVG_PERIOD	32
+#define LOAD_AVG_MAX	47742	/* maximum possible runnable_avg_sum */
+#define LOAD_AVG_MAX_N	345	/* periods after which that is reached */
+
+/*
+ * Approximate val * y^n, using the table for the fraction of n within a
+ * half-life and a shift for the whole half-lives.
+ */
+static __always_inline u64 decay_load(u64 val, u64 n)
+{
+	unsigned int local_n;
+
+	if (!n)
+		return val;
+	else if (unlikely(n > LOAD_AVG_PERIOD * 63))
+		return 0;
+
+	local_n = n;
+	if (unlikely(local_n >= LOAD_AVG_PERIOD)) {
+		val >>= local_n / LOAD_AVG_PERIOD;
+		local_n %= LOAD_AVG_PERIOD;
+	}
+
+	val *= runnable_avg_yN_inv[local_n];
+	return val >> 32;
+}
+
+/*
+ * The contribution of n full periods of runnability:
+ * 1024 * (y + y^2 + ... + y^n)
+ */
+static u32 __compute_runnable_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= LOAD_AVG_PERIOD))
+		return runnable_avg_yN_sum[n];
+	else if (unlikely(n >= LOAD_AVG_MAX_N))
+		return LOAD_AVG_MAX;
+
+	/* sum(n) = sum(n - 32) / 2 + sum(32) */
+	do {
+		contrib /= 2;
+		contrib += runnable_avg_yN_sum[LOAD_AVG_PERIOD];
+		n -= LOAD_AVG_PERIOD;
+	} while (n > LOAD_AVG_PERIOD);
+
+	contrib = decay_load(contrib, n);
+	return contrib + runnable_avg_yN_sum[n];
+}
+
+/*
+ * Account the time since sa->last_runnable_update as runnable or not,
+ * decaying the sums if a period boundary was crossed.  Returns 1 when
+ * that happened, i.e. when the average may have changed noticeably.
+ */
+static __always_inline int __update_entity_runnable_avg(u64 now,
+							 struct sched_avg *sa,
+							 int runnable)
+{
+	u64 delta, periods;
+	u32 runnable_contrib;
+	int delta_w, decayed = 0;
+
+	delta = now - sa->last_runnable_update;
+	/* the clock of a freshly migrated entity may be behind ours */
+	if ((s64)delta < 0) {
+		sa->last_runnable_update = now;
+		return 0;
+	}
+
+	/* use 1024ns as the unit of measurement, ~1us */
+	delta >>= 10;
+	if (!delta)
+		return 0;
+	sa->last_runnable_update = now;
+
+	/* how much of the current period had already been accounted */
+	delta_w = sa->runnable_avg_period % 1024;
+	if (delta + delta_w >= 1024) {
+		decayed = 1;
+
+		/* finish off the current period ... */
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		sa->runnable_avg_period += delta_w;
+		delta -= delta_w;
+
+		/* ... decay it along with the full periods that followed ... */
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_load(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->runnable_avg_period = decay_load(sa->runnable_avg_period,
+						     periods + 1);
+
+		/* ... and add those full periods themselves */
+		runnable_contrib = __compute_runnable_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += runnable_contrib;
+		sa->runnable_avg_period += runnable_contrib;
+	}
+
+	/* the remainder starts the new current period */
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	sa->runnable_avg_period += delta;
+
+	return decayed;
+}
+
+/*
+ * Catch a blocked entity's contribution up with the decay its cfs_rq's
+ * blocked_load_avg went through while it slept, return the periods.
+ */
+static inline u64 __synchronize_entity_decay(struct sched_entity *se)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	u64 decays = atomic64_read(&cfs_rq->decay_counter);
+
+	decays -= se->avg.decay_count;
+	/* se is synchronized, even if no period has passed since it slept */
+	se->avg.decay_count = 0;
+	if (!decays)
+		return 0;
+
+	se->avg.load_avg_contrib = decay_load(se->avg.load_avg_contrib, decays);
+
+	return decays;
+}
+
+/*
+ * Recompute se's contribution from its average, return the change.
+ * Group entities are treated like tasks: their weight is the share
+ * update_cfs_shares() gave them, scaled by how often they were runnable.
+ */
+static long __update_entity_load_avg_contrib(struct sched_entity *se)
+{
+	long old_contrib = se->avg.load_avg_contrib;
+	u64 contrib;
+
+	contrib = (u64)se->avg.runnable_avg_sum * se->load.weight;
+	se->avg.load_avg_contrib = div_u64(contrib,
+					   se->avg.runnable_avg_period + 1);
+
+	return se->avg.load_avg_contrib - old_contrib;
+}
+
+/*
+ * Same for the weight-independent runnable fraction, which is what
+ * cpufreq wants to know: how busy the cpu is, not how important.
+ */
+static long __update_entity_util_avg_contrib(struct sched_entity *se)
+{
+	long old_contrib = se->avg.util_avg_contrib;
+
+	se->avg.util_avg_contrib = ((unsigned long)se->avg.runnable_avg_sum
+				    << SCHED_LOAD_SHIFT) /
+				   (se->avg.runnable_avg_period + 1);
+
+	return se->avg.util_avg_contrib - old_contrib;
+}
+
+static inline void subtract_blocked_load_contrib(struct cfs_rq *cfs_rq,
+						 long load_contrib)
+{
+	if (likely(load_contrib < cfs_rq->blocked_load_avg))
+		cfs_rq->blocked_load_avg -= load_contrib;
+	else
+		cfs_rq->blocked_load_avg = 0;
+}
+
+/* Update se's runnable average and, optionally, its cfs_rq's sums */
+static inline void update_entity_load_avg(struct sched_entity *se,
+					  int update_cfs_rq)
+{
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+	long contrib_delta, util_delta;
+
+	if (!__update_entity_runnable_avg(rq_of(cfs_rq)->clock_task, &se->avg,
+					  se->on_rq))
+		return;
+
+	contrib_delta = __update_entity_load_avg_contrib(se);
+	util_delta = __update_entity_util_avg_contrib(se);
+
+	if (!update_cfs_rq)
+		return;
+
+	if (se->on_rq) {
+		cfs_rq->runnable_load_avg += contrib_delta;
+		cfs_rq->runnable_util_avg += util_delta;
+	} else
+		subtract_blocked_load_contrib(cfs_rq, -contrib_delta);
+}
+
+/*
+ * Decay blocked_load_avg by the periods (2^20ns, ~1ms) that have passed
+ * since we last did, and drop the load of blocked tasks that migrated
+ * away in the meantime.
+ */
+static void update_cfs_rq_blocked_load(struct cfs_rq *cfs_rq, int force_update)
+{
+	u64 now = rq_of(cfs_rq)->clock_task >> 20;
+	u64 decays;
+
+	decays = now - cfs_rq->last_decay;
+	if (!decays && !force_update)
+		return;
+
+	if (atomic64_read(&cfs_rq->removed_load)) {
+		u64 removed_load = atomic64_xchg(&cfs_rq->removed_load, 0);
+		subtract_blocked_load_contrib(cfs_rq, removed_load);
+	}
+
+	if (decays) {
+		cfs_rq->blocked_load_avg = decay_load(cfs_rq->blocked_load_avg,
+						      decays);
+		atomic64_add(decays, &cfs_rq->decay_counter);
+		cfs_rq->last_decay = now;
+	}
+}
+
+static inline void update_rq_runnable_avg(struct rq *rq, int runnable)
+{
+	__update_entity_runnable_avg(rq->clock_task, &rq->avg, runnable);
+}
+
+/* Add the load of se, about to be queued, to cfs_rq's runnable load */
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se,
+					   int wakeup)
+{
+	/*
+	 * A decay_count <= 0 means se was not blocked on this cfs_rq: it
+	 * is new, was moved here by the load balancer, or migrated here
+	 * on wakeup, in which case -decay_count is the number of periods
+	 * it slept on its old cpu.  The clocks of the two cpus cannot be
+	 * compared, so approximate the sleep with those periods.
+	 */
+	if (unlikely(se->avg.decay_count <= 0)) {
+		se->avg.last_runnable_update = rq_of(cfs_rq)->clock_task;
+		if (se->avg.decay_count) {
+			se->avg.last_runnable_update -= (-se->avg.decay_count)
+							<< 20;
+			update_entity_load_avg(se, 0);
+			se->avg.decay_count = 0;
+		}
+		wakeup = 0;
+	} else {
+		__synchronize_entity_decay(se);
+	}
+
+	/* only tasks that slept here are part of our blocked load */
+	if (wakeup) {
+		subtract_blocked_load_contrib(cfs_rq, se->avg.load_avg_contrib);
+		update_entity_load_avg(se, 0);
+	}
+
+	cfs_rq->runnable_load_avg += se->avg.load_avg_contrib;
+	cfs_rq->runnable_util_avg += se->avg.util_avg_contrib;
+	/* fold in migrations right away on load balancer moves */
+	update_cfs_rq_blocked_load(cfs_rq, !wakeup);
+}
+
+/*
+ * Remove se's load from cfs_rq's runnable load.  A task going to sleep
+ * keeps contributing to blocked_load_avg until it wakes up or migrates.
+ */
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se,
+					   int sleep)
+{
+	update_entity_load_avg(se, 1);
+	update_cfs_rq_blocked_load(cfs_rq, !sleep);
+
+	cfs_rq->runnable_load_avg -= se->avg.load_avg_contrib;
+	cfs_rq->runnable_util_avg -= se->avg.util_avg_contrib;
+	if (sleep) {
+		cfs_rq->blocked_load_avg += se->avg.load_avg_contrib;
+		se->avg.decay_count = atomic64_read(&cfs_rq->decay_counter);
+	}
+}
+
+/*
+ * The load balancer's idea of the load of a task and of a cfs_rq, see
+ * weighted_cpuload().
+ */
+static inline unsigned long task_lb_load(struct task_struct *p)
+{
+	if (sched_feat(LB_RUNNABLE_AVG))
+		return p->se.avg.load_avg_contrib;
+	return p->se.load.weight;
+}
+
+static inline unsigned long cfs_rq_lb_load(struct cfs_rq *cfs_rq)
+{
+	if (sched_feat(LB_RUNNABLE_AVG))
+		return cfs_rq->runnable_load_avg;
+	return cfs_rq->load.weight;
+}
+#else
+static inline void update_entity_load_avg(struct sched_entity *se,
+					  int update_cfs_rq) {}
+static inline void update_rq_runnable_avg(struct rq *rq, int runnable) {}
+static inline void enqueue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se,
+					   int wakeup) {}
+static inline void dequeue_entity_load_avg(struct cfs_rq *cfs_rq,
+					   struct sched_entity *se,
+					   int sleep) {}
+static inline void update_cfs_rq_blocked_load(struct cfs_rq *cfs_rq,
+					      int force_update) {}
+#endif /* CONFIG_SMP */
+
 static void enqueue_sleeper(struct cfs_rq *cfs_rq, struct sched_entity *se)
 {
 #ifdef CONFIG_SCHEDSTATS
@@ -983,6 +1336,7 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	enqueue_entity_load_avg(cfs_rq, se, flags & ENQUEUE_WAKEUP);
 	update_cfs_load(cfs_rq, 0);
 	account_entity_enqueue(cfs_rq, se);
 	update_cfs_shares(cfs_rq);
@@ -1054,6 +1408,7 @@ dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	 * Update run-time statistics of the 'current'.
 	 */
 	update_curr(cfs_rq);
+	dequeue_entity_load_avg(cfs_rq, se, flags & DEQUEUE_SLEEP);
 
 	update_stats_dequeue(cfs_rq, se);
 	if (flags & DEQUEUE_SLEEP) {
@@ -1218,6 +1573,8 @@ static void put_prev_entity(struct cfs_rq *cfs_rq, struct sched_entity *prev)
 		update_stats_wait_start(cfs_rq, prev);
 		/* Put 'current' back into the tree. */
 		__enqueue_entity(cfs_rq, prev);
+		/* in !on_rq case, update occurred at dequeue */
+		update_entity_load_avg(prev, 1);
 	}
 	cfs_rq->curr = NULL;
 }
@@ -1230,6 +1587,12 @@ entity_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr, int queued)
 	 */
 	update_curr(cfs_rq);
 
+	/*
+	 * Keep the runnable averages of long-running entities current.
+	 */
+	update_entity_load_avg(curr, 1);
+	update_cfs_rq_blocked_load(cfs_rq, 1);
+
 	/*
 	 * Update share accounting for long-running entities.
 	 */
@@ -1327,6 +1690,9 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
 
+	/* nr_running is only increased after we return */
+	update_rq_runnable_avg(rq, rq->nr_running);
+
 	for_each_sched_entity(se) {
 		if (se->on_rq)
 			break;
@@ -1340,8 +1706,10 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 		update_cfs_load(cfs_rq, 0);
 		update_cfs_shares(cfs_rq);
+		update_entity_load_avg(se, 1);
 	}
 
+	cpufreq_update_util(rq);
 	hrtick_update(rq);
 }
 
@@ -1380,8 +1748,12 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 		update_cfs_load(cfs_rq, 0);
 		update_cfs_shares(cfs_rq);
+		update_entity_load_avg(se, 1);
 	}
 
+	/* nr_running is only decreased after we return */
+	update_rq_runnable_avg(rq, 1);
+	cpufreq_update_util(rq);
 	hrtick_update(rq);
 }
 
@@ -1408,6 +1780,24 @@ static void task_waking_fair(struct task_struct *p)
 	se->vruntime -= min_vruntime;
 }
 
+/*
+ * Called from set_task_cpu() when p is about to move to next_cpu.  A
+ * sleeping task's load is still part of its old cfs_rq's blocked load;
+ * queue it for removal there, since we do not hold that rq's lock, and
+ * record how far it had decayed for enqueue_entity_load_avg().
+ */
+static void migrate_task_rq_fair(struct task_struct *p, int next_cpu)
+{
+	struct sched_entity *se = &p->se;
+	struct cfs_rq *cfs_rq = cfs_rq_of(se);
+
+	/* queued tasks have decay_count == 0, see dequeue_entity_load_avg() */
+	if (se->avg.decay_count) {
+		se->avg.decay_count = -__synchronize_entity_decay(se);
+		atomic64_add(se->avg.load_avg_contrib, &cfs_rq->removed_load);
+	}
+}
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 /*
  * effective_load() calculates the load change as seen from the root_task_group
@@ -1484,14 +1874,14 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p, int sync)
 	rcu_read_lock();
 	if (sync) {
 		tg = task_group(current);
-		weight = current->se.load.weight;
+		weight = task_lb_load(current);
 
 		this_load += effective_load(tg, this_cpu, -weight, -weight);
 		load += effective_load(tg, prev_cpu, 0, -weight);
 	}
 
 	tg = task_group(p);
-	weight = p->se.load.weight;
+	weight = task_lb_load(p);
 
 	/*
 	 * In low-load situations, where prev_cpu is idle and this_cpu is idle
@@ -1524,8 +1914,10 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p, int sync)
 	 * a reasonable amount of time then attract this newly
 	 * woken task:
 	 */
-	if (sync && balanced)
+	if (sync && balanced) {
+		schedstat_inc(sd, ttwu_wake_affine);
 		return 1;
+	}
 
 	schedstat_inc(p, se.statistics.nr_wakeups_affine_attempts);
 	tl_per_task = cpu_avg_load_per_task(this_cpu);
@@ -1539,10 +1931,12 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p, int sync)
 		 * there is no bad imbalance.
 		 */
 		schedstat_inc(sd, ttwu_move_affine);
+		schedstat_inc(sd, ttwu_wake_affine);
 		schedstat_inc(p, se.statistics.nr_wakeups_affine);
 
 		return 1;
 	}
+	schedstat_inc(sd, ttwu_wake_affine_failed);
 	return 0;
 }
 
@@ -1648,27 +2042,21 @@ static int select_idle_sibling(struct task_struct *p, int target)
 		return prev_cpu;
 
 	/*
-	 * Otherwise, iterate the domains and find an elegible idle cpu.
+	 * Otherwise, pick an elegible idle cpu sharing the last level cache
+	 * with target.  Only cpus known to be idle are looked at; the span
+	 * test filters bits left behind across a domain rebuild.
 	 */
 	rcu_read_lock();
-	for_each_domain(target, sd) {
-		if (!(sd->flags & SD_SHARE_PKG_RESOURCES))
-			break;
-
-		for_each_cpu_and(i, sched_domain_span(sd), &p->cpus_allowed) {
-			if (idle_cpu(i)) {
+	sd = rcu_dereference(per_cpu(sd_llc, target));
+	if (sd) {
+		for_each_cpu_and(i, cpu_llc_idle_mask(target),
+				 &p->cpus_allowed) {
+			if (cpumask_test_cpu(i, sched_domain_span(sd)) &&
+			    idle_cpu(i)) {
 				target = i;
 				break;
 			}
 		}
-
-		/*
-		 * Lets stop looking for an idle sibling when we reached
-		 * the domain that spans the current cpu and prev_cpu.
-		 */
-		if (cpumask_test_cpu(cpu, sched_domain_span(sd)) &&
-		    cpumask_test_cpu(prev_cpu, sched_domain_span(sd)))
-			break;
 	}
 	rcu_read_unlock();
 
@@ -2156,14 +2544,15 @@ balance_tasks(struct rq *this_rq, int this_cpu, struct rq *busiest,
 		if (loops++ > sysctl_sched_nr_migrate)
 			break;
 
-		if ((p->se.load.weight >> 1) > rem_load_move ||
+		if ((task_lb_load(p) >> 1) > rem_load_move ||
 		    !can_migrate_task(p, busiest, this_cpu, sd, idle,
 				      all_pinned))
 			continue;
 
+		/* sample the load before pull_task() re-enqueues p */
+		rem_load_move -= task_lb_load(p);
 		pull_task(busiest, p, this_rq, this_cpu);
 		pulled++;
-		rem_load_move -= p->se.load.weight;
 
 #ifdef CONFIG_PREEMPT
 		/*
@@ -2213,6 +2602,8 @@ static int update_shares_cpu(struct task_group *tg, int cpu)
 
 	update_rq_clock(rq);
 	update_cfs_load(cfs_rq, 1);
+	update_cfs_rq_blocked_load(cfs_rq, 1);
+	update_entity_load_avg(tg->se[cpu], 1);
 
 	/*
 	 * We need to update shares after updating tg->load_weight in
@@ -2252,7 +2643,7 @@ load_balance_fair(struct rq *this_rq, int this_cpu, struct rq *busiest,
 	list_for_each_entry_rcu(tg, &task_groups, list) {
 		struct cfs_rq *busiest_cfs_rq = tg->cfs_rq[busiest_cpu];
 		unsigned long busiest_h_load = busiest_cfs_rq->h_load;
-		unsigned long busiest_weight = busiest_cfs_rq->load.weight;
+		unsigned long busiest_weight = cfs_rq_lb_load(busiest_cfs_rq);
 		u64 rem_load, moved_load;
 
 		/*
@@ -4120,6 +4511,9 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	update_rq_runnable_avg(rq, 1);
+	cpufreq_update_util(rq);
 }
 
 /*
@@ -4162,6 +4556,17 @@ static void task_fork_fair(struct task_struct *p)
 
 	se->vruntime -= cfs_rq->min_vruntime;
 
+#ifdef CONFIG_SMP
+	/*
+	 * Start the child off as if it had been runnable for a full slice,
+	 * so that the balancer does not see a fork bomb as free.
+	 */
+	se->avg.runnable_avg_sum = sched_slice(cfs_rq, se) >> 10;
+	se->avg.runnable_avg_period = se->avg.runnable_avg_sum;
+	__update_entity_load_avg_contrib(se);
+	__update_entity_util_avg_contrib(se);
+#endif
+
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
 
@@ -4209,6 +4614,14 @@ static void switched_from_fair(struct rq *rq, struct task_struct *p)
 		place_entity(cfs_rq, se, 0);
 		se->vruntime -= cfs_rq->min_vruntime;
 	}
+
+#ifdef CONFIG_SMP
+	/* a sleeping task leaving the class takes its blocked load along */
+	if (se->avg.decay_count) {
+		__synchronize_entity_decay(se);
+		subtract_blocked_load_contrib(cfs_rq, se->avg.load_avg_contrib);
+	}
+#endif
 }
 
 /*
@@ -4259,11 +4672,25 @@ static void task_move_group_fair(struct task_struct *p, int on_rq)
 	 * to another cgroup's rq. This does somewhat interfere with the
 	 * fair sleeper stuff for the first placement, but who cares.
 	 */
-	if (!on_rq)
+	if (!on_rq) {
 		p->se.vruntime -= cfs_rq_of(&p->se)->min_vruntime;
+#ifdef CONFIG_SMP
+		/* move our blocked load along with us */
+		__synchronize_entity_decay(&p->se);
+		subtract_blocked_load_contrib(cfs_rq_of(&p->se),
+					      p->se.avg.load_avg_contrib);
+#endif
+	}
 	set_task_rq(p, task_cpu(p));
-	if (!on_rq)
-		p->se.vruntime += cfs_rq_of(&p->se)->min_vruntime;
+	if (!on_rq) {
+		struct cfs_rq *cfs_rq = cfs_rq_of(&p->se);
+
+		p->se.vruntime += cfs_rq->min_vruntime;
+#ifdef CONFIG_SMP
+		p->se.avg.decay_count = atomic64_read(&cfs_rq->decay_counter);
+		cfs_rq->blocked_load_avg += p->se.avg.load_avg_contrib;
+#endif
+	}
 }
 #endif
 
@@ -4304,6 +4731,7 @@ static const struct sched_class fair_sched_class = {
 	.rq_offline		= rq_offline_fair,
 
 	.task_waking		= task_waking_fair,
+	.migrate_task_rq	= migrate_task_rq_fair,
 #endif
 
 	.set_curr_task          = set_curr_task_fair,
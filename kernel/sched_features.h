@@ -53,6 +53,12 @@ SCHED_FEAT(HRTICK, 0)
 SCHED_FEAT(DOUBLE_TICK, 0)
 SCHED_FEAT(LB_BIAS, 1)
 
+/*
+ * Balance on the decayed runnable load of tasks and runqueues rather
+ * than on their instantaneous weight.
+ */
+SCHED_FEAT(LB_RUNNABLE_AVG, 1)
+
 /*
  * Spin-wait on mutex acquisition when the mutex owner is running on
  * another cpu -- assumes that when the owner is running, it will soon
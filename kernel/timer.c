@@ -78,6 +78,7 @@ struct tvec_base {
 	struct timer_list *running_timer;
 	unsigned long timer_jiffies;
 	unsigned long next_timer;
+	unsigned long nr_batched;
 	struct tvec_root tv1;
 	struct tvec tv2;
 	struct tvec tv3;
@@ -89,6 +90,12 @@ struct tvec_base boot_tvec_bases;
 EXPORT_SYMBOL(boot_tvec_bases);
 static DEFINE_PER_CPU(struct tvec_base *, tvec_bases) = &boot_tvec_bases;
 
+/*
+ * Minimum slack, in jiffies, of deferrable timers that did not set one
+ * of their own.  Tunable as /proc/sys/kernel/timer_deferrable_slack_ms.
+ */
+int sysctl_timer_deferrable_slack __read_mostly = HZ / 100;
+
 /* Functions below help us manage 'deferrable' flag */
 static inline unsigned int tbase_get_deferrable(struct tvec_base *base)
 {
@@ -756,12 +763,22 @@ unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
 	if (timer->slack >= 0) {
 		expires_limit = expires + timer->slack;
 	} else {
-		long delta = expires - jiffies;
+		long slack = (long)(expires - jiffies) / 256;
+
+		/*
+		 * Deferrable timers do not wake an idle cpu anyway, so
+		 * nobody minds them being a little late: make them share
+		 * an expiry with their neighbours, which lets a busy cpu
+		 * run them together instead of on every other tick.
+		 */
+		if (tbase_get_deferrable(timer->base) &&
+		    slack < sysctl_timer_deferrable_slack)
+			slack = sysctl_timer_deferrable_slack;
 
-		if (delta < 256)
+		if (slack <= 0)
 			return expires;
 
-		expires_limit = expires + delta / 256;
+		expires_limit = expires + slack;
 	}
 	mask = expires ^ expires_limit;
 	if (mask == 0)
@@ -1102,6 +1119,7 @@ static inline void __run_timers(struct tvec_base *base)
 		struct list_head work_list;
 		struct list_head *head = &work_list;
 		int index = base->timer_jiffies & TVR_MASK;
+		int fired = 0;
 
 		/*
 		 * Cascade timers:
@@ -1123,6 +1141,10 @@ static inline void __run_timers(struct tvec_base *base)
 
 			timer_stats_account_timer(timer);
 
+			/* Everything after the first rides on its wakeup */
+			if (fired++)
+				base->nr_batched++;
+
 			base->running_timer = timer;
 			detach_timer(timer, 1);
 
@@ -1135,6 +1157,11 @@ static inline void __run_timers(struct tvec_base *base)
 	spin_unlock_irq(&base->lock);
 }
 
+unsigned long timer_get_nr_batched(int cpu)
+{
+	return per_cpu(tvec_bases, cpu)->nr_batched;
+}
+
 #ifdef CONFIG_NO_HZ
 /*
  * Find out when the next timer event is due to happen. This
@@ -1409,6 +1436,28 @@ static void process_timeout(unsigned long __data)
 	wake_up_process((struct task_struct *)__data);
 }
 
+/*
+ * A task that asked for a jiffy or more of timer slack through
+ * PR_SET_TIMERSLACK gets it for its schedule_timeout() sleeps as well,
+ * not only for its nanosleep, poll and futex hrtimers.  Smaller slack,
+ * like the 50us default, leaves the timeout alone.
+ */
+static unsigned long apply_task_slack(struct timer_list *timer,
+				      unsigned long expires)
+{
+	unsigned long slack;
+
+	if (rt_task(current))
+		return expires;
+
+	slack = current->timer_slack_ns / TICK_NSEC;
+	if (!slack)
+		return expires;
+
+	set_timer_slack(timer, min_t(unsigned long, slack, INT_MAX));
+	return apply_slack(timer, expires);
+}
+
 /**
  * schedule_timeout - sleep until timeout
  * @timeout: timeout value in jiffies
@@ -1472,7 +1521,8 @@ signed long __sched schedule_timeout(signed long timeout)
 	expire = timeout + jiffies;
 
 	setup_timer_on_stack(&timer, process_timeout, (unsigned long)current);
-	__mod_timer(&timer, expire, false, TIMER_NOT_PINNED);
+	__mod_timer(&timer, apply_task_slack(&timer, expire), false,
+		    TIMER_NOT_PINNED);
 	schedule();
 	del_singleshot_timer_sync(&timer);
 
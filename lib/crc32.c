@@ -26,15 +26,16 @@
 #include <linux/compiler.h>
 #include <linux/types.h>
 #include <linux/init.h>
+#include <linux/hrtimer.h>
 #include <asm/atomic.h>
 #include "crc32defs.h"
-#if CRC_LE_BITS == 8
+#if CRC_LE_BITS >= 8
 # define tole(x) __constant_cpu_to_le32(x)
 #else
 # define tole(x) (x)
 #endif
 
-#if CRC_BE_BITS == 8
+#if CRC_BE_BITS >= 8
 # define tobe(x) __constant_cpu_to_be32(x)
 #else
 # define tobe(x) (x)
@@ -45,23 +46,38 @@ MODULE_AUTHOR("Matt Domsch <Matt_Domsch@dell.com>");
 MODULE_DESCRIPTION("Ethernet CRC32 calculations");
 MODULE_LICENSE("GPL");
 
-#if CRC_LE_BITS == 8 || CRC_BE_BITS == 8
+#if CRC_LE_BITS >= 8 || CRC_BE_BITS >= 8
 
+/*
+ * The table rows advance the crc of a byte by zero to seven more bytes, so
+ * the bytes of a word can be looked up independently and the results
+ * xored together.  With CRC_xx_BITS == 64 two words are done per step, the
+ * first one using rows 7 to 4.
+ */
 static inline u32
-crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
+crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256],
+	   int words)
 {
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[0][(crc ^ (x)) & 255] ^ (crc >> 8)
-#  define DO_CRC4 crc = tab[3][(crc) & 255] ^ \
-		tab[2][(crc >> 8) & 255] ^ \
-		tab[1][(crc >> 16) & 255] ^ \
-		tab[0][(crc >> 24) & 255]
+#  define DO_CRC4(q) (tab[3][(q) & 255] ^ \
+		tab[2][((q) >> 8) & 255] ^ \
+		tab[1][((q) >> 16) & 255] ^ \
+		tab[0][((q) >> 24) & 255])
+#  define DO_CRC8(q) (tab[7][(q) & 255] ^ \
+		tab[6][((q) >> 8) & 255] ^ \
+		tab[5][((q) >> 16) & 255] ^ \
+		tab[4][((q) >> 24) & 255])
 # else
 #  define DO_CRC(x) crc = tab[0][((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
-#  define DO_CRC4 crc = tab[0][(crc) & 255] ^ \
-		tab[1][(crc >> 8) & 255] ^ \
-		tab[2][(crc >> 16) & 255] ^ \
-		tab[3][(crc >> 24) & 255]
+#  define DO_CRC4(q) (tab[0][(q) & 255] ^ \
+		tab[1][((q) >> 8) & 255] ^ \
+		tab[2][((q) >> 16) & 255] ^ \
+		tab[3][((q) >> 24) & 255])
+#  define DO_CRC8(q) (tab[4][(q) & 255] ^ \
+		tab[5][((q) >> 8) & 255] ^ \
+		tab[6][((q) >> 16) & 255] ^ \
+		tab[7][((q) >> 24) & 255])
 # endif
 	const u32 *b;
 	size_t    rem_len;
@@ -72,13 +88,24 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 			DO_CRC(*buf++);
 		} while ((--len) && ((long)buf)&3);
 	}
-	rem_len = len & 3;
-	/* load data 32 bits wide, xor data 32 bits wide. */
-	len = len >> 2;
 	b = (const u32 *)buf;
-	for (--b; len; --len) {
-		crc ^= *++b; /* use pre increment for speed */
-		DO_CRC4;
+	--b;
+	if (words == 2) {
+		/* load data 64 bits wide, xor data 32 bits wide. */
+		rem_len = len & 7;
+		for (len >>= 3; len; --len) {
+			u32 q = crc ^ *++b; /* use pre increment for speed */
+			crc = DO_CRC8(q);
+			q = *++b;
+			crc ^= DO_CRC4(q);
+		}
+	} else {
+		/* load data 32 bits wide, xor data 32 bits wide. */
+		rem_len = len & 3;
+		for (len >>= 2; len; --len) {
+			crc ^= *++b; /* use pre increment for speed */
+			crc = DO_CRC4(crc);
+		}
 	}
 	len = rem_len;
 	/* And the last few bytes */
@@ -91,63 +118,106 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 	return crc;
 #undef DO_CRC
 #undef DO_CRC4
+#undef DO_CRC8
 }
 #endif
+
 /**
- * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
- * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
- *	other uses, or the previous crc32 value if computing incrementally.
+ * crc32_le_generic() - Calculate bitwise little-endian CRC32
+ * @crc: seed value for computation
  * @p: pointer to buffer over which CRC is run
  * @len: length of buffer @p
+ * @tab: little-endian table for @polynomial
+ * @polynomial: CRC polynomial, bit reversed, for the CRC_LE_BITS == 1 case
  */
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len);
-
-#if CRC_LE_BITS == 1
-/*
- * In fact, the table-based code will work in this case, but it can be
- * simplified by inlining the table in ?: form.
- */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+static inline u32 __pure
+crc32_le_generic(u32 crc, unsigned char const *p, size_t len,
+		 const u32 (*tab)[256], u32 polynomial)
 {
+#if CRC_LE_BITS == 1
+	/*
+	 * In fact, the table-based code will work in this case, but it can be
+	 * simplified by inlining the table in ?: form.
+	 */
 	int i;
 	while (len--) {
 		crc ^= *p++;
 		for (i = 0; i < 8; i++)
-			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+			crc = (crc >> 1) ^ ((crc & 1) ? polynomial : 0);
 	}
-	return crc;
-}
-#else				/* Table-based approach */
-
-u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
-{
-# if CRC_LE_BITS == 8
-	const u32      (*tab)[] = crc32table_le;
-
-	crc = __cpu_to_le32(crc);
-	crc = crc32_body(crc, p, len, tab);
-	return __le32_to_cpu(crc);
-# elif CRC_LE_BITS == 4
+#elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
+		crc = (crc >> 2) ^ tab[0][crc & 3];
 	}
-	return crc;
-# elif CRC_LE_BITS == 2
+#elif CRC_LE_BITS == 4
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 4) ^ tab[0][crc & 15];
+		crc = (crc >> 4) ^ tab[0][crc & 15];
 	}
+#else
+	crc = __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, tab, CRC_LE_BITS == 64 ? 2 : 1);
+	crc = __le32_to_cpu(crc);
+#endif
 	return crc;
-# endif
+}
+
+#if CRC_LE_BITS == 1
+u32 __pure crc32_le_base(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRCPOLY_LE);
+}
+
+u32 __pure __crc32c_le_base(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, NULL, CRC32C_POLY_LE);
+}
+#else
+u32 __pure crc32_le_base(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32table_le, CRCPOLY_LE);
+}
+
+u32 __pure __crc32c_le_base(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_generic(crc, p, len, crc32ctable_le, CRC32C_POLY_LE);
 }
 #endif
 
+/**
+ * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
+ * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
+ *	other uses, or the previous crc32 value if computing incrementally.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ *
+ * Architectures with a faster implementation override this weak version,
+ * and can still call crc32_le_base() for what they do not handle.
+ */
+u32 __pure __weak crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return crc32_le_base(crc, p, len);
+}
+
+/**
+ * __crc32c_le() - Calculate bitwise little-endian CRC32c (Castagnoli)
+ * @crc: seed value for computation.  Like crc32_le(), no inversion is
+ *	done here; iSCSI and others start with ~0 and invert the result.
+ * @p: pointer to buffer over which CRC is run
+ * @len: length of buffer @p
+ *
+ * Weak like crc32_le(), with __crc32c_le_base() as the fallback.
+ */
+u32 __pure __weak __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	return __crc32c_le_base(crc, p, len);
+}
+
 /**
  * crc32_be() - Calculate bitwise big-endian Ethernet AUTODIN II CRC32
  * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
@@ -179,26 +249,26 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 #else				/* Table-based approach */
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
-# if CRC_BE_BITS == 8
-	const u32      (*tab)[] = crc32table_be;
+# if CRC_BE_BITS >= 8
+	const u32      (*tab)[256] = crc32table_be;
 
 	crc = __cpu_to_be32(crc);
-	crc = crc32_body(crc, p, len, tab);
+	crc = crc32_body(crc, p, len, tab, CRC_BE_BITS == 64 ? 2 : 1);
 	return __be32_to_cpu(crc);
 # elif CRC_BE_BITS == 4
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
 	}
 	return crc;
 # elif CRC_BE_BITS == 2
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
 	}
 	return crc;
 # endif
@@ -207,6 +277,9 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 
 EXPORT_SYMBOL(crc32_le);
 EXPORT_SYMBOL(crc32_be);
+EXPORT_SYMBOL(crc32_le_base);
+EXPORT_SYMBOL(__crc32c_le);
+EXPORT_SYMBOL(__crc32c_le_base);
 
 /*
  * A brief CRC tutorial.
@@ -335,6 +408,143 @@ EXPORT_SYMBOL(crc32_be);
  * the same way on decoding, it doesn't make a difference.
  */
 
+#ifdef CONFIG_CRC32_SELFTEST
+
+/* 4096 bytes of pseudo random data, filled in by crc32_fill_buf() */
+static u8 __attribute__((__aligned__(8))) test_buf[4096] __initdata;
+
+/*
+ * Random starting crc, start offset and length into test_buf, and the
+ * expected crc32_le(), crc32_be() and __crc32c_le() results.  The first
+ * few cover the empty, single byte, short and longest buffers.
+ */
+static struct crc_test {
+	u32 crc;
+	u32 start;
+	u32 length;
+	u32 expect[3];
+} test[] __initdata = {
+	{0x09de8895, 0x00000012, 0x00000000, {0x09de8895, 0x09de8895, 0x09de8895}},
+	{0xc33f4584, 0x00000009, 0x00000001, {0x28c187db, 0xe7be245a, 0xbaf92e3b}},
+	{0x76688387, 0x00000017, 0x00000007, {0x1d634880, 0x00fd6cad, 0xf8a65358}},
+	{0xb2ccdfa7, 0x00000032, 0x00000fc0, {0x398a0185, 0xccd2b267, 0x1b7ec858}},
+	{0x74043590, 0x00000026, 0x000003fc, {0xfef3647b, 0xe8bcbad6, 0xe2a0995f}},
+	{0x9be6a8ea, 0x00000001, 0x0000041c, {0x7528ed1e, 0x12bd42b6, 0xc057e83b}},
+	{0x6eb108e2, 0x00000024, 0x000002fa, {0xb657122b, 0x67668114, 0xd57274b3}},
+	{0x9fdfe168, 0x00000036, 0x00000793, {0xa5f668d4, 0x948d06cd, 0xd77d7cad}},
+	{0x8c072307, 0x00000038, 0x0000060a, {0x4024ecca, 0x8e5e127f, 0x305eaeaf}},
+	{0xf362b708, 0x0000001b, 0x00000326, {0x665c25e0, 0x245b3009, 0x01084a3b}},
+	{0x2d1aa9ea, 0x00000003, 0x000006ce, {0x339cf329, 0x05387a5f, 0xe7b0196f}},
+	{0x1b784c44, 0x00000034, 0x000000ff, {0xd0224075, 0x0f9f4098, 0x749b9c3c}},
+	{0x60383fa0, 0x00000009, 0x000000c4, {0xe2d45853, 0x0b014c4a, 0x1f1655d5}},
+	{0x291e1aa6, 0x00000020, 0x000006ad, {0xd774bab1, 0xb9758e1b, 0xa2044161}},
+	{0x7ef85d5b, 0x00000008, 0x0000062d, {0xcc78c9a8, 0x485086ff, 0xb420d99c}},
+	{0x6308b85b, 0x00000026, 0x000007d3, {0x53c12c2b, 0x3e1d83e1, 0x8f73b1e8}},
+	{0x81b584eb, 0x00000011, 0x00000499, {0xb5502fe0, 0xa1fd484f, 0x28ed4e84}},
+	{0x2e8d0bb3, 0x00000018, 0x00000082, {0xe799cf6c, 0x464a40a3, 0x7f2bc10f}},
+	{0x0c86010e, 0x00000025, 0x0000007d, {0xc6956ace, 0xaaf8540d, 0x2ec7bc7e}},
+	{0x2fc6499d, 0x0000003c, 0x0000007d, {0xf271ce72, 0x48775879, 0xca54994c}},
+	{0xd6cf23c0, 0x0000000a, 0x0000025e, {0x7f49fe1d, 0x4d3821db, 0x3f981434}},
+	{0x4678b59a, 0x00000038, 0x0000009d, {0x14b3e689, 0xe80e86a3, 0x493dbd14}},
+	{0x85b25ac3, 0x00000027, 0x000000d3, {0xfe16ca77, 0x97eef83b, 0x15d73613}},
+	{0xfcfcbc36, 0x00000036, 0x00000682, {0xaf8d793e, 0x0eb2f1ab, 0x379aa417}},
+	{0x9599bc3d, 0x00000029, 0x00000776, {0x5233a87f, 0x549607ce, 0x72f8d62c}},
+	{0xa6561be6, 0x0000002b, 0x0000007d, {0xc8491e80, 0x3565b13c, 0x81fb00c2}},
+	{0x1816da59, 0x00000036, 0x000004fb, {0xe5e33c7a, 0xdab0a605, 0x9f6cc1af}},
+	{0x75198c34, 0x00000032, 0x0000052d, {0xd6ad5c83, 0x1b4ed36b, 0xb30bf583}},
+	{0xe61f2da4, 0x0000002e, 0x000002a6, {0x2f80f8af, 0x373552c9, 0x801c0e3f}},
+	{0x5486d496, 0x00000021, 0x00000550, {0xa377818a, 0x19614dfe, 0x8a5ad184}},
+	{0xb37ee754, 0x0000001c, 0x00000155, {0x2f6d8938, 0x8e3fffe2, 0x3d1814ce}},
+	{0x2057b0de, 0x00000036, 0x000000a4, {0xe1a60ca9, 0x77a163d7, 0xe0971f26}},
+	{0xc7e6c971, 0x00000014, 0x00000066, {0x5371f920, 0x5d97b130, 0xaee8378f}},
+	{0xe05adc18, 0x00000025, 0x00000225, {0x8aa12934, 0x25ebebf9, 0xb074aaf8}},
+	{0x5e38a9ff, 0x0000002e, 0x0000017c, {0x0f67b1b0, 0xaa3bd193, 0x44e14414}},
+	{0xac0072c7, 0x00000026, 0x00000090, {0xd2ed160d, 0x3f87c729, 0xb9edf9f1}},
+	{0xf81bd0ee, 0x0000003f, 0x0000046a, {0xf91e822e, 0x64d11b89, 0xaa55f96e}},
+	{0xa9a3d623, 0x00000007, 0x00000260, {0x4737aba0, 0x60e472e0, 0xac039cf0}},
+	{0x7eb39bc1, 0x00000039, 0x0000063b, {0x5d2aa6a5, 0x8eeb8a2f, 0xe022beb8}},
+	{0xba83f02a, 0x0000003d, 0x000002e4, {0xae848589, 0xce22bd3c, 0x46adb2e9}},
+};
+
+enum { CRC_TEST_LE, CRC_TEST_BE, CRC_TEST_32C_LE };
+
+/*
+ * Both the possibly architecture optimised entry points and the generic
+ * code they fall back to are checked, and timed against each other.
+ */
+static struct crc_test_fn {
+	const char *name;
+	u32 (*fn)(u32 crc, unsigned char const *p, size_t len);
+	int expect;
+} test_fn[] __initdata = {
+	{ "crc32_le",		crc32_le,		CRC_TEST_LE },
+	{ "crc32_le_base",	crc32_le_base,		CRC_TEST_LE },
+	{ "crc32_be",		crc32_be,		CRC_TEST_BE },
+	{ "__crc32c_le",	__crc32c_le,		CRC_TEST_32C_LE },
+	{ "__crc32c_le_base",	__crc32c_le_base,	CRC_TEST_32C_LE },
+};
+
+static void __init crc32_fill_buf(void)
+{
+	u32 seed = 0x12345678;
+	int i;
+
+	for (i = 0; i < sizeof(test_buf); i++) {
+		seed = seed * 1103515245 + 12345;
+		test_buf[i] = seed >> 16;
+	}
+}
+
+static int __init crc32test_init(void)
+{
+	size_t bytes = 0;
+	int errors = 0;
+	int i, j;
+
+	crc32_fill_buf();
+	for (j = 0; j < ARRAY_SIZE(test); j++)
+		bytes += test[j].length;
+
+	pr_info("crc32: CRC_LE_BITS = %d, CRC_BE_BITS = %d\n",
+		CRC_LE_BITS, CRC_BE_BITS);
+
+	for (i = 0; i < ARRAY_SIZE(test_fn); i++) {
+		const struct crc_test_fn *f = &test_fn[i];
+		int failed = 0;
+		ktime_t start;
+		u64 nsec;
+
+		start = ktime_get();
+		for (j = 0; j < ARRAY_SIZE(test); j++) {
+			const struct crc_test *t = &test[j];
+
+			if (f->fn(t->crc, test_buf + t->start, t->length) !=
+			    t->expect[f->expect])
+				failed++;
+		}
+		nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (failed)
+			pr_err("crc32: %s: %d of %zu tests failed\n",
+			       f->name, failed, ARRAY_SIZE(test));
+		else
+			pr_info("crc32: %s: %zu bytes in %llu nsec\n",
+				f->name, bytes, (unsigned long long)nsec);
+		errors += failed;
+	}
+
+	if (errors)
+		pr_warn("crc32: self tests failed\n");
+	else
+		pr_info("crc32: self tests passed\n");
+
+	return 0;
+}
+
+module_init(crc32test_init);
+
+#endif				/* CONFIG_CRC32_SELFTEST */
+
 #ifdef UNITTEST
 
 #include <stdlib.h>
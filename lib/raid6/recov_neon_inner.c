@@ -0,0 +1,108 @@
+/* -----------------------------------------------------------------------
+ *
+ *   recov_neon_inner.c - RAID-6 recovery using ARM NEON instructions
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, Inc., 53 Temple Place Ste 330,
+ *   Boston MA 02111-1307, USA; either version 2 of the License, or
+ *   (at your option) any later version; incorporated herein by reference.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/recov_neon_inner.c
+ *
+ * The loops of recov.c, with the GF(2^8) multiplications done 16 bytes
+ * at a time as two 16 entry table lookups, one for each nibble, in the
+ * tables of raid6_vgfmul.  Like neon.uc this is built with the NEON
+ * compiler flags and only includes <arm_neon.h>.
+ */
+
+#include <arm_neon.h>
+
+/*
+ * ARMv7 has no 16 byte vtbl, only one looking up eight indices in up to
+ * 32 bytes, so use that twice.
+ */
+static inline uint8x16_t vtbl16_u8(uint8x16_t tbl, uint8x16_t idx)
+{
+	uint8x8x2_t t;
+
+	t.val[0] = vget_low_u8(tbl);
+	t.val[1] = vget_high_u8(tbl);
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)),
+			   vtbl2_u8(t, vget_high_u8(idx)));
+}
+
+/* The product of each byte of v with the constant of the tables m0/m1 */
+static inline uint8x16_t gfmul16(uint8x16_t v, uint8x16_t m0, uint8x16_t m1)
+{
+	const uint8x16_t x0f = vdupq_n_u8(0x0f);
+
+	return veorq_u8(vtbl16_u8(m0, vandq_u8(v, x0f)),
+			vtbl16_u8(m1, vshrq_n_u8(v, 4)));
+}
+
+void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
+			      uint8_t *dq, const uint8_t *pbmul,
+			      const uint8_t *qmul)
+{
+	const uint8x16_t pm0 = vld1q_u8(pbmul);
+	const uint8x16_t pm1 = vld1q_u8(pbmul + 16);
+	const uint8x16_t qm0 = vld1q_u8(qmul);
+	const uint8x16_t qm1 = vld1q_u8(qmul + 16);
+
+	/*
+	 * while ( bytes-- ) {
+	 *	px    = *p ^ *dp;
+	 *	qx    = qmul[*q ^ *dq];
+	 *	*dq++ = db = pbmul[px] ^ qx;
+	 *	*dp++ = db ^ px;
+	 *	p++; q++;
+	 * }
+	 */
+	while (bytes) {
+		uint8x16_t px, qx, db;
+
+		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		qx = gfmul16(veorq_u8(vld1q_u8(q), vld1q_u8(dq)), qm0, qm1);
+		db = veorq_u8(gfmul16(px, pm0, pm1), qx);
+
+		vst1q_u8(dq, db);
+		vst1q_u8(dp, veorq_u8(db, px));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dp += 16;
+		dq += 16;
+	}
+}
+
+void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dq,
+			      const uint8_t *qmul)
+{
+	const uint8x16_t qm0 = vld1q_u8(qmul);
+	const uint8x16_t qm1 = vld1q_u8(qmul + 16);
+
+	/*
+	 * while ( bytes-- ) {
+	 *	*p++ ^= *dq = qmul[*q ^ *dq];
+	 *	q++; dq++;
+	 * }
+	 */
+	while (bytes) {
+		uint8x16_t vx;
+
+		vx = gfmul16(veorq_u8(vld1q_u8(q), vld1q_u8(dq)), qm0, qm1);
+
+		vst1q_u8(dq, vx);
+		vst1q_u8(p, veorq_u8(vx, vld1q_u8(p)));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dq += 16;
+	}
+}
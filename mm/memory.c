@@ -1109,6 +1109,28 @@ int copy_page_range(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	return ret;
 }
 
+/*
+ * Free the swap entries collected by zap_pte_range(), reporting the ptes
+ * of any which turn out not to be valid.  Returns the new batch count.
+ */
+static int zap_swap_batch(struct vm_area_struct *vma, swp_entry_t *entries,
+			  unsigned long *addrs, int nr)
+{
+	unsigned long bad;
+	int i;
+
+	if (!nr)
+		return 0;
+
+	bad = free_swap_and_cache_batch(entries, nr);
+	for (i = 0; unlikely(bad) && i < nr; i++) {
+		if (bad & (1UL << i))
+			print_bad_pte(vma, addrs[i],
+				      swp_entry_to_pte(entries[i]), NULL);
+	}
+	return 0;
+}
+
 static unsigned long zap_pte_range(struct mmu_gather *tlb,
 				struct vm_area_struct *vma, pmd_t *pmd,
 				unsigned long addr, unsigned long end,
@@ -1117,6 +1139,9 @@ static unsigned long zap_pte_range(struct mmu_gather *tlb,
 	struct mm_struct *mm = tlb->mm;
 	int force_flush = 0;
 	int rss[NR_MM_COUNTERS];
+	swp_entry_t swp_batch[SWAP_FREE_BATCH];
+	unsigned long swp_addr[SWAP_FREE_BATCH];
+	int nr_swp = 0;
 	spinlock_t *ptl;
 	pte_t *start_pte;
 	pte_t *pte;
@@ -1194,14 +1219,26 @@ again:
 		} else {
 			swp_entry_t entry = pte_to_swp_entry(ptent);
 
-			if (!non_swap_entry(entry))
+			if (!non_swap_entry(entry)) {
 				rss[MM_SWAPENTS]--;
-			if (unlikely(!free_swap_and_cache(entry)))
+				/*
+				 * Free real swap entries in batches, so that
+				 * tearing down a big swapped-out mm does not
+				 * take swap_lock once per pte.
+				 */
+				swp_batch[nr_swp] = entry;
+				swp_addr[nr_swp] = addr;
+				if (++nr_swp == SWAP_FREE_BATCH)
+					nr_swp = zap_swap_batch(vma, swp_batch,
+								swp_addr, nr_swp);
+			} else if (unlikely(!free_swap_and_cache(entry)))
 				print_bad_pte(vma, addr, ptent, NULL);
 		}
 		pte_clear_not_present_full(mm, addr, pte, tlb->fullmm);
 	} while (pte++, addr += PAGE_SIZE, addr != end);
 
+	/* Flush remaining swap entries while the pte lock keeps out swapoff */
+	nr_swp = zap_swap_batch(vma, swp_batch, swp_addr, nr_swp);
 	add_mm_rss_vec(mm, rss);
 	arch_leave_lazy_mmu_mode();
 	pte_unmap_unlock(start_pte, ptl);
@@ -0,0 +1,178 @@
+/*
+ *  linux/mm/swap_slots.c
+ *
+ *  Per-cpu caches of swap slots.
+ *
+ *  Every swap entry handed out by get_swap_page() used to cost a trip
+ *  through swap_lock, so that parallel reclaimers swapping out to a fast
+ *  device (zram in particular) spent their time bouncing that lock
+ *  between cpus.  Instead, each cpu keeps a small array of slots which
+ *  it refills from the swap devices in one go via get_swap_pages().
+ *
+ *  Cached slots are allocated as far as the rest of the swap code is
+ *  concerned: their swap_map entry holds SWAP_HAS_CACHE with no page in
+ *  the swap cache.  So the caches are emptied when a cpu goes away, when
+ *  a device is being swapped off, and while free swap space is low, so
+ *  that slots stranded on other cpus cannot make swap look full.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/percpu.h>
+#include <linux/mutex.h>
+#include <linux/cpu.h>
+#include <linux/init.h>
+
+#define SWAP_SLOTS_CACHE_SIZE	64
+
+/*
+ * The caches are switched on when there are more than
+ * SWAP_SLOTS_ACTIVATE_MARK slots free per online cpu, and switched off
+ * (and drained) again when that falls below SWAP_SLOTS_DEACTIVATE_MARK.
+ */
+#define SWAP_SLOTS_ACTIVATE_MARK	(5 * SWAP_SLOTS_CACHE_SIZE)
+#define SWAP_SLOTS_DEACTIVATE_MARK	(2 * SWAP_SLOTS_CACHE_SIZE)
+
+struct swap_slots_cache {
+	struct mutex	alloc_lock;	/* protects the fields below */
+	int		nr;		/* slots left in the cache */
+	int		cur;		/* index of the next slot to hand out */
+	swp_entry_t	slots[SWAP_SLOTS_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+static bool swap_slot_cache_active;
+static bool swap_slot_cache_initialized;
+/* Serializes activation and deactivation of the caches */
+static DEFINE_MUTEX(swap_slots_cache_mutex);
+
+static void drain_slots_cache_cpu(unsigned int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+	mutex_lock(&cache->alloc_lock);
+	if (cache->nr) {
+		swapcache_free_entries(cache->slots + cache->cur, cache->nr);
+		cache->cur = 0;
+		cache->nr = 0;
+	}
+	mutex_unlock(&cache->alloc_lock);
+}
+
+static void __drain_swap_slots_cache(void)
+{
+	unsigned int cpu;
+
+	/*
+	 * Offline cpus were drained by the hotplug notifier, but walking
+	 * all possible cpus saves racing with a cpu coming up.
+	 */
+	for_each_possible_cpu(cpu)
+		drain_slots_cache_cpu(cpu);
+}
+
+/*
+ * Return all cached slots to the swap devices.  Caches refill on the
+ * next allocation; called by swapoff before it scans the swap_map.
+ */
+void drain_swap_slots_cache(void)
+{
+	if (!swap_slot_cache_initialized)
+		return;
+
+	mutex_lock(&swap_slots_cache_mutex);
+	__drain_swap_slots_cache();
+	mutex_unlock(&swap_slots_cache_mutex);
+}
+
+static bool check_cache_active(void)
+{
+	long pages;
+
+	if (!swap_slot_cache_initialized)
+		return false;
+
+	pages = nr_swap_pages;
+	if (!swap_slot_cache_active) {
+		if (pages > num_online_cpus() * SWAP_SLOTS_ACTIVATE_MARK) {
+			mutex_lock(&swap_slots_cache_mutex);
+			swap_slot_cache_active = true;
+			mutex_unlock(&swap_slots_cache_mutex);
+		}
+		goto out;
+	}
+
+	if (pages < num_online_cpus() * SWAP_SLOTS_DEACTIVATE_MARK) {
+		mutex_lock(&swap_slots_cache_mutex);
+		if (swap_slot_cache_active) {
+			/*
+			 * Refills check swap_slot_cache_active under the cpu's
+			 * alloc_lock, which draining takes after this store.
+			 */
+			swap_slot_cache_active = false;
+			__drain_swap_slots_cache();
+		}
+		mutex_unlock(&swap_slots_cache_mutex);
+	}
+out:
+	return swap_slot_cache_active;
+}
+
+static int refill_swap_slots_cache(struct swap_slots_cache *cache)
+{
+	if (!swap_slot_cache_active)
+		return 0;
+
+	cache->cur = 0;
+	cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE, cache->slots);
+	return cache->nr;
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	entry.val = 0;
+
+	if (check_cache_active()) {
+		/*
+		 * We may be migrated away from this cpu once we sleep on
+		 * alloc_lock; that is fine, the mutex is all that protects
+		 * the cache.
+		 */
+		cache = &per_cpu(swp_slots, raw_smp_processor_id());
+		mutex_lock(&cache->alloc_lock);
+		if (cache->nr || refill_swap_slots_cache(cache)) {
+			entry = cache->slots[cache->cur];
+			cache->slots[cache->cur++].val = 0;
+			cache->nr--;
+		}
+		mutex_unlock(&cache->alloc_lock);
+		if (entry.val)
+			return entry;
+	}
+
+	get_swap_pages(1, &entry);
+	return entry;
+}
+
+static int __cpuinit swap_slots_cpu_callback(struct notifier_block *nfb,
+					     unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_slots_cache_cpu((long)hcpu);
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_init(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu(swp_slots, cpu).alloc_lock);
+	hotcpu_notifier(swap_slots_cpu_callback, 0);
+	swap_slot_cache_initialized = true;
+	return 0;
+}
+__initcall(swap_slots_init);
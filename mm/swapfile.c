@@ -409,17 +409,26 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/*
+ * Allocate up to @n swap entries for the swap cache, taking swap_lock
+ * only once.  The entries are stored in @swp_entries and the number
+ * actually allocated is returned.  Used by the per-cpu slot caches in
+ * mm/swap_slots.c, which is where get_swap_page() lives.
+ */
+int get_swap_pages(int n, swp_entry_t swp_entries[])
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int n_ret = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	if (n > nr_swap_pages)
+		n = nr_swap_pages;
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -437,18 +446,21 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (n_ret < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			swp_entries[n_ret++] = swp_entry(type, offset);
 		}
+		if (n_ret == n)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - n_ret;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return n_ret;
 }
 
 /* The only caller of this function is now susupend routine */
@@ -473,7 +485,7 @@ swp_entry_t get_swap_page_of_type(int type)
 	return (swp_entry_t) {0};
 }
 
-static struct swap_info_struct *swap_info_get(swp_entry_t entry)
+static struct swap_info_struct *__swap_info_get(swp_entry_t entry)
 {
 	struct swap_info_struct *p;
 	unsigned long offset, type;
@@ -491,7 +503,6 @@ static struct swap_info_struct *swap_info_get(swp_entry_t entry)
 		goto bad_offset;
 	if (!p->swap_map[offset])
 		goto bad_free;
-	spin_lock(&swap_lock);
 	return p;
 
 bad_free:
@@ -509,6 +520,16 @@ out:
 	return NULL;
 }
 
+static struct swap_info_struct *swap_info_get(swp_entry_t entry)
+{
+	struct swap_info_struct *p;
+
+	p = __swap_info_get(entry);
+	if (p)
+		spin_lock(&swap_lock);
+	return p;
+}
+
 static unsigned char swap_entry_free(struct swap_info_struct *p,
 				     swp_entry_t entry, unsigned char usage)
 {
@@ -597,6 +618,27 @@ void swapcache_free(swp_entry_t entry, struct page *page)
 	}
 }
 
+/*
+ * Give back swap entries that were allocated for the swap cache but
+ * never had a page added, as the per-cpu slot caches do when drained.
+ */
+void swapcache_free_entries(swp_entry_t *entries, int n)
+{
+	struct swap_info_struct *p;
+	int i;
+
+	if (n <= 0)
+		return;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < n; i++) {
+		p = __swap_info_get(entries[i]);
+		if (p)
+			swap_entry_free(p, entries[i], SWAP_HAS_CACHE);
+	}
+	spin_unlock(&swap_lock);
+}
+
 /*
  * How many references to page are currently swapped out?
  * This does not give an exact answer when swap count is continued,
@@ -718,6 +760,60 @@ int free_swap_and_cache(swp_entry_t entry)
 	return p != NULL;
 }
 
+/*
+ * Batched free_swap_and_cache(), for unmapping many swap ptes at once:
+ * swap_lock is taken once for the whole batch instead of once per entry.
+ * @nr must not exceed SWAP_FREE_BATCH.  Returns a mask with bit i set
+ * for each entries[i] which did not refer to a valid swap slot.
+ */
+unsigned long free_swap_and_cache_batch(swp_entry_t *entries, int nr)
+{
+	struct swap_info_struct *p;
+	struct page *pages[SWAP_FREE_BATCH];
+	unsigned long bad = 0;
+	int i, nr_pages = 0;
+
+	BUILD_BUG_ON(SWAP_FREE_BATCH > BITS_PER_LONG);
+	VM_BUG_ON(nr > SWAP_FREE_BATCH);
+	if (nr <= 0)
+		return 0;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < nr; i++) {
+		struct page *page;
+
+		p = __swap_info_get(entries[i]);
+		if (!p) {
+			bad |= 1UL << i;
+			continue;
+		}
+		if (swap_entry_free(p, entries[i], 1) != SWAP_HAS_CACHE)
+			continue;
+		page = find_get_page(&swapper_space, entries[i].val);
+		if (page && !trylock_page(page)) {
+			page_cache_release(page);
+			page = NULL;
+		}
+		if (page)
+			pages[nr_pages++] = page;
+	}
+	spin_unlock(&swap_lock);
+
+	for (i = 0; i < nr_pages; i++) {
+		struct page *page = pages[i];
+
+		/* As in free_swap_and_cache() */
+		if (PageSwapCache(page) && !PageWriteback(page) &&
+				(!page_mapped(page) || vm_swap_full())) {
+			delete_from_swap_cache(page);
+			SetPageDirty(page);
+		}
+		unlock_page(page);
+		page_cache_release(page);
+	}
+	return bad;
+}
+
 #ifdef CONFIG_CGROUP_MEM_RES_CTLR
 /**
  * mem_cgroup_count_swap_user - count the user of a swap entry
@@ -1613,6 +1709,13 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/*
+	 * Slots sitting in the per-cpu caches hold SWAP_HAS_CACHE without
+	 * a page: give them back so that try_to_unuse() does not wait on
+	 * them.  Refills cannot pick this device again now !SWP_WRITEOK.
+	 */
+	drain_swap_slots_cache();
+
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
@@ -218,7 +218,7 @@ void truncate_inode_pages_range(struct address_space *mapping,
 
 	cleancache_flush_inode(mapping);
 	if (mapping->nrpages == 0)
-		return;
+		goto out_shadows;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
 	end = (lend >> PAGE_CACHE_SHIFT);
@@ -295,6 +295,11 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 	}
 	cleancache_flush_inode(mapping);
+out_shadows:
+	/* Reclaim may have left shadows behind while we were truncating */
+	if (mapping->nrshadows)
+		workingset_clear_shadows(mapping, start,
+					 lend >> PAGE_CACHE_SHIFT);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
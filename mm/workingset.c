@@ -0,0 +1,305 @@
+/*
+ * mm/workingset.c
+ *
+ * Workingset detection for the page cache.
+ *
+ * Per zone, file pages live on two LRU lists: new pages start out on the
+ * inactive list and are promoted to the active list when they are
+ * accessed a second time, while reclaim evicts from the tail of the
+ * inactive list.  A page whose reuse distance is larger than the inactive
+ * list therefore never gets activated: it is evicted and read back in
+ * over and over, even though there would be room for it if the active
+ * list gave up some of its pages.
+ *
+ * To spot this, every eviction and every activation of a file page ticks
+ * a per-zone counter, zone->inactive_age.  When a page cache page is
+ * reclaimed, a snapshot of that counter is left behind in a "shadow
+ * entry" in mapping->shadow_tree at the page's index.  Should the page
+ * be faulted back in, the difference between the counter now and the
+ * snapshot is the refault distance: how much the inactive list moved on
+ * while the page was out of memory.
+ *
+ * If the refault distance is no larger than the active list, the page
+ * would have stayed resident had the inactive list been allowed that
+ * much of the active list's space.  Such a refaulting page is put
+ * straight on the active list, where it competes with the established
+ * workingset instead of being thrown out again on the next pass.
+ *
+ * Both events are counted per zone as workingset_refault and
+ * workingset_activate in /proc/vmstat and /proc/zoneinfo.
+ *
+ * Shadow entries live in a radix tree separate from the pages so that
+ * none of the page cache lookups need to learn about them.  They are
+ * removed when the page is faulted back in, on truncation, and when the
+ * inode is freed.  Inodes can stay cached long after their pages went,
+ * so a shrinker also trims the shadow trees under memory pressure, the
+ * mappings that got their shadows first being trimmed first.
+ */
+
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/swap.h>
+#include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/radix-tree.h>
+#include <linux/spinlock.h>
+#include <linux/module.h>
+
+/*
+ * Shadow entry layout: the eviction counter, then the node and zone
+ * index, then two low bits of which bit 1 is always set so the value
+ * never looks like a NULL or an indirect radix tree pointer.
+ */
+#define SHADOW_ENTRY_MARK	2UL
+#define SHADOW_MARK_SHIFT	2
+#define EVICTION_SHIFT	(SHADOW_MARK_SHIFT + NODES_SHIFT + ZONES_SHIFT)
+#define EVICTION_MASK	(~0UL >> EVICTION_SHIFT)
+
+static void *pack_shadow(unsigned long eviction, struct zone *zone)
+{
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	eviction = (eviction << ZONES_SHIFT) | zone_idx(zone);
+	eviction = (eviction << SHADOW_MARK_SHIFT);
+
+	return (void *)(eviction | SHADOW_ENTRY_MARK);
+}
+
+static void unpack_shadow(void *shadow, struct zone **zone,
+			  unsigned long *eviction)
+{
+	unsigned long entry = (unsigned long)shadow;
+	int zid, nid;
+
+	entry >>= SHADOW_MARK_SHIFT;
+	zid = entry & ((1UL << ZONES_SHIFT) - 1);
+	entry >>= ZONES_SHIFT;
+	nid = entry & ((1UL << NODES_SHIFT) - 1);
+	entry >>= NODES_SHIFT;
+
+	*zone = NODE_DATA(nid)->node_zones + zid;
+	*eviction = entry;
+}
+
+/*
+ * Mappings that hold shadow entries, for the shrinker.  A mapping is on
+ * the list exactly while its nrshadows is non-zero; both change under
+ * the mapping's tree_lock, which nests outside shadow_lru_lock.
+ */
+static LIST_HEAD(shadow_lru);
+static DEFINE_SPINLOCK(shadow_lru_lock);
+static atomic_long_t nr_shadows = ATOMIC_LONG_INIT(0);
+
+static void shadow_added(struct address_space *mapping)
+{
+	if (!mapping->nrshadows++) {
+		spin_lock(&shadow_lru_lock);
+		list_add_tail(&mapping->shadow_lru, &shadow_lru);
+		spin_unlock(&shadow_lru_lock);
+	}
+	atomic_long_inc(&nr_shadows);
+}
+
+static void shadow_removed(struct address_space *mapping)
+{
+	if (!--mapping->nrshadows) {
+		spin_lock(&shadow_lru_lock);
+		list_del_init(&mapping->shadow_lru);
+		spin_unlock(&shadow_lru_lock);
+	}
+	atomic_long_dec(&nr_shadows);
+}
+
+/**
+ * workingset_eviction - note the eviction of a page cache page
+ * @mapping: address space the page is being evicted from
+ * @page: the page being evicted
+ *
+ * Leaves a shadow entry for @page in @mapping->shadow_tree.  The caller
+ * holds the page lock and @mapping->tree_lock, and is about to remove
+ * the page from the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long eviction;
+
+	/*
+	 * Refault distances can never exceed the amount of memory, so
+	 * more shadows than that in one file are stale by definition.
+	 * Capping them bounds the radix tree nodes a large streaming
+	 * file can pin while its inode stays cached.
+	 */
+	if (mapping->nrshadows >= totalram_pages)
+		return;
+
+	/*
+	 * Only an inode's own page cache is sure to have its shadows
+	 * dropped by __destroy_inode() before it is freed; the extra
+	 * mappings some filesystems keep go without refault detection.
+	 */
+	if (!mapping->host || mapping != &mapping->host->i_data)
+		return;
+
+	eviction = atomic_long_inc_return(&zone->inactive_age);
+	/* Failing to allocate a node just means no refault detection */
+	if (!radix_tree_insert(&mapping->shadow_tree, page->index,
+			       pack_shadow(eviction, zone)))
+		shadow_added(mapping);
+}
+
+/**
+ * workingset_remove_shadow - take the shadow entry for a page cache index
+ * @mapping: address space a page is being added to
+ * @index: index of the new page
+ *
+ * Returns the shadow entry left when a page at @index was evicted, or
+ * NULL.  The caller holds @mapping->tree_lock.
+ */
+void *workingset_remove_shadow(struct address_space *mapping, pgoff_t index)
+{
+	void *shadow;
+
+	if (!mapping->nrshadows)
+		return NULL;
+
+	shadow = radix_tree_delete(&mapping->shadow_tree, index);
+	if (shadow)
+		shadow_removed(mapping);
+	return shadow;
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @shadow: shadow entry of the evicted page
+ *
+ * Returns true if the page should be activated right away, i.e. if it
+ * was evicted less than an active list's worth of inactive list aging
+ * ago.
+ */
+bool workingset_refault(void *shadow)
+{
+	unsigned long refault_distance;
+	unsigned long eviction;
+	unsigned long refault;
+	struct zone *zone;
+
+	unpack_shadow(shadow, &zone, &eviction);
+
+	refault = atomic_long_read(&zone->inactive_age);
+	refault_distance = (refault - eviction) & EVICTION_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+
+	if (refault_distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+/**
+ * workingset_clear_shadows - drop shadow entries in a range of a mapping
+ * @mapping: the address space
+ * @start: first page index
+ * @end: last page index, inclusive
+ */
+void workingset_clear_shadows(struct address_space *mapping,
+			      pgoff_t start, pgoff_t end)
+{
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned int nr, i;
+
+	while (start <= end) {
+		spin_lock_irq(&mapping->tree_lock);
+		nr = 0;
+		if (mapping->nrshadows)
+			nr = radix_tree_gang_lookup_slot(&mapping->shadow_tree,
+					slots, indices, start, PAGEVEC_SIZE);
+		for (i = 0; i < nr && indices[i] <= end; i++) {
+			radix_tree_delete(&mapping->shadow_tree, indices[i]);
+			shadow_removed(mapping);
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+
+		if (!nr || i < nr)
+			break;
+		start = indices[nr - 1] + 1;
+		if (!start)
+			break;		/* wrapped past ~0UL */
+		cond_resched();
+	}
+}
+EXPORT_SYMBOL(workingset_clear_shadows);
+
+/*
+ * Drop nr_to_scan shadow entries, a batch from the start of a mapping at
+ * a time.  The mapping then goes to the back of the list, so that the
+ * trees are trimmed in turn rather than one of them emptied.
+ */
+static int shrink_shadows(struct shrinker *shrink, struct shrink_control *sc)
+{
+	unsigned long nr_to_scan = sc->nr_to_scan;
+	void **slots[PAGEVEC_SIZE];
+	unsigned long indices[PAGEVEC_SIZE];
+	unsigned int nr, i;
+
+	while (nr_to_scan) {
+		struct address_space *mapping;
+
+		spin_lock_irq(&shadow_lru_lock);
+		if (list_empty(&shadow_lru)) {
+			spin_unlock_irq(&shadow_lru_lock);
+			break;
+		}
+		mapping = list_first_entry(&shadow_lru, struct address_space,
+					   shadow_lru);
+		list_move_tail(&mapping->shadow_lru, &shadow_lru);
+
+		/*
+		 * The lock order is the other way round; being on the list
+		 * keeps the mapping alive until we have its tree_lock, as
+		 * the inode cannot be freed without taking that lock.
+		 */
+		if (!spin_trylock(&mapping->tree_lock)) {
+			spin_unlock_irq(&shadow_lru_lock);
+			nr_to_scan--;
+			continue;
+		}
+		spin_unlock(&shadow_lru_lock);
+
+		nr = radix_tree_gang_lookup_slot(&mapping->shadow_tree,
+				slots, indices, 0,
+				min_t(unsigned long, nr_to_scan, PAGEVEC_SIZE));
+		for (i = 0; i < nr; i++) {
+			radix_tree_delete(&mapping->shadow_tree, indices[i]);
+			shadow_removed(mapping);
+		}
+		spin_unlock_irq(&mapping->tree_lock);
+
+		nr_to_scan -= min_t(unsigned long, max(nr, 1U), nr_to_scan);
+	}
+
+	return min_t(long, atomic_long_read(&nr_shadows), INT_MAX);
+}
+
+static struct shrinker shadow_shrinker = {
+	.shrink = shrink_shadows,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init workingset_init(void)
+{
+	register_shrinker(&shadow_shrinker);
+	return 0;
+}
+module_init(workingset_init);
@@ -0,0 +1,43 @@
+#ifndef ASM_UNALIGNED_H
+#define ASM_UNALIGNED_H
+
+#include <linux/kernel.h>
+
+#define get_unaligned(p)					\
+({								\
+	typeof((typeof(*(p)))0) __v;					\
+	memcpy(&__v, (p), sizeof(__v));				\
+	__v;							\
+})
+
+#define put_unaligned(v, p)					\
+do {								\
+	typeof(*(p)) __v = (v);					\
+	memcpy((p), &__v, sizeof(__v));				\
+} while (0)
+
+static inline u16 get_unaligned_le16(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8;
+}
+
+static inline u32 get_unaligned_le32(const void *p)
+{
+	const u8 *b = p;
+
+	return b[0] | b[1] << 8 | b[2] << 16 | (u32)b[3] << 24;
+}
+
+static inline void put_unaligned_le32(u32 v, void *p)
+{
+	u8 *b = p;
+
+	b[0] = v;
+	b[1] = v >> 8;
+	b[2] = v >> 16;
+	b[3] = v >> 24;
+}
+
+#endif
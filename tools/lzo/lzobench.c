@@ -0,0 +1,244 @@
+/*
+ * lzobench - compress and decompress a corpus of pages with lib/lzo
+ *
+ * Usage: lzobench [-r rounds] [file...]
+ *
+ * Each file is split into 4096 byte pages (a trailing partial page is
+ * dropped).  Without files a synthetic corpus is used: zero pages,
+ * sparse pages as found in anonymous memory and Java heaps, repeated
+ * patterns, text and random data.  Every page is decompressed again
+ * and checked against the original.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <linux/lzo.h>
+
+#define PAGE_SIZE	4096
+
+typedef int (*compress_t)(const unsigned char *src, size_t src_len,
+			  unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+static const struct {
+	const char *name;
+	compress_t compress;
+} algs[] = {
+	{ "lzo",	lzo1x_1_compress },
+	{ "lzo-rle",	lzorle1x_1_compress },
+};
+
+static unsigned char *corpus;
+static size_t nr_pages;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *xmalloc(size_t size)
+{
+	void *p = malloc(size);
+
+	if (!p) {
+		perror("malloc");
+		exit(1);
+	}
+	return p;
+}
+
+static void add_pages(const unsigned char *data, size_t pages)
+{
+	corpus = realloc(corpus, (nr_pages + pages) * PAGE_SIZE);
+	if (!corpus) {
+		perror("realloc");
+		exit(1);
+	}
+	memcpy(corpus + nr_pages * PAGE_SIZE, data, pages * PAGE_SIZE);
+	nr_pages += pages;
+}
+
+static void load_file(const char *path)
+{
+	struct stat st;
+	unsigned char *buf;
+	size_t len, done = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(path);
+		exit(1);
+	}
+	len = st.st_size & ~(size_t)(PAGE_SIZE - 1);
+	buf = xmalloc(len ? len : 1);
+	while (done < len) {
+		ssize_t r = read(fd, buf + done, len - done);
+
+		if (r <= 0) {
+			perror(path);
+			exit(1);
+		}
+		done += r;
+	}
+	close(fd);
+	add_pages(buf, len / PAGE_SIZE);
+	free(buf);
+}
+
+static void synth_corpus(void)
+{
+	static const char *words[] = {
+		"the ", "page ", "kernel ", "of ", "memory ", "and ",
+		"compress ", "a ", "swap ", "\n", "zram ", "to ",
+	};
+	unsigned char page[PAGE_SIZE];
+	int i, j;
+
+	srand(1);
+	for (i = 0; i < 64; i++) {
+		/* zero page */
+		memset(page, 0, PAGE_SIZE);
+		add_pages(page, 1);
+
+		/* sparse: a few pointers and counters in zeroes */
+		for (j = 0; j < 24; j++) {
+			unsigned int off = (rand() % (PAGE_SIZE / 8)) * 8;
+			unsigned long v = 0xffff880000000000ul |
+					  (rand() & 0xfffff8);
+
+			memcpy(page + off, &v, sizeof(v));
+		}
+		add_pages(page, 1);
+
+		/* repeated non-zero pattern, e.g. a filled array */
+		for (j = 0; j < PAGE_SIZE; j++)
+			page[j] = "\xde\xad\xbe\xef\x01\x00\x00\x00"[j & 7];
+		add_pages(page, 1);
+
+		/* object header followed by zeroed fields */
+		memset(page, 0, PAGE_SIZE);
+		for (j = 0; j < PAGE_SIZE; j += 64) {
+			page[j] = 1;
+			page[j + 8] = rand();
+			page[j + 9] = rand();
+		}
+		add_pages(page, 1);
+
+		/* text */
+		for (j = 0; j < PAGE_SIZE; ) {
+			const char *w = words[rand() % 12];
+			size_t l = strlen(w);
+
+			if (l > PAGE_SIZE - j)
+				l = PAGE_SIZE - j;
+			memcpy(page + j, w, l);
+			j += l;
+		}
+		add_pages(page, 1);
+
+		/* random */
+		for (j = 0; j < PAGE_SIZE; j++)
+			page[j] = rand();
+		add_pages(page, 1);
+
+		/* half random, half zero */
+		memset(page + PAGE_SIZE / 2, 0, PAGE_SIZE / 2);
+		add_pages(page, 1);
+	}
+}
+
+static void bench(const char *name, compress_t compress, int rounds)
+{
+	size_t worst = lzo1x_worst_compress(PAGE_SIZE);
+	unsigned char *dst = xmalloc(nr_pages * worst);
+	size_t *dst_len = xmalloc(nr_pages * sizeof(*dst_len));
+	unsigned char out[PAGE_SIZE];
+	void *wrkmem = xmalloc(LZO1X_1_MEM_COMPRESS);
+	double t, tc = 0, td = 0;
+	size_t i, total = 0;
+	int r;
+
+	for (r = 0; r < rounds; r++) {
+		t = now();
+		for (i = 0; i < nr_pages; i++) {
+			dst_len[i] = worst;
+			if (compress(corpus + i * PAGE_SIZE, PAGE_SIZE,
+				     dst + i * worst, &dst_len[i], wrkmem)) {
+				fprintf(stderr, "%s: compress failed\n", name);
+				exit(1);
+			}
+		}
+		tc += now() - t;
+
+		t = now();
+		for (i = 0; i < nr_pages; i++) {
+			size_t len = PAGE_SIZE;
+
+			if (lzo1x_decompress_safe(dst + i * worst, dst_len[i],
+						  out, &len) != LZO_E_OK ||
+			    len != PAGE_SIZE) {
+				fprintf(stderr, "%s: page %zu: decompress failed\n",
+					name, i);
+				exit(1);
+			}
+			if (r == 0 && memcmp(out, corpus + i * PAGE_SIZE,
+					     PAGE_SIZE)) {
+				fprintf(stderr, "%s: page %zu: mismatch\n",
+					name, i);
+				exit(1);
+			}
+		}
+		td += now() - t;
+	}
+
+	for (i = 0; i < nr_pages; i++)
+		total += dst_len[i];
+
+	printf("%-8s ratio %5.2f  compress %8.1f MB/s  decompress %8.1f MB/s\n",
+	       name, (double)nr_pages * PAGE_SIZE / total,
+	       nr_pages * PAGE_SIZE * (double)rounds / tc / 1e6,
+	       nr_pages * PAGE_SIZE * (double)rounds / td / 1e6);
+
+	free(wrkmem);
+	free(dst_len);
+	free(dst);
+}
+
+int main(int argc, char *argv[])
+{
+	int rounds = 100;
+	size_t i;
+	int c;
+
+	while ((c = getopt(argc, argv, "r:")) != -1) {
+		switch (c) {
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-r rounds] [file...]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (rounds < 1)
+		rounds = 1;
+
+	for (; optind < argc; optind++)
+		load_file(argv[optind]);
+	if (!nr_pages)
+		synth_corpus();
+
+	printf("%zu pages, %d rounds\n", nr_pages, rounds);
+	for (i = 0; i < sizeof(algs) / sizeof(algs[0]); i++)
+		bench(algs[i].name, algs[i].compress, rounds);
+	return 0;
+}
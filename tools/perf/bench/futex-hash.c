@@ -0,0 +1,176 @@
+/*
+ *
+ * futex-hash.c
+ *
+ * hash: Stress the kernel's futex hash table
+ *
+ * Every thread owns a set of private futexes and repeatedly issues
+ * FUTEX_WAIT calls that fail immediately (the futex value never matches)
+ * followed by FUTEX_WAKE calls that find no waiter.  Both paths hash the
+ * futex and take the hash bucket lock, so the throughput measures bucket
+ * collisions and lock contention rather than sleeping and waking.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <assert.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static int nthreads;
+static int nfutexes = 1024;
+static int nsecs = 10;
+
+static volatile int done;
+
+struct worker {
+	pthread_t thread;
+	unsigned int *futex;
+	unsigned long ops;
+};
+
+static pthread_mutex_t start_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int started;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_INTEGER('f', "futexes", &nfutexes,
+		    "Specify number of futexes per thread"),
+	OPT_INTEGER('r', "runtime", &nsecs,
+		    "Specify runtime in seconds"),
+	OPT_END()
+};
+
+static const char * const bench_futex_hash_usage[] = {
+	"perf bench futex hash <options>",
+	NULL
+};
+
+static inline int futex_op(unsigned int *uaddr, int op, unsigned int val)
+{
+	return syscall(SYS_futex, uaddr, op | FUTEX_PRIVATE_FLAG, val,
+		       NULL, NULL, 0);
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	int i;
+
+	pthread_mutex_lock(&start_mutex);
+	while (!started)
+		pthread_cond_wait(&start_cond, &start_mutex);
+	pthread_mutex_unlock(&start_mutex);
+
+	while (!done) {
+		for (i = 0; i < nfutexes; i++) {
+			/* The value is always 0, so this returns EAGAIN */
+			futex_op(&w->futex[i], FUTEX_WAIT, 1);
+			futex_op(&w->futex[i], FUTEX_WAKE, 1);
+		}
+		w->ops += 2 * nfutexes;
+	}
+
+	return NULL;
+}
+
+static void toggle_done(int sig __used)
+{
+	done = 1;
+}
+
+int bench_futex_hash(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct worker *workers;
+	struct timeval start, stop, diff;
+	unsigned long long total = 0, result_usec;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_hash_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	assert(nthreads > 0 && nfutexes > 0 && nsecs > 0);
+
+	workers = calloc(nthreads, sizeof(*workers));
+	assert(workers);
+
+	signal(SIGALRM, toggle_done);
+	signal(SIGINT, toggle_done);
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].futex = calloc(nfutexes, sizeof(unsigned int));
+		assert(workers[i].futex);
+		assert(!pthread_create(&workers[i].thread, NULL,
+				       worker_fn, &workers[i]));
+	}
+
+	pthread_mutex_lock(&start_mutex);
+	started = 1;
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&start_mutex);
+
+	alarm(nsecs);
+
+	for (i = 0; i < nthreads; i++) {
+		assert(!pthread_join(workers[i].thread, NULL));
+		total += workers[i].ops;
+	}
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+	result_usec = diff.tv_sec * 1000000ULL + diff.tv_usec;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# %d threads operating on %d futexes each\n\n",
+		       nthreads, nfutexes);
+
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / 1000));
+
+		printf(" %14llu futex operations\n", total);
+		printf(" %14llu ops/sec\n",
+		       total * 1000000ULL / (result_usec ? result_usec : 1));
+		printf(" %14llu ops/sec per thread\n",
+		       total * 1000000ULL / (result_usec ? result_usec : 1) /
+		       nthreads);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%llu\n",
+		       total * 1000000ULL / (result_usec ? result_usec : 1));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	for (i = 0; i < nthreads; i++)
+		free(workers[i].futex);
+	free(workers);
+
+	return 0;
+}